@@ -0,0 +1,195 @@
+// iosim.c
+// Simulated I/O library
+// Provides the functions of iolib.h over a simulated JTAG chain, so that
+// the player can be built without the GPIO hardware (make jpsim) and its
+// speed measured by the benchmark (make bench).
+//
+// The pins are contiguous as in jamstub.c: TCK, TMS, TDO and TDI, where
+// TDO is the pin set up as an input. The chain is SIM_DEVICES devices,
+// each with a 10-bit instruction register which holds the IDCODE
+// instruction after Test-Logic-Reset and captures 0000000001. IDCODE
+// selects the 32-bit IDCODE register and every other instruction selects
+// the one-bit bypass register. The first device is nearest TDI.
+
+#include <stdio.h>
+#include <unistd.h>
+#include "iolib.h"
+
+#define SIM_DEVICES 2
+#define SIM_IR_LENGTH 10
+#define SIM_IR_CAPTURE 0x001
+#define SIM_IDCODE 0x006
+#define SIM_PIN_COUNT 47
+
+// TAP controller states
+enum { SIM_RESET, SIM_IDLE, SIM_DRSELECT, SIM_DRCAPTURE, SIM_DRSHIFT,
+	SIM_DREXIT1, SIM_DRPAUSE, SIM_DREXIT2, SIM_DRUPDATE, SIM_IRSELECT,
+	SIM_IRCAPTURE, SIM_IRSHIFT, SIM_IREXIT1, SIM_IRPAUSE, SIM_IREXIT2,
+	SIM_IRUPDATE };
+
+// next state, for TMS low and TMS high
+const char sim_next_state[16][2]={
+	{SIM_IDLE, SIM_RESET},		{SIM_IDLE, SIM_DRSELECT},
+	{SIM_DRCAPTURE, SIM_IRSELECT},	{SIM_DRSHIFT, SIM_DREXIT1},
+	{SIM_DRSHIFT, SIM_DREXIT1},	{SIM_DRPAUSE, SIM_DRUPDATE},
+	{SIM_DRPAUSE, SIM_DREXIT2},	{SIM_DRSHIFT, SIM_DRUPDATE},
+	{SIM_IDLE, SIM_DRSELECT},	{SIM_IRCAPTURE, SIM_RESET},
+	{SIM_IRSHIFT, SIM_IREXIT1},	{SIM_IRSHIFT, SIM_IREXIT1},
+	{SIM_IRPAUSE, SIM_IRUPDATE},	{SIM_IRPAUSE, SIM_IREXIT2},
+	{SIM_IRSHIFT, SIM_IRUPDATE},	{SIM_IDLE, SIM_DRSELECT}};
+
+// EP2C5 and EP2C8
+const unsigned int sim_idcode[SIM_DEVICES]={0x020B10DD, 0x020B20DD};
+
+int sim_tck_pin=11;
+int sim_tms_pin=12;
+int sim_tdo_pin=13;
+int sim_tdi_pin=14;
+char sim_pins[SIM_PIN_COUNT];
+int sim_state=SIM_RESET;
+char sim_tdo=0;
+unsigned int sim_ir[SIM_DEVICES];
+unsigned int sim_ir_shift[SIM_DEVICES];
+unsigned int sim_dr_shift[SIM_DEVICES];
+int sim_dr_length[SIM_DEVICES];
+unsigned long sim_tck_count=0;
+
+// one rising edge of TCK: shift the selected registers, then change state
+void
+sim_clock(void)
+{
+	int i;
+	unsigned int in;
+	unsigned int out;
+
+	sim_tck_count++;
+	sim_tdo=0;
+	in=sim_pins[sim_tdi_pin];
+
+	if (sim_state==SIM_IRSHIFT)
+	{
+		sim_tdo=sim_ir_shift[SIM_DEVICES-1]&1;
+		for (i=0; i<SIM_DEVICES; i++)
+		{
+			out=sim_ir_shift[i]&1;
+			sim_ir_shift[i]=(sim_ir_shift[i]>>1)|(in<<(SIM_IR_LENGTH-1));
+			in=out;
+		}
+	}
+	else if (sim_state==SIM_DRSHIFT)
+	{
+		sim_tdo=sim_dr_shift[SIM_DEVICES-1]&1;
+		for (i=0; i<SIM_DEVICES; i++)
+		{
+			out=sim_dr_shift[i]&1;
+			sim_dr_shift[i]=(sim_dr_shift[i]>>1)|(in<<(sim_dr_length[i]-1));
+			in=out;
+		}
+	}
+
+	sim_state=sim_next_state[sim_state][sim_pins[sim_tms_pin]!=0];
+
+	for (i=0; i<SIM_DEVICES; i++)
+	{
+		if (sim_state==SIM_RESET)
+		{
+			sim_ir[i]=SIM_IDCODE;
+		}
+		else if (sim_state==SIM_IRCAPTURE)
+		{
+			sim_ir_shift[i]=SIM_IR_CAPTURE;
+		}
+		else if (sim_state==SIM_IRUPDATE)
+		{
+			sim_ir[i]=sim_ir_shift[i];
+		}
+		else if ((sim_state==SIM_DRCAPTURE) && (sim_ir[i]==SIM_IDCODE))
+		{
+			sim_dr_shift[i]=sim_idcode[i];
+			sim_dr_length[i]=32;
+		}
+		else if (sim_state==SIM_DRCAPTURE)
+		{
+			sim_dr_shift[i]=0;
+			sim_dr_length[i]=1;
+		}
+	}
+}
+
+int
+iolib_init(void)
+{
+	int i;
+
+	sim_state=SIM_RESET;
+	sim_tck_count=0;
+	for (i=0; i<SIM_DEVICES; i++)
+	{
+		sim_ir[i]=SIM_IDCODE;
+	}
+	return(0);
+}
+
+int
+iolib_free(void)
+{
+	if (IOLIB_DBG) printf("iolib_free: %lu TCK cycles simulated\n", sim_tck_count);
+	return(0);
+}
+
+int
+iolib_setdir(char port, char pin, char dir)
+{
+	// the input is TDO, and the other pins are placed around it
+	if ((pin<1) || (pin>SIM_PIN_COUNT-1) ||
+		((dir==DIR_IN) && ((pin<3) || (pin>SIM_PIN_COUNT-2))))
+	{
+		if (IOLIB_DBG) printf("iolib_setdir: parameter error!\n");
+		return(-1);
+	}
+
+	if (dir==DIR_IN)
+	{
+		sim_tck_pin=pin-2;
+		sim_tms_pin=pin-1;
+		sim_tdo_pin=pin;
+		sim_tdi_pin=pin+1;
+	}
+
+	return(0);
+}
+
+void
+pin_high(char port, char pin)
+{
+	if ((pin==sim_tck_pin) && !sim_pins[(int)pin])
+	{
+		sim_clock();
+	}
+	sim_pins[(int)pin]=1;
+}
+
+void
+pin_low(char port, char pin)
+{
+	sim_pins[(int)pin]=0;
+}
+
+char
+is_high(char port, char pin)
+{
+	return((pin==sim_tdo_pin) ? sim_tdo : sim_pins[(int)pin]);
+}
+
+char
+is_low(char port, char pin)
+{
+	return(!is_high(port, pin));
+}
+
+int
+iolib_delay_ms(unsigned int msec)
+{
+	usleep(msec*1000);
+	return(0);
+}
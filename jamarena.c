@@ -0,0 +1,361 @@
+/****************************************************************************/
+/*																			*/
+/*	Module:			jamarena.c												*/
+/*																			*/
+/*	Description:	Memory arena for the symbol records, heap records,		*/
+/*					statement buffers and temporary workspace allocated		*/
+/*					during one run of jam_execute() when no fixed-size		*/
+/*					workspace is used.										*/
+/*																			*/
+/****************************************************************************/
+
+#include "jamexprt.h"
+#include "jamdefs.h"
+#include "jamarena.h"
+
+/****************************************************************************/
+/*																			*/
+/*	Type definitions														*/
+/*																			*/
+/****************************************************************************/
+
+/*
+*	The arena gets memory from jam_malloc() in chunks and hands out blocks
+*	by moving a pointer through the current chunk.  Block sizes are
+*	rounded up to a power of two, and freed blocks go on a free list for
+*	their size, so that buffers which are freed and allocated again (such
+*	as the statement buffer of each CALL) are reused.  Blocks too big for
+*	a chunk are allocated separately.  jam_free_arena() releases all of
+*	it at the end of the run, so records need not be freed one by one.
+*/
+#define JAMC_ARENA_CHUNK_SIZE 0x10000L
+#define JAMC_ARENA_MIN_BLOCK 32L
+#define JAMC_ARENA_CLASS_COUNT 10	/* block sizes from 32 to 16K bytes */
+#define JAMC_ARENA_LARGE_CLASS JAMC_ARENA_CLASS_COUNT
+
+/* header of each block, and of each chunk */
+typedef struct JAMS_ARENA_BLOCK_STRUCT
+{
+	struct JAMS_ARENA_BLOCK_STRUCT *next;		/* free, large or chunk list */
+	struct JAMS_ARENA_BLOCK_STRUCT *previous;	/* large block list only */
+	long size;			/* size in bytes, including the header */
+	int size_class;
+
+} JAMS_ARENA_BLOCK;
+
+/* the header is padded so that the data after it is 8-byte aligned */
+#define JAMC_ARENA_HEADER_SIZE \
+	((long) ((sizeof(JAMS_ARENA_BLOCK) + 7) & ~((unsigned int) 7)))
+
+/****************************************************************************/
+/*																			*/
+/*	Global variables														*/
+/*																			*/
+/****************************************************************************/
+
+BOOL jam_arena_enabled = FALSE;
+
+JAMS_ARENA_BLOCK *jam_arena_chunks = NULL;
+
+JAMS_ARENA_BLOCK *jam_arena_large_blocks = NULL;
+
+JAMS_ARENA_BLOCK *jam_arena_free_list[JAMC_ARENA_CLASS_COUNT];
+
+/* unused part of the current chunk */
+char *jam_arena_top = NULL;
+char *jam_arena_end = NULL;
+
+/* bytes obtained from jam_malloc(), now and at most */
+long jam_arena_size = 0L;
+long jam_arena_peak_size = 0L;
+
+/****************************************************************************/
+/*																			*/
+
+void jam_init_arena(void)
+
+/*																			*/
+/*	Description:	Starts a new arena.  It is only used when there is no	*/
+/*					fixed-size workspace; otherwise jam_arena_malloc() and	*/
+/*					jam_arena_free() call jam_malloc() and jam_free().		*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	int size_class = 0;
+
+	jam_arena_enabled = (jam_workspace == NULL);
+	jam_arena_chunks = NULL;
+	jam_arena_large_blocks = NULL;
+	jam_arena_top = NULL;
+	jam_arena_end = NULL;
+	jam_arena_size = 0L;
+	jam_arena_peak_size = 0L;
+
+	for (size_class = 0; size_class < JAMC_ARENA_CLASS_COUNT; ++size_class)
+	{
+		jam_arena_free_list[size_class] = NULL;
+	}
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_free_arena(void)
+
+/*																			*/
+/*	Description:	Releases all memory held by the arena and exports its	*/
+/*					peak size as JAM_ARENA_PEAK_SIZE.  Blocks allocated		*/
+/*					from the arena must not be used afterwards.				*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	JAMS_ARENA_BLOCK *block = NULL;
+	JAMS_ARENA_BLOCK *next = NULL;
+
+	if (jam_arena_enabled)
+	{
+		for (block = jam_arena_large_blocks; block != NULL; block = next)
+		{
+			next = block->next;
+			jam_free(block);
+		}
+
+		for (block = jam_arena_chunks; block != NULL; block = next)
+		{
+			next = block->next;
+			jam_free(block);
+		}
+
+		jam_export_integer("JAM_ARENA_PEAK_SIZE", jam_arena_peak_size);
+	}
+
+	jam_init_arena();
+	jam_arena_enabled = FALSE;
+}
+
+/****************************************************************************/
+/*																			*/
+
+BOOL jam_arena_active(void)
+
+/*																			*/
+/*	Description:	Tells whether blocks are allocated from the arena, in	*/
+/*					which case they are all released by jam_free_arena()	*/
+/*																			*/
+/*	Returns:		TRUE if the arena is in use								*/
+/*																			*/
+/****************************************************************************/
+{
+	return (jam_arena_enabled);
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_arena_add_size
+(
+	long size
+)
+
+/*																			*/
+/*	Description:	Counts memory obtained from (or returned to) the host	*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	jam_arena_size += size;
+
+	if (jam_arena_size > jam_arena_peak_size)
+	{
+		jam_arena_peak_size = jam_arena_size;
+	}
+}
+
+/****************************************************************************/
+/*																			*/
+
+JAMS_ARENA_BLOCK *jam_arena_new_block
+(
+	long block_size
+)
+
+/*																			*/
+/*	Description:	Takes a block from the unused part of the current		*/
+/*					chunk.  If it is too small, what is left of it is put	*/
+/*					on the free lists and a new chunk is started.			*/
+/*																			*/
+/*	Returns:		pointer to block, or NULL if memory not available		*/
+/*																			*/
+/****************************************************************************/
+{
+	int size_class = JAMC_ARENA_CLASS_COUNT - 1;
+	long free_size = JAMC_ARENA_MIN_BLOCK << (JAMC_ARENA_CLASS_COUNT - 1);
+	JAMS_ARENA_BLOCK *block = NULL;
+	JAMS_ARENA_BLOCK *chunk = NULL;
+
+	if ((long) (jam_arena_end - jam_arena_top) < block_size)
+	{
+		/* keep the rest of the current chunk as free blocks */
+		while ((jam_arena_top != NULL) && (size_class >= 0))
+		{
+			if ((long) (jam_arena_end - jam_arena_top) >= free_size)
+			{
+				block = (JAMS_ARENA_BLOCK *) jam_arena_top;
+				block->next = jam_arena_free_list[size_class];
+				jam_arena_free_list[size_class] = block;
+				jam_arena_top += free_size;
+			}
+			else
+			{
+				free_size >>= 1;
+				--size_class;
+			}
+		}
+
+		chunk = (JAMS_ARENA_BLOCK *)
+			jam_malloc((unsigned int) JAMC_ARENA_CHUNK_SIZE);
+
+		if (chunk == NULL)
+		{
+			jam_arena_top = NULL;
+			jam_arena_end = NULL;
+		}
+		else
+		{
+			chunk->next = jam_arena_chunks;
+			jam_arena_chunks = chunk;
+			jam_arena_add_size(JAMC_ARENA_CHUNK_SIZE);
+
+			jam_arena_top = ((char *) chunk) + JAMC_ARENA_HEADER_SIZE;
+			jam_arena_end = ((char *) chunk) + JAMC_ARENA_CHUNK_SIZE;
+		}
+	}
+
+	block = NULL;
+
+	if ((long) (jam_arena_end - jam_arena_top) >= block_size)
+	{
+		block = (JAMS_ARENA_BLOCK *) jam_arena_top;
+		jam_arena_top += block_size;
+	}
+
+	return (block);
+}
+
+/****************************************************************************/
+/*																			*/
+
+void *jam_arena_malloc
+(
+	unsigned int size
+)
+
+/*																			*/
+/*	Description:	Allocates a block of memory from the arena				*/
+/*																			*/
+/*	Returns:		pointer to memory, or NULL if memory not available		*/
+/*																			*/
+/****************************************************************************/
+{
+	int size_class = 0;
+	long block_size = JAMC_ARENA_MIN_BLOCK;
+	long size_needed = JAMC_ARENA_HEADER_SIZE + (long) size;
+	JAMS_ARENA_BLOCK *block = NULL;
+	void *ptr = NULL;
+
+	if (!jam_arena_enabled)
+	{
+		ptr = jam_malloc(size);
+	}
+	else
+	{
+		/* find the smallest size class which will hold the block */
+		while ((size_class < JAMC_ARENA_CLASS_COUNT) &&
+			(block_size < size_needed))
+		{
+			block_size <<= 1;
+			++size_class;
+		}
+
+		if (size_class == JAMC_ARENA_LARGE_CLASS)
+		{
+			block_size = size_needed;
+			block = (JAMS_ARENA_BLOCK *)
+				jam_malloc((unsigned int) block_size);
+
+			if (block != NULL)
+			{
+				block->previous = NULL;
+				block->next = jam_arena_large_blocks;
+				if (block->next != NULL) block->next->previous = block;
+				jam_arena_large_blocks = block;
+				jam_arena_add_size(block_size);
+			}
+		}
+		else if (jam_arena_free_list[size_class] != NULL)
+		{
+			block = jam_arena_free_list[size_class];
+			jam_arena_free_list[size_class] = block->next;
+		}
+		else
+		{
+			block = jam_arena_new_block(block_size);
+		}
+
+		if (block != NULL)
+		{
+			block->size = block_size;
+			block->size_class = size_class;
+			ptr = (void *) (((char *) block) + JAMC_ARENA_HEADER_SIZE);
+		}
+	}
+
+	return (ptr);
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_arena_free
+(
+	void *ptr
+)
+
+/*																			*/
+/*	Description:	Returns a block to the arena for reuse					*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	JAMS_ARENA_BLOCK *block = NULL;
+
+	if ((ptr != NULL) && (!jam_arena_enabled))
+	{
+		jam_free(ptr);
+	}
+	else if (ptr != NULL)
+	{
+		block = (JAMS_ARENA_BLOCK *) (((char *) ptr) - JAMC_ARENA_HEADER_SIZE);
+
+		if (block->size_class == JAMC_ARENA_LARGE_CLASS)
+		{
+			/* large blocks go straight back to the host */
+			if (block->previous == NULL) jam_arena_large_blocks = block->next;
+			else block->previous->next = block->next;
+			if (block->next != NULL) block->next->previous = block->previous;
+			jam_arena_add_size(-block->size);
+			jam_free(block);
+		}
+		else
+		{
+			block->next = jam_arena_free_list[block->size_class];
+			jam_arena_free_list[block->size_class] = block;
+		}
+	}
+}
@@ -0,0 +1,44 @@
+/****************************************************************************/
+/*																			*/
+/*	Module:			jamarena.h												*/
+/*																			*/
+/*	Description:	Prototypes for the memory arena, which holds the		*/
+/*					records allocated during one run of jam_execute()		*/
+/*																			*/
+/****************************************************************************/
+
+#ifndef INC_JAMARENA_H
+#define INC_JAMARENA_H
+
+/****************************************************************************/
+/*																			*/
+/*	Function prototypes														*/
+/*																			*/
+/****************************************************************************/
+
+void jam_init_arena
+(
+	void
+);
+
+void jam_free_arena
+(
+	void
+);
+
+void *jam_arena_malloc
+(
+	unsigned int size
+);
+
+void jam_arena_free
+(
+	void *ptr
+);
+
+BOOL jam_arena_active
+(
+	void
+);
+
+#endif /* INC_JAMARENA_H */
@@ -51,38 +51,193 @@ typedef enum
 
 } JAME_RLC_BLOCK_TYPE;
 
-JAM_RETURN_TYPE jam_reverse_boolean_array_bin
+/*
+*	Values of ASCII characters in the 6-bit encoding used by the ACA
+*	representation, indexed by character code.  White space characters
+*	are marked with JAMC_6BIT_SPACE, all other characters with -1.
+*/
+#define JAMC_6BIT_SPACE (-2)
+
+static const signed char jam_6bit_table[256] =
+{
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -2, -2, -2, -2, -2, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+	63, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+	25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, -1, -1, -1, -1, 62,
+	-1, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50,
+	51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+/*
+*	Values of hexadecimal digit characters, indexed by character code.
+*	All other characters are marked with -1.
+*/
+static const signed char jam_hex_table[256] =
+{
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+/*
+*	Cache buffers for initialized arrays in workspace mode.  BIN, HEX and
+*	RLC data is kept as a window of decoded words.  A window is refilled
+*	by decoding from the nearest resume point at or before it -- one of
+*	the checkpoints recorded when the data was first read, or the place
+*	where the last fill stopped, so sequential access never has to decode
+*	the same data twice.  Stream bits are numbered in the order they
+*	appear in the file, which differs from the array order in Jam 2.0.
+*/
+#define JAMC_CACHE_CHECKPOINTS 16
+
+typedef struct
+{
+	long window_start;		/* first array word in the window, or -1 */
+	long checkpoint_bits;	/* stream bits between checkpoints */
+	long checkpoint_count;
+	long cursor_position;	/* file position where the last fill stopped */
+	long cursor_bit;		/* stream bit where the last fill stopped */
+	long checkpoint_position[JAMC_CACHE_CHECKPOINTS];
+	long checkpoint_bit[JAMC_CACHE_CHECKPOINTS];
+	long window[1];			/* window fills the rest of the cache buffer */
+
+} JAMS_ARRAY_CACHE;
+
+#define JAMC_CACHE_WINDOW_WORDS ((long) (((JAMC_ARRAY_CACHE_SIZE - \
+	sizeof(JAMS_ARRAY_CACHE)) / sizeof(long)) + 1))
+
+/*
+*	ACA data cannot be decoded from the middle of the stream without the
+*	bytes that came before it, so it is cached as the state of a decoder
+*	that is resumed when later data is needed.  The decoder's history
+*	(the last JAMC_ACA_HISTORY_SIZE bytes) serves as the window.  This
+*	size must be a power of two, and at least the ACA match window.
+*/
+#define JAMC_ACA_HISTORY_SIZE 8192
+
+typedef struct
+{
+	long data_length;		/* uncompressed length in bytes */
+	long out_index;			/* number of bytes decoded so far */
+	long position;			/* file position of next input character */
+	long char_count;		/* number of input characters used */
+	unsigned long bits;		/* input bits not yet used, LSB first */
+	int bit_count;			/* number of valid bits in "bits" */
+	int offset_bits;		/* width of match offset field */
+	BOOL end;				/* TRUE once the semicolon has been read */
+	BOOL literal;			/* TRUE if copying literal bytes */
+	long offset;			/* offset of the match being copied */
+	long count;				/* bytes left in current literal or match */
+	unsigned char history[JAMC_ACA_HISTORY_SIZE];
+
+} JAMS_ACA_CACHE;
+
+/****************************************************************************/
+/*																			*/
+
+void jam_reverse_heap_bits
 (
-	JAMS_HEAP_RECORD *heap_record
+	long *heap_data,
+	long bit_count,
+	int group_bits
 )
+
+/*																			*/
+/*	Description:	Reverses the order of the first bit_count bits of		*/
+/*					Boolean array data, in groups of group_bits bits (1 for	*/
+/*					single bits, 4 for hex digits).  Whole 32-bit words		*/
+/*					are reversed and swapped end for end, then the result	*/
+/*					is shifted down over the unused bits of the last word.	*/
+/*					Bits above bit_count in the last word are preserved.	*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
 {
-	long *heap_data = &heap_record->data[0];
-	long dimension = heap_record->dimension;
-	int a, b;
-	long i, j;
+	long words = (bit_count + 31L) >> 5;
+	int pad = (int) ((words << 5) - bit_count);
+	unsigned long high_bits = 0L;
+	unsigned long a = 0L;
+	unsigned long b = 0L;
+	long i = 0L;
+	long j = 0L;
+
+	if (pad != 0)
+	{
+		high_bits = ((unsigned long) heap_data[words - 1]) &
+			(0xffffffffUL << (32 - pad)) & 0xffffffffUL;
+	}
 
-	for (i = 0; i < dimension / 2; ++i)
+	for (i = 0L, j = words - 1L; i <= j; ++i, --j)
 	{
-		j = (dimension - 1) - i;
-		a = (heap_data[i >> 5] & (1L << (i & 0x1f))) ? 1 : 0;
-		b = (heap_data[j >> 5] & (1L << (j & 0x1f))) ? 1 : 0;
-		if (a)
-		{
-			heap_data[j >> 5] |= (1L << (j & 0x1f));
-		}
-		else
-		{
-			heap_data[j >> 5] &= ~(1L << (j & 0x1f));
-		}
-		if (b)
+		a = ((unsigned long) heap_data[i]) & 0xffffffffUL;
+		b = ((unsigned long) heap_data[j]) & 0xffffffffUL;
+
+		/* reverse the order of the groups within each word */
+		a = ((a >> 16) | (a << 16)) & 0xffffffffUL;
+		b = ((b >> 16) | (b << 16)) & 0xffffffffUL;
+		a = ((a & 0xff00ff00UL) >> 8) | ((a & 0x00ff00ffUL) << 8);
+		b = ((b & 0xff00ff00UL) >> 8) | ((b & 0x00ff00ffUL) << 8);
+		a = ((a & 0xf0f0f0f0UL) >> 4) | ((a & 0x0f0f0f0fUL) << 4);
+		b = ((b & 0xf0f0f0f0UL) >> 4) | ((b & 0x0f0f0f0fUL) << 4);
+
+		if (group_bits == 1)
 		{
-			heap_data[i >> 5] |= (1L << (i & 0x1f));
+			a = ((a & 0xccccccccUL) >> 2) | ((a & 0x33333333UL) << 2);
+			b = ((b & 0xccccccccUL) >> 2) | ((b & 0x33333333UL) << 2);
+			a = ((a & 0xaaaaaaaaUL) >> 1) | ((a & 0x55555555UL) << 1);
+			b = ((b & 0xaaaaaaaaUL) >> 1) | ((b & 0x55555555UL) << 1);
 		}
-		else
+
+		heap_data[i] = (long) b;
+		heap_data[j] = (long) a;
+	}
+
+	if (pad != 0)
+	{
+		/* shift data down over the bits which were beyond bit_count */
+		for (i = 0L; i < words - 1L; ++i)
 		{
-			heap_data[i >> 5] &= ~(1L << (i & 0x1f));
+			heap_data[i] = (long) (((((unsigned long) heap_data[i]) &
+				0xffffffffUL) >> pad) |
+				((((unsigned long) heap_data[i + 1]) << (32 - pad)) &
+				0xffffffffUL));
 		}
+
+		heap_data[words - 1] = (long) (((((unsigned long)
+			heap_data[words - 1]) & 0xffffffffUL) >> pad) | high_bits);
 	}
+}
+
+JAM_RETURN_TYPE jam_reverse_boolean_array_bin
+(
+	JAMS_HEAP_RECORD *heap_record
+)
+{
+	jam_reverse_heap_bits(&heap_record->data[0], heap_record->dimension, 1);
 
 	return (JAMC_SUCCESS);
 }
@@ -92,20 +247,9 @@ JAM_RETURN_TYPE jam_reverse_boolean_array_hex
 	JAMS_HEAP_RECORD *heap_record
 )
 {
-	long *heap_data = &heap_record->data[0];
 	long nibbles = (heap_record->dimension + 3) / 4;
-	long a, b, i, j;
 
-	for (i = 0; i < nibbles / 2; ++i)
-	{
-		j = (nibbles - 1) - i;
-		a = (heap_data[i >> 3] >> ((i & 7) << 2)) & 0x0f;
-		b = (heap_data[j >> 3] >> ((j & 7) << 2)) & 0x0f;
-		heap_data[j >> 3] &= ~(0x0fL << ((j & 7) << 2));
-		heap_data[j >> 3] |= (a << ((j & 7) << 2));
-		heap_data[i >> 3] &= ~(0x0fL << ((i & 7) << 2));
-		heap_data[i >> 3] |= (b << ((i & 7) << 2));
-	}
+	jam_reverse_heap_bits(&heap_record->data[0], nibbles * 4L, 4);
 
 	return (JAMC_SUCCESS);
 }
@@ -242,13 +386,15 @@ JAM_RETURN_TYPE jam_extract_bool_binary
 /****************************************************************************/
 {
 	int index = 0;
+	int digits = 0;
+	unsigned long word = 0L;
+	unsigned long mask = 0L;
 	long address = 0L;
 	long dimension = heap_record->dimension;
 	JAM_RETURN_TYPE status = JAMC_SUCCESS;
 	long *heap_data = &heap_record->data[0];
 
-	for (address = 0L; (status == JAMC_SUCCESS) && (address < dimension);
-		++address)
+	while ((status == JAMC_SUCCESS) && (address < dimension))
 	{
 		while ((jam_isspace(statement_buffer[index])) &&
 			(index < JAMC_MAX_STATEMENT_LENGTH))
@@ -256,23 +402,37 @@ JAM_RETURN_TYPE jam_extract_bool_binary
 			++index;	/* skip over white space */
 		}
 
-		if (statement_buffer[index] == '0')
-		{
-			/* clear a single bit */
-			heap_data[address >> 5] &=
-				(~(unsigned long)(1L << (address & 0x1f)));
-		}
-		else if (statement_buffer[index] == '1')
+		/* collect a run of digits into the current word */
+		digits = 0;
+		while ((address < dimension) &&
+			((statement_buffer[index] == '0') ||
+			(statement_buffer[index] == '1')))
 		{
-			/* set a single bit */
-			heap_data[address >> 5] |= (1L << (address & 0x1f));
+			word |= ((unsigned long) (statement_buffer[index] - '0')) <<
+				(address & 0x1f);
+			++address;
+			++index;
+			++digits;
+
+			if ((address & 0x1f) == 0)
+			{
+				heap_data[(address - 1) >> 5] = (long) word;
+				word = 0L;
+			}
 		}
-		else
+
+		if (digits == 0)
 		{
 			status = JAMC_SYNTAX_ERROR;
 		}
+	}
 
-		++index;
+	if ((status == JAMC_SUCCESS) && ((address & 0x1f) != 0))
+	{
+		/* store the last partial word, keeping the bits above it */
+		mask = (1UL << (address & 0x1f)) - 1UL;
+		heap_data[address >> 5] = (long)
+			((((unsigned long) heap_data[address >> 5]) & ~mask) | word);
 	}
 
 	if (status == JAMC_SUCCESS)
@@ -310,7 +470,9 @@ JAM_RETURN_TYPE jam_extract_bool_hex
 /****************************************************************************/
 {
 	int index = 0;
-	int ch = 0;
+	int digits = 0;
+	unsigned long word = 0L;
+	unsigned long mask = 0L;
 	long data = 0L;
 	long nibble = 0L;
 	long nibbles = 0L;
@@ -321,7 +483,7 @@ JAM_RETURN_TYPE jam_extract_bool_hex
 	nibbles = (heap_record->dimension >> 2) +
 		((heap_record->dimension & 3) ? 1 : 0);
 
-	for (nibble = 0L; (status == JAMC_SUCCESS) && (nibble < nibbles); ++nibble)
+	while ((status == JAMC_SUCCESS) && (nibble < nibbles))
 	{
 		while ((jam_isspace(statement_buffer[index])) &&
 			(index < JAMC_MAX_STATEMENT_LENGTH))
@@ -329,34 +491,37 @@ JAM_RETURN_TYPE jam_extract_bool_hex
 			++index;	/* skip over white space */
 		}
 
-		ch = (int) statement_buffer[index];
-
-		if ((ch >= 'A') && (ch <= 'F'))
-		{
-			data = (long) (ch + 10 - 'A');
-		}
-		else if ((ch >= 'a') && (ch <= 'f'))
+		/* collect a run of hex digits into the current word */
+		digits = 0;
+		data = jam_hex_table[(unsigned char) statement_buffer[index]];
+		while ((nibble < nibbles) && (data >= 0))
 		{
-			data = (long) (ch + 10 - 'a');
-		}
-		else if ((ch >= '0') && (ch <= '9'))
-		{
-			data = (long) (ch - '0');
-		}
-		else
-		{
-			status = JAMC_SYNTAX_ERROR;
+			word |= ((unsigned long) data) << ((nibble & 7) << 2);
+			++nibble;
+			++index;
+			++digits;
+
+			if ((nibble & 7) == 0)
+			{
+				heap_data[(nibble - 1) >> 3] = (long) word;
+				word = 0L;
+			}
+
+			data = jam_hex_table[(unsigned char) statement_buffer[index]];
 		}
 
-		if (status == JAMC_SUCCESS)
+		if (digits == 0)
 		{
-			/* modify four bits of data in the array */
-			heap_data[nibble >> 3] = (heap_data[nibble >> 3] & 
-				(~(unsigned long) (15L << ((nibble & 7) << 2)))) |
-				(data << ((nibble & 7) << 2));
+			status = JAMC_SYNTAX_ERROR;
 		}
+	}
 
-		++index;
+	if ((status == JAMC_SUCCESS) && ((nibble & 7) != 0))
+	{
+		/* store the last partial word, keeping the bits above it */
+		mask = (1UL << ((nibble & 7) << 2)) - 1UL;
+		heap_data[nibble >> 3] = (long)
+			((((unsigned long) heap_data[nibble >> 3]) & ~mask) | word);
 	}
 
 	if (status == JAMC_SUCCESS)
@@ -406,6 +571,109 @@ int jam_6bit_char(int ch)
 /****************************************************************************/
 /*																			*/
 
+long jam_pack_6bit_chars
+(
+	char *buffer,
+	char **terminator
+)
+
+/*																			*/
+/*	Description:	Converts ACA characters in buffer to a binary bit		*/
+/*					stream, in the same buffer, skipping over white space.	*/
+/*					Each group of four characters is packed into three		*/
+/*					bytes at once.  Conversion stops at the first			*/
+/*					character which is neither white space nor a valid		*/
+/*					6-bit character; a pointer to that character is			*/
+/*					returned by reference.									*/
+/*																			*/
+/*	Returns:		Number of bits of binary data in buffer					*/
+/*																			*/
+/****************************************************************************/
+{
+	unsigned char *in = (unsigned char *) buffer;
+	unsigned char *out = (unsigned char *) buffer;
+	unsigned long group = 0L;
+	long char_count = 0L;
+	int shift = 0;
+	int v0 = 0;
+	int v1 = 0;
+	int v2 = 0;
+	int v3 = 0;
+	BOOL done = FALSE;
+
+	while (!done)
+	{
+		v0 = jam_6bit_table[in[0]];
+		v3 = -1;
+
+		if ((shift == 0) && (v0 >= 0))
+		{
+			/* try to take a whole group of four characters at once */
+			v1 = jam_6bit_table[in[1]];
+			v2 = (v1 >= 0) ? jam_6bit_table[in[2]] : -1;
+			v3 = (v2 >= 0) ? jam_6bit_table[in[3]] : -1;
+		}
+
+		if (v3 >= 0)
+		{
+			group = ((unsigned long) v0) |
+				(((unsigned long) v1) << 6) |
+				(((unsigned long) v2) << 12) |
+				(((unsigned long) v3) << 18);
+
+			out[0] = (unsigned char) group;
+			out[1] = (unsigned char) (group >> 8);
+			out[2] = (unsigned char) (group >> 16);
+			out += 3;
+			in += 4;
+			char_count += 4L;
+			group = 0L;
+		}
+		else if (v0 >= 0)
+		{
+			group |= ((unsigned long) v0) << shift;
+			shift += 6;
+			++char_count;
+
+			if (shift == 24)
+			{
+				out[0] = (unsigned char) group;
+				out[1] = (unsigned char) (group >> 8);
+				out[2] = (unsigned char) (group >> 16);
+				out += 3;
+				group = 0L;
+				shift = 0;
+			}
+
+			++in;
+		}
+		else if (v0 == JAMC_6BIT_SPACE)
+		{
+			++in;
+		}
+		else
+		{
+			done = TRUE;
+		}
+	}
+
+	/* store any partial group, padding the last byte with zeros */
+	while (shift > 0)
+	{
+		*out = (unsigned char) group;
+		++out;
+		group >>= 8;
+		shift -= 8;
+	}
+
+	*terminator = (char *) in;
+
+	return (char_count * 6L);
+}
+
+/****************************************************************************/
+/*																			*/
+
 BOOL jam_rlc_key_char
 (
 	int ch,
@@ -603,65 +871,19 @@ JAM_RETURN_TYPE jam_extract_bool_compressed
 /*																			*/
 /****************************************************************************/
 {
-	int bit = 0;
 	int word = 0;
-	int value = 0;
-	int index = 0;
-	int index2 = 0;
 	long uncompressed_length = 0L;
 	char *ch_data = NULL;
+	char *terminator = NULL;
 	long out_size = 0L;
 	long address = 0L;
 	long *heap_data = &heap_record->data[0];
 	JAM_RETURN_TYPE status = JAMC_SUCCESS;
 
-	/* remove all white space */
-	while (statement_buffer[index] != JAMC_NULL_CHAR)
-	{
-		if (!jam_isspace(statement_buffer[index]))
-		{
-			statement_buffer[index2] = statement_buffer[index];
-			++index2;
-		}
-		++index;
-	}
-	statement_buffer[index2] = JAMC_NULL_CHAR;
-
 	/* convert 6-bit encoded characters to binary -- in the same buffer */
-	index = 0;
-	while ((status == JAMC_SUCCESS) &&
-		(statement_buffer[index] != JAMC_NULL_CHAR) &&
-		(statement_buffer[index] != JAMC_SEMICOLON_CHAR))
-	{
-		value = jam_6bit_char(statement_buffer[index]);
-		statement_buffer[index] = 0;
-
-		if (value == -1)
-		{
-			status = JAMC_SYNTAX_ERROR;
-		}
-		else
-		{
-			for (bit = 0; bit < 6; ++bit)
-			{
-				if (value & (1 << (bit % 6)))
-				{
-					statement_buffer[address >> 3] |= (1L << (address & 7));
-				}
-				else
-				{
-					statement_buffer[address >> 3] &=
-						~(unsigned int) (1 << (address & 7));
-				}
-				++address;
-			}
-		}
-
-		++index;
-	}
+	address = jam_pack_6bit_chars(statement_buffer, &terminator);
 
-	if ((status == JAMC_SUCCESS) &&
-		(statement_buffer[index] != JAMC_SEMICOLON_CHAR))
+	if (*terminator != JAMC_SEMICOLON_CHAR)
 	{
 		status = JAMC_SYNTAX_ERROR;
 	}
@@ -697,12 +919,14 @@ JAM_RETURN_TYPE jam_extract_bool_compressed
 		}
 		else
 		{
-			/* convert data from bytes into 32-bit words */
+			/* convert data from bytes into 32-bit words -- from the */
+			/* last word down, as a long may be wider than four bytes, */
+			/* and each word must be read before it is overwritten */
 			out_size = (heap_record->dimension >> 5) +
 				((heap_record->dimension & 0x1f) ? 1 : 0);
 			ch_data = (char *)heap_data;
 
-			for (word = 0; word < out_size; ++word)
+			for (word = (int) out_size - 1; word >= 0; --word)
 			{
 				heap_data[word] =
 					((((long) ch_data[(word * 4) + 3]) & 0xff) << 24L) |
@@ -891,6 +1115,8 @@ JAM_RETURN_TYPE jam_read_bool_binary
 /****************************************************************************/
 {
 	int ch = 0;
+	unsigned long word = 0L;
+	unsigned long mask = 0L;
 	long address = 0L;
 	long dimension = heap_record->dimension;
 	JAM_RETURN_TYPE status = JAMC_SUCCESS;
@@ -905,18 +1131,17 @@ JAM_RETURN_TYPE jam_read_bool_binary
 	{
 		ch = jam_get_real_char();
 
-		if (ch == '0')
+		if ((ch == '0') || (ch == '1'))
 		{
-			/* clear a single bit */
-			heap_data[address >> 5] &=
-				(~(unsigned long)(1L << (address & 0x1f)));
-			++address;
-		}
-		else if (ch == '1')
-		{
-			/* set a single bit */
-			heap_data[address >> 5] |= (1L << (address & 0x1f));
+			/* collect bits into the current word */
+			word |= ((unsigned long) (ch - '0')) << (address & 0x1f);
 			++address;
+
+			if ((address & 0x1f) == 0)
+			{
+				heap_data[(address - 1) >> 5] = (long) word;
+				word = 0L;
+			}
 		}
 		else
 		{
@@ -930,6 +1155,14 @@ JAM_RETURN_TYPE jam_read_bool_binary
 		}
 	}
 
+	if ((status == JAMC_SUCCESS) && ((address & 0x1f) != 0))
+	{
+		/* store the last partial word, keeping the bits above it */
+		mask = (1UL << (address & 0x1f)) - 1UL;
+		heap_data[address >> 5] = (long)
+			((((unsigned long) heap_data[address >> 5]) & ~mask) | word);
+	}
+
 	if (status == JAMC_SUCCESS)
 	{
 		ch = jam_get_real_char();
@@ -960,6 +1193,8 @@ JAM_RETURN_TYPE jam_read_bool_hex
 /****************************************************************************/
 {
 	int ch = 0;
+	unsigned long word = 0L;
+	unsigned long mask = 0L;
 	long data = 0L;
 	long nibble = 0L;
 	long nibbles = 0L;
@@ -979,30 +1214,23 @@ JAM_RETURN_TYPE jam_read_bool_hex
 	{
 		ch = jam_get_real_char();
 
-		if ((ch >= 'A') && (ch <= 'F'))
-		{
-			data = (long) (ch + 10 - 'A');
-		}
-		else if ((ch >= 'a') && (ch <= 'f'))
-		{
-			data = (long) (ch + 10 - 'a');
-		}
-		else if ((ch >= '0') && (ch <= '9'))
-		{
-			data = (long) (ch - '0');
-		}
-		else
+		data = ((ch >= 0) && (ch < 256)) ? jam_hex_table[ch] : -1L;
+
+		if (data < 0)
 		{
 			status = JAMC_SYNTAX_ERROR;
 		}
-
-		if (status == JAMC_SUCCESS)
+		else
 		{
-			/* modify four bits of data in the array */
-			heap_data[nibble >> 3] = (heap_data[nibble >> 3] & 
-				(~(unsigned long) (15L << ((nibble & 7) << 2)))) |
-				(data << ((nibble & 7) << 2));
+			/* collect four bits at a time into the current word */
+			word |= ((unsigned long) data) << ((nibble & 7) << 2);
 			++nibble;
+
+			if ((nibble & 7) == 0)
+			{
+				heap_data[(nibble - 1) >> 3] = (long) word;
+				word = 0L;
+			}
 		}
 
 		if (ch == EOF)
@@ -1012,6 +1240,14 @@ JAM_RETURN_TYPE jam_read_bool_hex
 		}
 	}
 
+	if ((status == JAMC_SUCCESS) && ((nibble & 7) != 0))
+	{
+		/* store the last partial word, keeping the bits above it */
+		mask = (1UL << ((nibble & 7) << 2)) - 1UL;
+		heap_data[nibble >> 3] = (long)
+			((((unsigned long) heap_data[nibble >> 3]) & ~mask) | word);
+	}
+
 	return (status);
 }
 
@@ -1161,9 +1397,11 @@ JAM_RETURN_TYPE jam_read_bool_compressed
 /****************************************************************************/
 {
 	int ch = 0;
-	int bit = 0;
+	int shift = 0;
 	int word = 0;
 	int value = 0;
+	long index = 0L;
+	unsigned long group = 0L;
 	long uncompressed_length = 0L;
 	char *in = NULL;
 	char *ch_data = NULL;
@@ -1207,26 +1445,27 @@ JAM_RETURN_TYPE jam_read_bool_compressed
 		}
 		else
 		{
-			value = jam_6bit_char(ch);
+			value = ((ch >= 0) && (ch < 256)) ? jam_6bit_table[ch] : -1;
 
-			if (value == -1)
+			if (value < 0)
 			{
 				status = JAMC_SYNTAX_ERROR;
 			}
 			else
 			{
-				for (bit = 0; bit < 6; ++bit)
+				/* pack each group of four characters into three bytes */
+				group |= ((unsigned long) value) << shift;
+				shift += 6;
+				address += 6;
+
+				if (shift == 24)
 				{
-					if (value & (1 << (bit % 6)))
-					{
-						in[address >> 3] |= (1L << (address & 7));
-					}
-					else
-					{
-						in[address >> 3] &=
-							~(unsigned int) (1 << (address & 7));
-					}
-					++address;
+					in[index] = (char) group;
+					in[index + 1] = (char) (group >> 8);
+					in[index + 2] = (char) (group >> 16);
+					index += 3;
+					group = 0L;
+					shift = 0;
 				}
 			}
 		}
@@ -1234,6 +1473,15 @@ JAM_RETURN_TYPE jam_read_bool_compressed
 
 	if (done && (status == JAMC_SUCCESS))
 	{
+		/* store any partial group, padding the last byte with zeros */
+		while (shift > 0)
+		{
+			in[index] = (char) group;
+			++index;
+			group >>= 8;
+			shift -= 8;
+		}
+
 		/*
 		*	Uncompress the data
 		*/
@@ -1247,12 +1495,14 @@ JAM_RETURN_TYPE jam_read_bool_compressed
 		}
 		else
 		{
-			/* convert data from bytes into 32-bit words */
+			/* convert data from bytes into 32-bit words -- from the */
+			/* last word down, as a long may be wider than four bytes, */
+			/* and each word must be read before it is overwritten */
 			out_size = (heap_record->dimension >> 5) +
 				((heap_record->dimension & 0x1f) ? 1 : 0);
 			ch_data = (char *)heap_data;
 
-			for (word = 0; word < out_size; ++word)
+			for (word = (int) out_size - 1; word >= 0; --word)
 			{
 				heap_data[word] =
 					((((long) ch_data[(word * 4) + 3]) & 0xff) << 24L) |
@@ -1271,58 +1521,981 @@ JAM_RETURN_TYPE jam_read_bool_compressed
 /****************************************************************************/
 /*																			*/
 
-JAM_RETURN_TYPE jam_read_boolean_array_data
+int jam_get_cache_char
 (
-	JAMS_HEAP_RECORD *heap_record,
-	char *statement_buffer
+	long *position
 )
 
 /*																			*/
-/*	Description:	Reads Boolean array initialization data.  If it is all	*/
-/*					present in the statement buffer, then it is extracted	*/
-/*					from the buffer.  If the array initialization data did	*/
-/*					not fit into the statement buffer, it is read directly	*/
-/*					from the input stream.  Five formats of Boolean array	*/
-/*					initialization data are supported:  comma-separated		*/
-/*					values (the default), and BIN, HEX, RLC, and ACA.		*/
+/*	Description:	Same as jam_get_real_char(), but also advances the		*/
+/*					file position for each character read, so that			*/
+/*					decoding can be resumed at that point later.			*/
 /*																			*/
-/*	Returns:		JAMC_SUCCESS for success, else appropriate error code	*/
+/*	Returns:		Character code, or EOF if no characters available		*/
 /*																			*/
 /****************************************************************************/
 {
-	int index = 0;
 	int ch = 0;
-	int rep = 0;
-	int length = 0;
-	int data_offset = 0;
-	long position = 0L;
-	long data_position = 0L;
-	BOOL done = FALSE;
 	BOOL comment = FALSE;
-	BOOL found_equal = FALSE;
-	BOOL found_space = FALSE;
-	BOOL found_keyword = FALSE;
-	BOOL data_complete = FALSE;
-	JAME_BOOLEAN_REP representation = JAM_ILLEGAL_REP;
-	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+	BOOL found = FALSE;
 
-	while ((jam_isspace(statement_buffer[index])) &&
-		(index < JAMC_MAX_STATEMENT_LENGTH))
+	while (!found)
 	{
-		++index;	/* skip over white space */
-	}
+		ch = jam_getc();
+		++(*position);
 
-	/*
-	*	Figure out which data representation scheme is used
-	*/
-	if (jam_version == 2)
-	{
-		if (statement_buffer[index] == JAMC_POUND_CHAR)
+		if ((!comment) && (ch == JAMC_COMMENT_CHAR))
 		{
-			representation = JAM_BOOL_BINARY;
-			data_offset = index + 1;
+			/* beginning of comment */
+			comment = TRUE;
 		}
-		else if (statement_buffer[index] == JAMC_DOLLAR_CHAR)
+
+		if ((!comment) && (!jam_isspace((char) ch)))
+		{
+			found = TRUE;
+		}
+
+		if (ch == EOF)
+		{
+			/* end of file */
+			found = TRUE;
+		}
+
+		if (comment &&
+			((ch == JAMC_NEWLINE_CHAR) || (ch == JAMC_RETURN_CHAR)))
+		{
+			/* end of comment */
+			comment = FALSE;
+		}
+	}
+
+	return (ch);
+}
+
+/****************************************************************************/
+/*																			*/
+
+long jam_get_cache_array_bit
+(
+	JAMS_HEAP_RECORD *heap_record,
+	long bit
+)
+
+/*																			*/
+/*	Description:	Converts between stream bit and array bit numbers of	*/
+/*					a cached array.  In Jam 2.0, BIN data is stored in		*/
+/*					reverse bit order and HEX data in reverse nibble order.	*/
+/*					The conversion works in both directions.				*/
+/*																			*/
+/*	Returns:		array bit number (or stream bit number)					*/
+/*																			*/
+/****************************************************************************/
+{
+	long result = bit;
+	long nibbles = 0L;
+
+	if ((jam_version == 2) && (heap_record->rep == JAM_BOOL_BINARY))
+	{
+		result = heap_record->dimension - 1L - bit;
+	}
+	else if ((jam_version == 2) && (heap_record->rep == JAM_BOOL_HEX))
+	{
+		nibbles = (heap_record->dimension >> 2) +
+			((heap_record->dimension & 3) ? 1 : 0);
+		result = (nibbles * 4L) - 4L - (bit & ~3L) + (bit & 3L);
+	}
+
+	return (result);
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_set_cache_bit
+(
+	JAMS_HEAP_RECORD *heap_record,
+	long bit
+)
+
+/*																			*/
+/*	Description:	Sets the array bit for stream bit "bit" if it falls		*/
+/*					inside the window of a cached array.					*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	JAMS_ARRAY_CACHE *cache = (JAMS_ARRAY_CACHE *) &heap_record->data[0];
+	long offset = jam_get_cache_array_bit(heap_record, bit) -
+		(cache->window_start << 5);
+
+	if ((offset >= 0L) && (offset < (JAMC_CACHE_WINDOW_WORDS << 5)))
+	{
+		cache->window[offset >> 5] |= (1L << (offset & 0x1f));
+	}
+}
+
+/****************************************************************************/
+/*																			*/
+
+JAM_RETURN_TYPE jam_fill_array_cache
+(
+	JAMS_HEAP_RECORD *heap_record,
+	long first_word,
+	BOOL validate
+)
+
+/*																			*/
+/*	Description:	Decodes BIN, HEX or RLC data of a cached array into		*/
+/*					the window starting at array word "first_word".  If		*/
+/*					"validate" is TRUE, all of the data is read and			*/
+/*					checked, and the checkpoints are recorded.  Otherwise	*/
+/*					decoding starts at the nearest resume point and stops	*/
+/*					at the end of the window, and the file pointer is		*/
+/*					restored to jam_current_file_position.					*/
+/*																			*/
+/*	Returns:		JAMC_SUCCESS for success, else appropriate error code	*/
+/*																			*/
+/****************************************************************************/
+{
+	int ch = 0;
+	int count_index = 0;
+	int count_size = 0;
+	int value = 0;
+	long data = 0L;
+	long bit = 0L;
+	long run = 0L;
+	long count = 0L;
+	long index = 0L;
+	long position = 0L;
+	long stream_bits = 0L;
+	long first_bit = 0L;
+	long last_bit = 0L;
+	long array_bits = 0L;
+	BOOL done = FALSE;
+	JAME_RLC_BLOCK_TYPE block_type = JAM_CONSTANT_ZEROS;
+	JAMS_ARRAY_CACHE *cache = (JAMS_ARRAY_CACHE *) &heap_record->data[0];
+	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+
+	if (heap_record->rep == JAM_BOOL_HEX)
+	{
+		stream_bits = ((heap_record->dimension >> 2) +
+			((heap_record->dimension & 3) ? 1 : 0)) * 4L;
+	}
+	else
+	{
+		stream_bits = heap_record->dimension;
+	}
+
+	/*
+	*	Find the range of stream bits which covers the window, rounded
+	*	out to whole hex digits
+	*/
+	array_bits = (first_word + JAMC_CACHE_WINDOW_WORDS) << 5;
+	if (array_bits > stream_bits) array_bits = stream_bits;
+	first_bit = jam_get_cache_array_bit(heap_record, first_word << 5);
+	last_bit = jam_get_cache_array_bit(heap_record, array_bits - 1L);
+	if (first_bit > last_bit)
+	{
+		data = first_bit;
+		first_bit = last_bit;
+		last_bit = data;
+	}
+	first_bit &= ~3L;
+	last_bit |= 3L;
+
+	if (validate)
+	{
+		/* read all of the data from the beginning */
+		position = heap_record->position;
+		bit = 0L;
+		cache->checkpoint_count = 0L;
+	}
+	else
+	{
+		/* find the last checkpoint at or before the window */
+		for (index = 0L; index < cache->checkpoint_count; ++index)
+		{
+			if (cache->checkpoint_bit[index] <= first_bit)
+			{
+				position = cache->checkpoint_position[index];
+				bit = cache->checkpoint_bit[index];
+			}
+		}
+
+		/* the last fill may have stopped closer to the window */
+		if ((cache->cursor_bit <= first_bit) && (cache->cursor_bit > bit))
+		{
+			position = cache->cursor_position;
+			bit = cache->cursor_bit;
+		}
+	}
+
+	cache->window_start = first_word;
+	for (index = 0L; index < JAMC_CACHE_WINDOW_WORDS; ++index)
+	{
+		cache->window[index] = 0L;
+	}
+
+	if (jam_seek(position) != 0)
+	{
+		status = JAMC_IO_ERROR;
+	}
+
+	while ((status == JAMC_SUCCESS) && (!done))
+	{
+		if (validate && (cache->checkpoint_count < JAMC_CACHE_CHECKPOINTS) &&
+			(bit >= cache->checkpoint_count * cache->checkpoint_bits))
+		{
+			cache->checkpoint_position[cache->checkpoint_count] = position;
+			cache->checkpoint_bit[cache->checkpoint_count] = bit;
+			++cache->checkpoint_count;
+		}
+
+		if ((bit >= stream_bits) || ((!validate) && (bit > last_bit)))
+		{
+			/* remember where to resume if the next window follows */
+			cache->cursor_position = position;
+			cache->cursor_bit = bit;
+			done = TRUE;
+		}
+		else if (heap_record->rep == JAM_BOOL_BINARY)
+		{
+			ch = jam_get_cache_char(&position);
+
+			if ((ch == '0') || (ch == '1'))
+			{
+				if (ch == '1') jam_set_cache_bit(heap_record, bit);
+				++bit;
+			}
+			else
+			{
+				status = JAMC_SYNTAX_ERROR;
+			}
+
+			if (ch == EOF)
+			{
+				/* end of file */
+				status = JAMC_UNEXPECTED_END;
+			}
+		}
+		else if (heap_record->rep == JAM_BOOL_HEX)
+		{
+			ch = jam_get_cache_char(&position);
+
+			data = ((ch >= 0) && (ch < 256)) ? jam_hex_table[ch] : -1L;
+
+			if (data < 0)
+			{
+				status = JAMC_SYNTAX_ERROR;
+			}
+			else
+			{
+				for (index = 0L; index < 4L; ++index)
+				{
+					if (data & (1L << index))
+					{
+						jam_set_cache_bit(heap_record, bit + index);
+					}
+				}
+				bit += 4L;
+			}
+
+			if (ch == EOF)
+			{
+				/* end of file */
+				status = JAMC_UNEXPECTED_END;
+			}
+		}
+		else if (heap_record->rep == JAM_BOOL_RUN_LENGTH)
+		{
+			if (jam_rlc_key_char(jam_get_cache_char(&position),
+				&block_type, &count_size))
+			{
+				count = 0L;
+				for (count_index = 0; count_index < count_size; ++count_index)
+				{
+					count <<= 6;
+					value = jam_6bit_char(jam_get_cache_char(&position));
+					if (value == -1)
+					{
+						status = JAMC_SYNTAX_ERROR;
+					}
+					else
+					{
+						count += (long) value;
+					}
+				}
+
+				if (bit + count > stream_bits)
+				{
+					/* block runs past the end of the array */
+					status = JAMC_SYNTAX_ERROR;
+				}
+
+				for (run = 0L; (status == JAMC_SUCCESS) && (run < count); ++run)
+				{
+					if (block_type == JAM_CONSTANT_ONES)
+					{
+						jam_set_cache_bit(heap_record, bit);
+					}
+					else if (block_type == JAM_RANDOM)
+					{
+						if ((run % 6) == 0)
+						{
+							value = jam_6bit_char(jam_get_cache_char(&position));
+
+							if (value == -1)
+							{
+								status = JAMC_SYNTAX_ERROR;
+							}
+						}
+
+						if (value & (1 << ((int) (run % 6))))
+						{
+							jam_set_cache_bit(heap_record, bit);
+						}
+					}
+					++bit;
+				}
+			}
+			else
+			{
+				/* unrecognized key character */
+				status = JAMC_SYNTAX_ERROR;
+			}
+		}
+		else
+		{
+			status = JAMC_INTERNAL_ERROR;
+		}
+	}
+
+	/*
+	*	BIN and RLC data must be followed by the semicolon
+	*/
+	if ((status == JAMC_SUCCESS) && validate &&
+		(heap_record->rep != JAM_BOOL_HEX))
+	{
+		ch = jam_get_cache_char(&position);
+
+		if ((ch == EOF) && (heap_record->rep == JAM_BOOL_RUN_LENGTH))
+		{
+			status = JAMC_UNEXPECTED_END;
+		}
+		else if (ch != JAMC_SEMICOLON_CHAR)
+		{
+			status = JAMC_SYNTAX_ERROR;
+		}
+	}
+
+	if (status != JAMC_SUCCESS)
+	{
+		cache->window_start = -1L;
+	}
+
+	if ((!validate) && (jam_seek(jam_current_file_position) != 0) &&
+		(status == JAMC_SUCCESS))
+	{
+		status = JAMC_IO_ERROR;
+	}
+
+	return (status);
+}
+
+/****************************************************************************/
+/*																			*/
+
+long jam_get_aca_cache_bits
+(
+	JAMS_ACA_CACHE *cache,
+	int bits
+)
+
+/*																			*/
+/*	Description:	Reads the next "bits" bits (at most 16) of ACA data		*/
+/*					from the input stream.  After the semicolon, the last	*/
+/*					byte of the data is padded with zeros.					*/
+/*																			*/
+/*	Returns:		value of the bits, or -1 if data is exhausted or not	*/
+/*					valid													*/
+/*																			*/
+/****************************************************************************/
+{
+	int ch = 0;
+	int value = 0;
+	long result = -1L;
+
+	while ((cache->bit_count < bits) && (!cache->end))
+	{
+		ch = jam_get_cache_char(&cache->position);
+		value = ((ch >= 0) && (ch < 256)) ? jam_6bit_table[ch] : -1;
+
+		if (ch == JAMC_SEMICOLON_CHAR)
+		{
+			/* pad to a whole number of bytes */
+			cache->bit_count += (int) ((8L - ((cache->char_count * 6L) & 7L)) & 7L);
+			cache->end = TRUE;
+		}
+		else if (value < 0)
+		{
+			/* illegal character -- no more data can be read */
+			cache->bit_count = 0;
+			cache->end = TRUE;
+		}
+		else
+		{
+			cache->bits |= ((unsigned long) value) << cache->bit_count;
+			cache->bit_count += 6;
+			++cache->char_count;
+		}
+	}
+
+	if (cache->bit_count >= bits)
+	{
+		result = (long) (cache->bits & ((1UL << bits) - 1UL));
+		cache->bits >>= bits;
+		cache->bit_count -= bits;
+	}
+
+	return (result);
+}
+
+/****************************************************************************/
+/*																			*/
+
+JAM_RETURN_TYPE jam_restart_aca_cache
+(
+	JAMS_HEAP_RECORD *heap_record
+)
+
+/*																			*/
+/*	Description:	Resets the decoder of a cached ACA array to the			*/
+/*					beginning of the data, and reads the length field.		*/
+/*																			*/
+/*	Returns:		JAMC_SUCCESS for success, else appropriate error code	*/
+/*																			*/
+/****************************************************************************/
+{
+	int i = 0;
+	long value = 0L;
+	long data_length = 0L;
+	JAMS_ACA_CACHE *cache = (JAMS_ACA_CACHE *) &heap_record->data[0];
+	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+
+	cache->data_length = (heap_record->dimension >> 3) +
+		((heap_record->dimension & 7) ? 1 : 0);
+	cache->out_index = 0L;
+	cache->position = heap_record->position;
+	cache->char_count = 0L;
+	cache->bits = 0L;
+	cache->bit_count = 0;
+	cache->offset_bits = 1;
+	cache->end = FALSE;
+	cache->literal = FALSE;
+	cache->offset = 0L;
+	cache->count = 0L;
+
+	if (jam_seek(cache->position) != 0)
+	{
+		status = JAMC_IO_ERROR;
+	}
+
+	/* the length field must match the size of the array */
+	for (i = 0; (status == JAMC_SUCCESS) && (i < 4); ++i)
+	{
+		value = jam_get_aca_cache_bits(cache, 8);
+
+		if (value == -1L)
+		{
+			status = JAMC_SYNTAX_ERROR;
+		}
+		else
+		{
+			data_length |= value << (i * 8);
+		}
+	}
+
+	if ((status == JAMC_SUCCESS) && (data_length != cache->data_length))
+	{
+		status = JAMC_SYNTAX_ERROR;
+	}
+
+	return (status);
+}
+
+/****************************************************************************/
+/*																			*/
+
+JAM_RETURN_TYPE jam_decode_aca_cache
+(
+	JAMS_HEAP_RECORD *heap_record,
+	long end_index
+)
+
+/*																			*/
+/*	Description:	Resumes the decoder of a cached ACA array, until		*/
+/*					"end_index" bytes have been decoded.  Works like		*/
+/*					jam_uncompress(), but keeps only the last				*/
+/*					JAMC_ACA_HISTORY_SIZE bytes of output.					*/
+/*																			*/
+/*	Returns:		JAMC_SUCCESS for success, else appropriate error code	*/
+/*																			*/
+/****************************************************************************/
+{
+	long value = 0L;
+	long length = 0L;
+	long limit = 0L;
+	long match_data_length = (jam_version == 2) ? 8191L : 8192L;
+	JAMS_ACA_CACHE *cache = (JAMS_ACA_CACHE *) &heap_record->data[0];
+	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+
+	if (end_index > cache->data_length) end_index = cache->data_length;
+
+	if (jam_seek(cache->position) != 0)
+	{
+		status = JAMC_IO_ERROR;
+	}
+
+	while ((status == JAMC_SUCCESS) && (cache->out_index < end_index))
+	{
+		if (cache->count == 0L)
+		{
+			/* a 0 bit indicates literal data, a 1 bit a match */
+			value = jam_get_aca_cache_bits(cache, 1);
+
+			if (value == 0L)
+			{
+				cache->literal = TRUE;
+				cache->count = cache->data_length - cache->out_index;
+				if (cache->count > 3L) cache->count = 3L;
+			}
+			else if (value == 1L)
+			{
+				limit = (cache->out_index > match_data_length) ?
+					match_data_length : cache->out_index;
+				while ((limit >> cache->offset_bits) != 0) ++cache->offset_bits;
+
+				value = jam_get_aca_cache_bits(cache, cache->offset_bits);
+				length = jam_get_aca_cache_bits(cache, 8);
+
+				if ((value == -1L) || (length == -1L) ||
+					(value > cache->out_index))
+				{
+					status = JAMC_SYNTAX_ERROR;
+				}
+				else
+				{
+					cache->literal = FALSE;
+					cache->offset = value;
+					cache->count = cache->data_length - cache->out_index;
+					if (cache->count > length) cache->count = length;
+				}
+			}
+			else
+			{
+				status = JAMC_SYNTAX_ERROR;
+			}
+		}
+		else
+		{
+			if (cache->literal)
+			{
+				value = jam_get_aca_cache_bits(cache, 8);
+
+				if (value == -1L)
+				{
+					status = JAMC_SYNTAX_ERROR;
+				}
+			}
+			else if (cache->offset == 0L)
+			{
+				/* a zero offset copies bytes not yet written, which are 0 */
+				value = 0L;
+			}
+			else
+			{
+				value = (long) cache->history[(cache->out_index -
+					cache->offset) & (JAMC_ACA_HISTORY_SIZE - 1)];
+			}
+
+			if (status == JAMC_SUCCESS)
+			{
+				cache->history[cache->out_index & (JAMC_ACA_HISTORY_SIZE - 1)] =
+					(unsigned char) value;
+				++cache->out_index;
+				--cache->count;
+			}
+		}
+	}
+
+	return (status);
+}
+
+/****************************************************************************/
+/*																			*/
+
+JAM_RETURN_TYPE jam_init_array_cache
+(
+	JAMS_HEAP_RECORD *heap_record
+)
+
+/*																			*/
+/*	Description:	Reads and checks all of the initialization data of a	*/
+/*					cached array, and sets up its cache buffer.				*/
+/*																			*/
+/*	Returns:		JAMC_SUCCESS for success, else appropriate error code	*/
+/*																			*/
+/****************************************************************************/
+{
+	int ch = 0;
+	long stream_bits = heap_record->dimension;
+	JAMS_ARRAY_CACHE *cache = (JAMS_ARRAY_CACHE *) &heap_record->data[0];
+	JAMS_ACA_CACHE *aca_cache = (JAMS_ACA_CACHE *) &heap_record->data[0];
+	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+
+	if (heap_record->rep == JAM_BOOL_COMPRESSED)
+	{
+		/*
+		*	Decode all of the data once to check it.  The rest of the
+		*	characters up to the semicolon must also be legal.
+		*/
+		status = jam_restart_aca_cache(heap_record);
+
+		if (status == JAMC_SUCCESS)
+		{
+			status = jam_decode_aca_cache(heap_record, aca_cache->data_length);
+		}
+
+		while ((status == JAMC_SUCCESS) && (!aca_cache->end))
+		{
+			ch = jam_get_cache_char(&aca_cache->position);
+
+			if (ch == JAMC_SEMICOLON_CHAR)
+			{
+				aca_cache->end = TRUE;
+			}
+			else if ((ch < 0) || (ch >= 256) || (jam_6bit_table[ch] < 0))
+			{
+				status = JAMC_SYNTAX_ERROR;
+			}
+		}
+	}
+	else
+	{
+		if (heap_record->rep == JAM_BOOL_HEX)
+		{
+			stream_bits = ((heap_record->dimension >> 2) +
+				((heap_record->dimension & 3) ? 1 : 0)) * 4L;
+		}
+
+		/* spread the checkpoints over the data, one window apart at least */
+		cache->checkpoint_bits = (stream_bits + JAMC_CACHE_CHECKPOINTS - 1) /
+			JAMC_CACHE_CHECKPOINTS;
+		if (cache->checkpoint_bits < (JAMC_CACHE_WINDOW_WORDS << 5))
+		{
+			cache->checkpoint_bits = JAMC_CACHE_WINDOW_WORDS << 5;
+		}
+
+		status = jam_fill_array_cache(heap_record, 0L, TRUE);
+	}
+
+	return (status);
+}
+
+/****************************************************************************/
+/*																			*/
+
+int jam_decode_array_text
+(
+	void *argument
+)
+
+/*																			*/
+/*	Description:	Decodes the data of a pending Boolean array from the	*/
+/*					program text in memory.  It may run in the background,	*/
+/*					started by jam_start_work(), so it must not use the		*/
+/*					input stream or change any global state.  The data is	*/
+/*					copied up to the semicolon, leaving out white space so	*/
+/*					that its length is not limited by the statement buffer	*/
+/*					size, and then extracted from the copy.					*/
+/*																			*/
+/*	Returns:		JAMC_SUCCESS for success, else appropriate error code	*/
+/*																			*/
+/****************************************************************************/
+{
+	long index = 0L;
+	long length = 0L;
+	long count = 0L;
+	char *buffer = NULL;
+	JAMS_HEAP_RECORD *heap_record = (JAMS_HEAP_RECORD *) argument;
+	char *text = &jam_program[heap_record->position];
+	long size = jam_program_size - heap_record->position;
+	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+
+	while ((length < size) && (text[length] != JAMC_SEMICOLON_CHAR))
+	{
+		++length;
+	}
+
+	if (length >= size)
+	{
+		status = JAMC_UNEXPECTED_END;
+	}
+	else
+	{
+		buffer = (char *) jam_malloc((unsigned int) (length + 2));
+
+		if (buffer == NULL)
+		{
+			status = JAMC_OUT_OF_MEMORY;
+		}
+		else
+		{
+			/* copy the data and the semicolon */
+			for (index = 0L; index <= length; ++index)
+			{
+				if (!jam_isspace(text[index]))
+				{
+					buffer[count] = text[index];
+					++count;
+				}
+			}
+			buffer[count] = JAMC_NULL_CHAR;
+		}
+	}
+
+	if (status == JAMC_SUCCESS)
+	{
+		switch (heap_record->rep)
+		{
+		case JAM_BOOL_BINARY:
+			status = jam_extract_bool_binary(heap_record, buffer);
+			break;
+
+		case JAM_BOOL_HEX:
+			status = jam_extract_bool_hex(heap_record, buffer);
+			break;
+
+		case JAM_BOOL_RUN_LENGTH:
+			status = jam_extract_bool_run_length(heap_record, buffer);
+			break;
+
+		case JAM_BOOL_COMPRESSED:
+			status = jam_extract_bool_compressed(heap_record, buffer);
+			break;
+
+		default:
+			status = JAMC_INTERNAL_ERROR;
+		}
+	}
+
+	/* in Jam 2.0, Boolean arrays in BIN and HEX format are reversed */
+	if ((status == JAMC_SUCCESS) && (jam_version == 2) &&
+		(heap_record->rep == JAM_BOOL_BINARY))
+	{
+		status = jam_reverse_boolean_array_bin(heap_record);
+	}
+
+	if ((status == JAMC_SUCCESS) && (jam_version == 2) &&
+		(heap_record->rep == JAM_BOOL_HEX))
+	{
+		status = jam_reverse_boolean_array_hex(heap_record);
+	}
+
+	if (buffer != NULL) jam_free(buffer);
+
+	return ((int) status);
+}
+
+/****************************************************************************/
+/*																			*/
+
+JAM_RETURN_TYPE jam_decode_array_data
+(
+	JAMS_HEAP_RECORD *heap_record
+)
+
+/*																			*/
+/*	Description:	Decodes the initialization data of a Boolean array		*/
+/*					which was left undecoded when it was declared.  This	*/
+/*					is done when the array is first used.  If decoding was	*/
+/*					started in the background, its result is waited for		*/
+/*					and used if it succeeded.  Otherwise the data is		*/
+/*					decoded from the program text in memory, or if that		*/
+/*					fails, read from the input stream so that any error is	*/
+/*					reported as usual.  The file pointer is then restored	*/
+/*					to jam_current_file_position.							*/
+/*																			*/
+/*	Returns:		JAMC_SUCCESS for success, else appropriate error code	*/
+/*																			*/
+/****************************************************************************/
+{
+	long word_count = 0L;
+	BOOL decoded = FALSE;
+	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+	int profile_phase = JAMC_PROFILE_EXECUTE;
+
+	if (jam_profiling) profile_phase = jam_profile_phase(JAMC_PROFILE_DECODE);
+
+	word_count = (heap_record->dimension >> 5) +
+		((heap_record->dimension & 0x1f) ? 1 : 0);
+
+	if (heap_record->work != NULL)
+	{
+		if (jam_finish_work(heap_record->work) == JAMC_SUCCESS)
+		{
+			heap_record->pending = FALSE;
+			jam_write_array_cache(heap_record->position,
+				heap_record->dimension, &heap_record->data[0], word_count);
+		}
+
+		/* if it failed, decode it again below to report the error */
+		heap_record->work = NULL;
+	}
+
+	if (heap_record->pending && heap_record->cached)
+	{
+		heap_record->pending = FALSE;
+		status = jam_init_array_cache(heap_record);
+
+		if ((jam_seek(jam_current_file_position) != 0) &&
+			(status == JAMC_SUCCESS))
+		{
+			status = JAMC_IO_ERROR;
+		}
+	}
+	else if (heap_record->pending)
+	{
+		heap_record->pending = FALSE;
+
+		if ((jam_program != NULL) &&
+			(jam_decode_array_text((void *) heap_record) == JAMC_SUCCESS))
+		{
+			decoded = TRUE;
+		}
+
+		if (!decoded)
+		{
+			switch (heap_record->rep)
+			{
+			case JAM_BOOL_BINARY:
+				status = jam_read_bool_binary(heap_record);
+				break;
+
+			case JAM_BOOL_HEX:
+				status = jam_read_bool_hex(heap_record);
+				break;
+
+			case JAM_BOOL_RUN_LENGTH:
+				status = jam_read_bool_run_length(heap_record);
+				break;
+
+			case JAM_BOOL_COMPRESSED:
+				status = jam_read_bool_compressed(heap_record);
+				break;
+
+			default:
+				status = JAMC_INTERNAL_ERROR;
+			}
+		}
+
+		/* in Jam 2.0, Boolean arrays in BIN and HEX format are reversed */
+		if ((status == JAMC_SUCCESS) && !decoded && (jam_version == 2) &&
+			(heap_record->rep == JAM_BOOL_BINARY))
+		{
+			status = jam_reverse_boolean_array_bin(heap_record);
+		}
+
+		if ((status == JAMC_SUCCESS) && !decoded && (jam_version == 2) &&
+			(heap_record->rep == JAM_BOOL_HEX))
+		{
+			status = jam_reverse_boolean_array_hex(heap_record);
+		}
+
+		if (status == JAMC_SUCCESS)
+		{
+			jam_write_array_cache(heap_record->position,
+				heap_record->dimension, &heap_record->data[0], word_count);
+		}
+
+		if ((jam_seek(jam_current_file_position) != 0) &&
+			(status == JAMC_SUCCESS))
+		{
+			status = JAMC_IO_ERROR;
+		}
+	}
+
+	if (jam_profiling) jam_profile_phase(profile_phase);
+
+	return (status);
+}
+
+/****************************************************************************/
+/*																			*/
+
+JAM_RETURN_TYPE jam_read_boolean_array_data
+(
+	JAMS_HEAP_RECORD *heap_record,
+	char *statement_buffer
+)
+
+/*																			*/
+/*	Description:	Reads Boolean array initialization data.  If it is all	*/
+/*					present in the statement buffer, then it is extracted	*/
+/*					from the buffer.  If the array initialization data did	*/
+/*					not fit into the statement buffer, it is read directly	*/
+/*					from the input stream.  Five formats of Boolean array	*/
+/*					initialization data are supported:  comma-separated		*/
+/*					values (the default), and BIN, HEX, RLC, and ACA.		*/
+/*					Large arrays in BIN, HEX, RLC or ACA format are not		*/
+/*					decoded here.  Only the position of their data is		*/
+/*					kept, and jam_decode_array_data() is called when they	*/
+/*					are first used.											*/
+/*																			*/
+/*	Returns:		JAMC_SUCCESS for success, else appropriate error code	*/
+/*																			*/
+/****************************************************************************/
+{
+	int index = 0;
+	int ch = 0;
+	int rep = 0;
+	int length = 0;
+	int data_offset = 0;
+	long position = 0L;
+	long data_position = 0L;
+	BOOL done = FALSE;
+	BOOL comment = FALSE;
+	BOOL found_equal = FALSE;
+	BOOL found_space = FALSE;
+	BOOL found_keyword = FALSE;
+	BOOL data_complete = FALSE;
+	BOOL lazy = FALSE;
+	long word_count = 0L;
+	long data_size = 0L;
+	JAME_BOOLEAN_REP representation = JAM_ILLEGAL_REP;
+	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+	int profile_phase = JAMC_PROFILE_EXECUTE;
+
+	if (jam_profiling) profile_phase = jam_profile_phase(JAMC_PROFILE_DECODE);
+
+	while ((jam_isspace(statement_buffer[index])) &&
+		(index < JAMC_MAX_STATEMENT_LENGTH))
+	{
+		++index;	/* skip over white space */
+	}
+
+	/*
+	*	Figure out which data representation scheme is used
+	*/
+	if (jam_version == 2)
+	{
+		if (statement_buffer[index] == JAMC_POUND_CHAR)
+		{
+			representation = JAM_BOOL_BINARY;
+			data_offset = index + 1;
+		}
+		else if (statement_buffer[index] == JAMC_DOLLAR_CHAR)
 		{
 			representation = JAM_BOOL_HEX;
 			data_offset = index + 1;
@@ -1382,10 +2555,44 @@ JAM_RETURN_TYPE jam_read_boolean_array_data
 		}
 	}
 
+	/*
+	*	Comma separated data may refer to variables, so a cached array in
+	*	that format must be stored in full.  ACA data needs a larger cache
+	*	buffer, which is only used if the array is larger still.
+	*/
+	if ((status == JAMC_SUCCESS) && heap_record->cached)
+	{
+		data_size = ((heap_record->dimension >> 5) +
+			((heap_record->dimension & 0x1f) ? 1 : 0)) * sizeof(long);
+
+		if ((representation == JAM_BOOL_COMMA_SEP) ||
+			((representation == JAM_BOOL_COMPRESSED) &&
+			(data_size <= (long) sizeof(JAMS_ACA_CACHE))))
+		{
+			status = jam_resize_heap_record(heap_record, data_size, FALSE);
+		}
+		else if (representation == JAM_BOOL_COMPRESSED)
+		{
+			status = jam_resize_heap_record(heap_record,
+				(long) sizeof(JAMS_ACA_CACHE), TRUE);
+		}
+	}
+
+	/*
+	*	Data in BIN, HEX, RLC or ACA format does not depend on any
+	*	variables, so decoding of large arrays can wait until they are used
+	*/
+	if ((status == JAMC_SUCCESS) && (representation != JAM_BOOL_COMMA_SEP) &&
+		(heap_record->cached ||
+		(heap_record->dimension > JAMC_LAZY_ARRAY_SIZE)))
+	{
+		lazy = TRUE;
+	}
+
 	/*
 	*	See if all the initialization data is present in the statement buffer
 	*/
-	if ((status == JAMC_SUCCESS) && !heap_record->cached)
+	if ((status == JAMC_SUCCESS) && !lazy)
 	{
 		while ((statement_buffer[index] != JAMC_NULL_CHAR) &&
 			(statement_buffer[index] != JAMC_SEMICOLON_CHAR) &&
@@ -1401,10 +2608,10 @@ JAM_RETURN_TYPE jam_read_boolean_array_data
 	}
 
 	/*
-	*	If data is not all present in the statement buffer, or if data
-	*	will be cached, find the position of the data in the input file
+	*	If data is not all present in the statement buffer, or if it
+	*	will be decoded later, find the position of the data in the input file
 	*/
-	if ((status == JAMC_SUCCESS) && ((!data_complete) || heap_record->cached))
+	if ((status == JAMC_SUCCESS) && !data_complete)
 	{
 		/*
 		*	Get position offset of initialization data
@@ -1507,10 +2714,32 @@ JAM_RETURN_TYPE jam_read_boolean_array_data
 			heap_record->position = data_position;
 		}
 
-		/*
-		*	If data will not be cached, read it in from the file now.
-		*/
-		if ((status == JAMC_SUCCESS) && !heap_record->cached)
+		if ((status == JAMC_SUCCESS) && lazy)
+		{
+			/*
+			*	Data will be decoded when the array is first used, unless
+			*	it is in the decoded array cache.  If the host can do the
+			*	work in the background, decoding is started now.
+			*/
+			word_count = (heap_record->dimension >> 5) +
+				((heap_record->dimension & 0x1f) ? 1 : 0);
+
+			if (heap_record->cached ||
+				(jam_read_array_cache(heap_record->position,
+				heap_record->dimension, &heap_record->data[0],
+				word_count) != 0))
+			{
+				heap_record->pending = TRUE;
+			}
+
+			if (heap_record->pending && !heap_record->cached &&
+				(jam_program != NULL))
+			{
+				heap_record->work = jam_start_work(jam_decode_array_text,
+					(void *) heap_record);
+			}
+		}
+		else if (status == JAMC_SUCCESS)
 		{
 			/*
 			*	Data is present, and will not be cached.  Read it in.
@@ -1593,18 +2822,20 @@ JAM_RETURN_TYPE jam_read_boolean_array_data
 	}
 
 	/* in Jam 2.0, Boolean arrays in BIN and HEX format are reversed */
-	if ((status == JAMC_SUCCESS) && (jam_version == 2) &&
-		(representation == JAM_BOOL_BINARY))
+	if ((status == JAMC_SUCCESS) && !lazy &&
+		(jam_version == 2) && (representation == JAM_BOOL_BINARY))
 	{
 		status = jam_reverse_boolean_array_bin(heap_record);
 	}
 
-	if ((status == JAMC_SUCCESS) && (jam_version == 2) &&
-		(representation == JAM_BOOL_HEX))
+	if ((status == JAMC_SUCCESS) && !lazy &&
+		(jam_version == 2) && (representation == JAM_BOOL_HEX))
 	{
 		status = jam_reverse_boolean_array_hex(heap_record);
 	}
 
+	if (jam_profiling) jam_profile_phase(profile_phase);
+
 	return (status);
 }
 
@@ -1989,6 +3220,160 @@ JAM_RETURN_TYPE jam_read_integer_array_data
 /****************************************************************************/
 /*																			*/
 
+JAM_RETURN_TYPE jam_get_cached_array_word
+(
+	JAMS_HEAP_RECORD *heap_record,
+	long word,
+	long *value
+)
+
+/*																			*/
+/*	Description:	Gets one 32-bit word of a cached Boolean array, from	*/
+/*					the window if possible, else by decoding more data.		*/
+/*																			*/
+/*	Returns:		JAMC_SUCCESS for success, else appropriate error code	*/
+/*																			*/
+/****************************************************************************/
+{
+	long index = 0L;
+	long first_word = 0L;
+	long end_index = 0L;
+	BOOL seek = FALSE;
+	JAMS_ARRAY_CACHE *cache = (JAMS_ARRAY_CACHE *) &heap_record->data[0];
+	JAMS_ACA_CACHE *aca_cache = (JAMS_ACA_CACHE *) &heap_record->data[0];
+	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+
+	if (heap_record->rep == JAM_BOOL_COMPRESSED)
+	{
+		index = word * 4L;
+		end_index = index + 4L;
+		if (end_index > aca_cache->data_length)
+		{
+			end_index = aca_cache->data_length;
+		}
+
+		if (index < aca_cache->out_index - JAMC_ACA_HISTORY_SIZE)
+		{
+			/* the data has left the history -- start again */
+			status = jam_restart_aca_cache(heap_record);
+			seek = TRUE;
+		}
+
+		if ((status == JAMC_SUCCESS) && (end_index > aca_cache->out_index))
+		{
+			/* decode ahead, keeping half the history behind this word */
+			status = jam_decode_aca_cache(heap_record,
+				end_index + (JAMC_ACA_HISTORY_SIZE / 2));
+			seek = TRUE;
+		}
+
+		if (seek && (jam_seek(jam_current_file_position) != 0) &&
+			(status == JAMC_SUCCESS))
+		{
+			status = JAMC_IO_ERROR;
+		}
+
+		if (status == JAMC_SUCCESS)
+		{
+			*value = 0L;
+			for (; index < end_index; ++index)
+			{
+				*value |= ((long) aca_cache->history[index &
+					(JAMC_ACA_HISTORY_SIZE - 1)]) << ((index & 3) << 3);
+			}
+		}
+	}
+	else
+	{
+		if ((cache->window_start < 0L) || (word < cache->window_start) ||
+			(word >= cache->window_start + JAMC_CACHE_WINDOW_WORDS))
+		{
+			/* place the new window so that it extends the way we moved */
+			first_word = word;
+			if (word < cache->window_start)
+			{
+				first_word = word + 1L - JAMC_CACHE_WINDOW_WORDS;
+				if (first_word < 0L) first_word = 0L;
+			}
+
+			status = jam_fill_array_cache(heap_record, first_word, FALSE);
+		}
+
+		if (status == JAMC_SUCCESS)
+		{
+			*value = cache->window[word - cache->window_start];
+		}
+	}
+
+	return (status);
+}
+
+/****************************************************************************/
+/*																			*/
+
+JAM_RETURN_TYPE jam_get_cached_array_data
+(
+	JAMS_HEAP_RECORD *heap_record,
+	long first_bit,
+	long last_bit,
+	long *data
+)
+
+/*																			*/
+/*	Description:	Copies elements first_bit through last_bit of a cached	*/
+/*					Boolean array into "data", starting at bit 0.			*/
+/*																			*/
+/*	Returns:		JAMC_SUCCESS for success, else appropriate error code	*/
+/*																			*/
+/****************************************************************************/
+{
+	int shift = 0;
+	long word = 0L;
+	long index = 0L;
+	long low = 0L;
+	long high = 0L;
+	long count = last_bit - first_bit + 1L;
+	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+
+	if ((first_bit < 0L) || (first_bit > last_bit) ||
+		(last_bit >= heap_record->dimension))
+	{
+		status = JAMC_BOUNDS_ERROR;
+	}
+
+	for (index = 0L; (status == JAMC_SUCCESS) && (index < count); index += 32L)
+	{
+		word = (first_bit + index) >> 5;
+		shift = (int) ((first_bit + index) & 0x1f);
+		high = 0L;
+
+		status = jam_get_cached_array_word(heap_record, word, &low);
+
+		if ((status == JAMC_SUCCESS) && (shift != 0) &&
+			(((word + 1L) << 5) <= last_bit))
+		{
+			status = jam_get_cached_array_word(heap_record, word + 1L, &high);
+		}
+
+		if (status == JAMC_SUCCESS)
+		{
+			data[index >> 5] = (long) ((((unsigned long) low) >> shift) |
+				((shift == 0) ? 0UL : (((unsigned long) high) << (32 - shift))));
+		}
+	}
+
+	if ((status == JAMC_SUCCESS) && ((count & 0x1f) != 0))
+	{
+		/* clear the bits after the last element */
+		data[count >> 5] &= (long) ((1UL << (count & 0x1f)) - 1UL);
+	}
+
+	return (status);
+}
+
+/****************************************************************************/
+/*																			*/
+
 JAM_RETURN_TYPE jam_get_array_value
 (
 	JAMS_SYMBOL_RECORD *symbol_record,
@@ -2031,6 +3416,11 @@ JAM_RETURN_TYPE jam_get_array_value
 			status = JAMC_BOUNDS_ERROR;
 		}
 
+		if ((status == JAMC_SUCCESS) && heap_record->pending)
+		{
+			status = jam_decode_array_data(heap_record);
+		}
+
 		if (status == JAMC_SUCCESS)
 		{
 			heap_data = &heap_record->data[0];
@@ -2061,9 +3451,13 @@ JAM_RETURN_TYPE jam_get_array_value
 				else
 				{
 					/* get data from cache */
+					status = jam_get_cached_array_word(heap_record,
+						index >> 5, value);
 
-					/* cache not implemented yet! */
-					status = JAMC_INTERNAL_ERROR;
+					if (status == JAMC_SUCCESS)
+					{
+						*value = (*value & (1L << (index & 0x1f))) ? 1 : 0;
+					}
 				}
 			}
 			else
@@ -23,6 +23,11 @@ JAM_RETURN_TYPE jam_read_boolean_array_data
 	char *statement_buffer
 );
 
+JAM_RETURN_TYPE jam_decode_array_data
+(
+	JAMS_HEAP_RECORD *heap_record
+);
+
 JAM_RETURN_TYPE jam_read_integer_array_data
 (
 	JAMS_HEAP_RECORD *heap_record,
@@ -36,4 +41,19 @@ JAM_RETURN_TYPE jam_get_array_value
 	long *value
 );
 
+JAM_RETURN_TYPE jam_get_cached_array_word
+(
+	JAMS_HEAP_RECORD *heap_record,
+	long word,
+	long *value
+);
+
+JAM_RETURN_TYPE jam_get_cached_array_data
+(
+	JAMS_HEAP_RECORD *heap_record,
+	long first_bit,
+	long last_bit,
+	long *data
+);
+
 #endif	/* INC_JAMARRAY_H */
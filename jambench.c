@@ -0,0 +1,773 @@
+/****************************************************************************/
+/*																			*/
+/*	Module:			jambench.c												*/
+/*																			*/
+/*	Description:	Benchmark for the Jam player.  Writes a set of Jam		*/
+/*					programs which each stress one part of the player,		*/
+/*					runs them with the player built on the simulated		*/
+/*					JTAG chain of iosim.c, and reports statements and		*/
+/*					scan bits per second and the startup time, compared		*/
+/*					with a baseline saved from an earlier run.				*/
+/*																			*/
+/*					Usage: jambench [-s] <player> <baseline file>			*/
+/*																			*/
+/****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+typedef int BOOL;
+#define TRUE 1
+#define FALSE 0
+
+#define BENCH_DIRECTORY "bench"
+#define BENCH_REPEATS 5			/* runs of each program; the fastest counts */
+#define BENCH_LINE_LENGTH 4096
+#define BENCH_NAME_LENGTH 32
+#define BENCH_ARRAY_BITS 1048576L
+#define BENCH_ARRAY_STEP 4096L		/* the loops must end on their stop value */
+#define BENCH_SCAN_BITS 32768L
+#define BENCH_CALL_DEPTH 32
+#define BENCH_TEXT_WIDTH 72
+
+/************************************************************************
+*
+*	Workloads
+*
+*	Each workload is a Jam program written by write_workload().  The
+*	data in them comes from a fixed pseudo-random sequence, so that the
+*	programs are the same every time and their times can be compared
+*	with a baseline.  The startup workload does nothing, so its time is
+*	the cost of starting the player, loading the file and checking it.
+*/
+
+#define BENCH_STARTUP	0
+#define BENCH_DRSCAN	1
+#define BENCH_IRSCAN	2
+#define BENCH_LOOP		3
+#define BENCH_CALL		4
+#define BENCH_HEX		5
+#define BENCH_RLC		6
+#define BENCH_ACA		7
+#define BENCH_WAIT		8
+#define BENCH_WORKLOAD_COUNT 9
+
+char *workload_name[BENCH_WORKLOAD_COUNT] =
+{
+	"startup", "drscan", "irscan", "loop", "call", "hex", "rlc", "aca", "wait"
+};
+
+char *workload_description[BENCH_WORKLOAD_COUNT] =
+{
+	"empty program",
+	"long DRSCANs with capture",
+	"many short IRSCANs",
+	"tight FOR loops",
+	"deep CALL nesting",
+	"large HEX array",
+	"large RLC array (Jam 1)",
+	"large ACA array",
+	"many WAITs"
+};
+
+unsigned long bench_seed = 1UL;
+
+int bench_random(int range)
+{
+	bench_seed = bench_seed * 1103515245UL + 12345UL;
+
+	return ((int) ((bench_seed >> 16) & 0x7fffUL) % range);
+}
+
+/* fills bits[] with runs of zeros and ones, random bits and repeats */
+void make_bits(char *bits, long count)
+{
+	long i = 0L;
+	long j = 0L;
+	long run = 0L;
+	long back = 0L;
+	int kind = 0;
+	int bit = 0;
+
+	while (i < count)
+	{
+		kind = bench_random(10);
+		run = (long) bench_random(300) + 1L;
+		if (run > count - i) run = count - i;
+
+		if (kind < 5)
+		{
+			bit = (kind < 3) ? 0 : 1;
+			for (j = 0L; j < run; ++j) bits[i + j] = (char) bit;
+		}
+		else if ((kind < 7) && (i >= 8L))
+		{
+			back = ((long) bench_random(1000) % (i / 8L) + 1L) * 8L;
+			for (j = 0L; j < run; ++j) bits[i + j] = bits[i + j - back];
+		}
+		else
+		{
+			for (j = 0L; j < run; ++j) bits[i + j] = (char) bench_random(2);
+		}
+
+		i += run;
+	}
+}
+
+/************************************************************************
+*
+*	Array data encoders
+*
+*	The encoded text is written through put_text(), which breaks it into
+*	lines, and compressed data is packed into 6-bit characters, LSB
+*	first, through put_bits().
+*/
+
+FILE *text_fp = NULL;
+int text_column = 0;
+unsigned long text_bits = 0UL;
+int text_bit_count = 0;
+
+char base64_digits[] =
+	"0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz_@";
+
+void start_text(FILE *fp)
+{
+	text_fp = fp;
+	text_column = 0;
+	text_bits = 0UL;
+	text_bit_count = 0;
+}
+
+void put_text(int ch)
+{
+	if (text_column == BENCH_TEXT_WIDTH)
+	{
+		fputs("\n\t", text_fp);
+		text_column = 0;
+	}
+
+	fputc(ch, text_fp);
+	++text_column;
+}
+
+void put_bits(unsigned long value, int count)
+{
+	int i = 0;
+
+	for (i = 0; i < count; ++i)
+	{
+		text_bits |= ((value >> i) & 1UL) << text_bit_count;
+
+		if (++text_bit_count == 6)
+		{
+			put_text(base64_digits[text_bits]);
+			text_bits = 0UL;
+			text_bit_count = 0;
+		}
+	}
+}
+
+void finish_bits(void)
+{
+	if (text_bit_count > 0) put_bits(0UL, 6 - text_bit_count);
+}
+
+/* Jam 2 hex: the first digit holds the highest four bits */
+void write_hex(FILE *fp, char *bits, long count)
+{
+	long digit = 0L;
+	long i = 0L;
+	int value = 0;
+
+	start_text(fp);
+
+	for (digit = (count + 3L) / 4L - 1L; digit >= 0L; --digit)
+	{
+		value = 0;
+
+		for (i = digit * 4L + 3L; i >= digit * 4L; --i)
+		{
+			value = (value << 1) | (((i < count) && bits[i]) ? 1 : 0);
+		}
+
+		put_text("0123456789ABCDEF"[value]);
+	}
+}
+
+/* Jam 1 run length code: runs of zeros or ones, and literal blocks */
+void write_rlc_count(long count, int first)
+{
+	int size = 1;
+
+	while ((size < 5) && (count >= (1L << (6 * size)))) ++size;
+
+	put_text(first + size - 1);
+
+	while (size > 0)
+	{
+		--size;
+		put_text(base64_digits[(count >> (6 * size)) & 63L]);
+	}
+}
+
+long run_length(char *bits, long start, long count)
+{
+	long run = 1L;
+
+	while ((start + run < count) && (run < 60000L) &&
+		(bits[start + run] == bits[start])) ++run;
+
+	return (run);
+}
+
+void write_rlc(FILE *fp, char *bits, long count)
+{
+	long i = 0L;
+	long j = 0L;
+	long run = 0L;
+
+	start_text(fp);
+
+	while (i < count)
+	{
+		run = run_length(bits, i, count);
+
+		if (run >= 12L)
+		{
+			write_rlc_count(run, bits[i] ? 'I' : 'A');
+		}
+		else
+		{
+			/* a literal block runs until the next long run */
+			run = 0L;
+			while ((i + run < count) && (run < 4000L) &&
+				(run_length(bits, i + run, count) < 12L)) ++run;
+
+			write_rlc_count(run, 'Q');
+
+			for (j = 0L; j < run; ++j) put_bits((unsigned long) bits[i + j], 1);
+			finish_bits();
+		}
+
+		i += run;
+	}
+}
+
+/* Jam 2 ACA: a length, then literal byte triples and back references */
+void write_aca(FILE *fp, char *bits, long count)
+{
+	long length = (count + 7L) / 8L;
+	long i = 0L;
+	long j = 0L;
+	long offset = 0L;
+	long limit = 0L;
+	long match = 0L;
+	long best_offset = 0L;
+	long best_match = 0L;
+	int offset_bits = 0;
+	unsigned char *data = (unsigned char *) calloc((size_t) length, 1);
+
+	for (i = 0L; i < count; ++i)
+	{
+		if (bits[i]) data[i >> 3] |= (unsigned char) (1 << (i & 7L));
+	}
+
+	start_text(fp);
+	put_bits((unsigned long) length, 32);
+
+	i = 0L;
+	while (i < length)
+	{
+		limit = (i < 8191L) ? i : 8191L;
+		best_match = 0L;
+
+		for (offset = 1L; (offset <= limit) && (offset <= 64L); ++offset)
+		{
+			match = 0L;
+			while ((i + match < length) && (match < 255L) &&
+				(data[i + match - offset] == data[i + match])) ++match;
+
+			if (match > best_match)
+			{
+				best_match = match;
+				best_offset = offset;
+			}
+		}
+
+		if (best_match >= 4L)
+		{
+			offset_bits = 1;
+			while ((limit >> offset_bits) != 0L) ++offset_bits;
+
+			put_bits(1UL, 1);
+			put_bits((unsigned long) best_offset, offset_bits);
+			put_bits((unsigned long) best_match, 8);
+			i += best_match;
+		}
+		else
+		{
+			put_bits(0UL, 1);
+
+			for (j = 0L; j < 3L; ++j)
+			{
+				if (i < length) put_bits((unsigned long) data[i++], 8);
+			}
+		}
+	}
+
+	finish_bits();
+	free(data);
+}
+
+void write_workload(FILE *fp, int workload)
+{
+	char *bits = NULL;
+	int depth = 0;
+
+	/* the array workloads all hold the same data */
+	bench_seed = 1UL;
+
+	if ((workload == BENCH_HEX) || (workload == BENCH_RLC) ||
+		(workload == BENCH_ACA))
+	{
+		bits = (char *) malloc((size_t) BENCH_ARRAY_BITS);
+		make_bits(bits, BENCH_ARRAY_BITS);
+	}
+
+	if (workload != BENCH_RLC)
+	{
+		fprintf(fp, "NOTE \"CREATOR\" \"jambench %s\";\n", workload_name[workload]);
+		fprintf(fp, "ACTION RUN \"%s\" = MAIN;\n", workload_description[workload]);
+		fprintf(fp, "DATA D;\nINTEGER I;\nINTEGER S = 0;\n");
+	}
+
+	switch (workload)
+	{
+	case BENCH_DRSCAN:
+		bits = (char *) malloc((size_t) BENCH_SCAN_BITS);
+		make_bits(bits, BENCH_SCAN_BITS);
+		fprintf(fp, "BOOLEAN OUT[%ld] = $", BENCH_SCAN_BITS);
+		write_hex(fp, bits, BENCH_SCAN_BITS);
+		fprintf(fp, ";\nBOOLEAN IN[%ld];\nENDDATA;\n", BENCH_SCAN_BITS);
+		fprintf(fp, "PROCEDURE MAIN USES D;\nIRSCAN 20, $FFFFF;\n");
+		fprintf(fp, "FOR I = 1 TO 64;\nDRSCAN %ld, OUT[%ld..0], CAPTURE IN[%ld..0];\nNEXT I;\n",
+			BENCH_SCAN_BITS, BENCH_SCAN_BITS - 1L, BENCH_SCAN_BITS - 1L);
+		break;
+
+	case BENCH_IRSCAN:
+		fprintf(fp, "ENDDATA;\nPROCEDURE MAIN USES D;\n");
+		fprintf(fp, "FOR I = 1 TO 10000;\nIRSCAN 20, $00C06;\nIRSCAN 20, $FFFFF;\nNEXT I;\n");
+		break;
+
+	case BENCH_LOOP:
+		fprintf(fp, "INTEGER J;\nENDDATA;\nPROCEDURE MAIN USES D;\n");
+		fprintf(fp, "FOR I = 1 TO 1000;\nFOR J = 1 TO 200;\n");
+		fprintf(fp, "S = (S + I * J) %% 65521;\nNEXT J;\nNEXT I;\nPRINT \"S \", S;\n");
+		break;
+
+	case BENCH_CALL:
+		fprintf(fp, "ENDDATA;\n");
+		for (depth = 1; depth < BENCH_CALL_DEPTH; ++depth)
+		{
+			fprintf(fp, "PROCEDURE P%d USES D, P%d;\nS = S + 1;\nCALL P%d;\nENDPROC;\n",
+				depth, depth + 1, depth + 1);
+		}
+		fprintf(fp, "PROCEDURE P%d USES D;\nS = S + 1;\nENDPROC;\n", depth);
+		fprintf(fp, "PROCEDURE MAIN USES D, P1;\nFOR I = 1 TO 2000;\nCALL P1;\nNEXT I;\n");
+		fprintf(fp, "PRINT \"S \", S;\n");
+		break;
+
+	case BENCH_HEX:
+	case BENCH_ACA:
+		fprintf(fp, "BOOLEAN A[%ld] = %c", BENCH_ARRAY_BITS,
+			(workload == BENCH_HEX) ? '$' : '@');
+		if (workload == BENCH_HEX) write_hex(fp, bits, BENCH_ARRAY_BITS);
+		else write_aca(fp, bits, BENCH_ARRAY_BITS);
+		fprintf(fp, ";\nENDDATA;\nPROCEDURE MAIN USES D;\n");
+		fprintf(fp, "FOR I = 0 TO %ld STEP %ld;\nIF A[I] THEN S = S + 1;\nNEXT I;\n",
+			BENCH_ARRAY_BITS - BENCH_ARRAY_STEP, BENCH_ARRAY_STEP);
+		fprintf(fp, "DRSCAN 1024, A[1023..0];\nPRINT \"S \", S;\n");
+		break;
+
+	case BENCH_RLC:
+		fprintf(fp, "NOTE \"CREATOR\" \"jambench %s\";\n", workload_name[workload]);
+		fprintf(fp, "BOOLEAN A[%ld] = RLC ", BENCH_ARRAY_BITS);
+		write_rlc(fp, bits, BENCH_ARRAY_BITS);
+		fprintf(fp, ";\nINTEGER I;\nINTEGER S;\nLET S = 0;\n");
+		fprintf(fp, "FOR I = 0 TO %ld STEP %ld;\nIF A[I] THEN LET S = S + 1;\nNEXT I;\n",
+			BENCH_ARRAY_BITS - BENCH_ARRAY_STEP, BENCH_ARRAY_STEP);
+		fprintf(fp, "DRSCAN 1024, A[0..1023];\nPRINT \"S \", S;\nEXIT 0;\n");
+		break;
+
+	case BENCH_WAIT:
+		fprintf(fp, "ENDDATA;\nPROCEDURE MAIN USES D;\n");
+		fprintf(fp, "FOR I = 1 TO 5000;\nWAIT 16 CYCLES, 1 USEC;\nNEXT I;\n");
+		break;
+
+	default:
+		fprintf(fp, "ENDDATA;\nPROCEDURE MAIN USES D;\n");
+		break;
+	}
+
+	if (workload != BENCH_RLC) fprintf(fp, "ENDPROC;\n");
+
+	if (bits != NULL) free(bits);
+}
+
+/************************************************************************
+*
+*	Running the workloads
+*
+*	Each program is run BENCH_REPEATS times by the player with --json,
+*	and the fastest run counts.  The statements and scan bits come from
+*	the result line, and the rates are taken over the execution time,
+*	which leaves out loading and checking the file.  The startup time
+*	is the time from starting the player to its exit.  The value of S
+*	printed by a program is kept as well.  The HEX, RLC and ACA programs
+*	hold the same array, so they must print the same value, and every
+*	program must print the value saved in the baseline.
+*/
+
+typedef struct
+{
+	BOOL success;
+	double wall_time;		/* seconds, from starting the player to its exit */
+	double execute_time;	/* seconds, in jam_execute() */
+	long statement_count;
+	long bit_count;
+	long value;				/* the value of S printed, or -1 */
+} BENCH_RESULT;
+
+double bench_clock(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return ((double) now.tv_sec + (double) now.tv_nsec / 1e9);
+}
+
+/* finds "key":value in a JSON line */
+double json_number(char *line, char *key)
+{
+	char pattern[BENCH_NAME_LENGTH + 4];
+	char *value = NULL;
+
+	sprintf(pattern, "\"%s\":", key);
+	value = strstr(line, pattern);
+
+	return ((value == NULL) ? 0.0 : strtod(value + strlen(pattern), NULL));
+}
+
+BOOL run_player(char *player, char *filename, BENCH_RESULT *result)
+{
+	static char line[BENCH_LINE_LENGTH];
+	char command[BENCH_LINE_LENGTH];
+	FILE *output = NULL;
+	char *text = NULL;
+	double start_time = bench_clock();
+
+	result->success = FALSE;
+	result->value = -1L;
+	sprintf(command, "%s --json -aRUN %s 2>/dev/null", player, filename);
+
+	if ((output = popen(command, "r")) != NULL)
+	{
+		while (fgets(line, BENCH_LINE_LENGTH, output) != NULL)
+		{
+			if ((strstr(line, "\"type\":\"message\"") != NULL) &&
+				((text = strstr(line, "\"text\":\"S ")) != NULL))
+			{
+				result->value = atol(text + 10);
+			}
+
+			if (strstr(line, "\"type\":\"result\"") != NULL)
+			{
+				result->success =
+					(strstr(line, "\"status\":\"success\"") != NULL);
+				result->execute_time = json_number(line, "execute_time");
+				result->statement_count = (long) json_number(line, "statements");
+				result->bit_count = (long) json_number(line, "bits_shifted");
+
+				if (!result->success)
+				{
+					fprintf(stderr, "Error: %s failed: %s", filename, line);
+				}
+			}
+		}
+
+		pclose(output);
+	}
+
+	result->wall_time = bench_clock() - start_time;
+
+	return (result->success);
+}
+
+BOOL run_workload(char *player, int workload, BENCH_RESULT *best)
+{
+	char filename[BENCH_LINE_LENGTH];
+	BENCH_RESULT result;
+	FILE *fp = NULL;
+	int repeat = 0;
+
+	best->success = FALSE;
+	best->value = -1L;
+	sprintf(filename, "%s/%s.jam", BENCH_DIRECTORY, workload_name[workload]);
+
+	if ((fp = fopen(filename, "w")) == NULL)
+	{
+		fprintf(stderr, "Error: can't write \"%s\"\n", filename);
+	}
+	else
+	{
+		write_workload(fp, workload);
+		fclose(fp);
+
+		best->success = run_player(player, filename, best);
+
+		for (repeat = 1; best->success && (repeat < BENCH_REPEATS); ++repeat)
+		{
+			best->success = run_player(player, filename, &result);
+
+			if (result.wall_time < best->wall_time)
+			{
+				best->wall_time = result.wall_time;
+			}
+
+			if (result.execute_time < best->execute_time)
+			{
+				best->execute_time = result.execute_time;
+			}
+		}
+	}
+
+	return (best->success);
+}
+
+/************************************************************************
+*
+*	Baseline
+*
+*	The baseline file has a line for each workload giving its name, the
+*	time which is compared (the startup time for the startup workload,
+*	and the execution time for the others) and the value of S that the
+*	program printed, or -1.
+*/
+
+double baseline_time[BENCH_WORKLOAD_COUNT];
+long baseline_value[BENCH_WORKLOAD_COUNT];
+
+double workload_time(int workload, BENCH_RESULT *result)
+{
+	return ((workload == BENCH_STARTUP) ?
+		result->wall_time : result->execute_time);
+}
+
+void clear_baseline(void)
+{
+	int workload = 0;
+
+	for (workload = 0; workload < BENCH_WORKLOAD_COUNT; ++workload)
+	{
+		baseline_time[workload] = 0.0;
+		baseline_value[workload] = -1L;
+	}
+}
+
+BOOL read_baseline(char *filename)
+{
+	char line[BENCH_LINE_LENGTH];
+	char name[BENCH_NAME_LENGTH];
+	double time = 0.0;
+	long value = -1L;
+	int workload = 0;
+	BOOL found = FALSE;
+	FILE *fp = fopen(filename, "r");
+
+	if (fp != NULL)
+	{
+		while (fgets(line, BENCH_LINE_LENGTH, fp) != NULL)
+		{
+			/* a baseline saved before values were kept has none */
+			value = -1L;
+			if (sscanf(line, "%31s %lf %ld", name, &time, &value) < 2)
+			{
+				name[0] = '\0';
+			}
+
+			for (workload = 0; workload < BENCH_WORKLOAD_COUNT; ++workload)
+			{
+				if (strcmp(name, workload_name[workload]) == 0)
+				{
+					baseline_time[workload] = time;
+					baseline_value[workload] = value;
+					found = TRUE;
+				}
+			}
+		}
+
+		fclose(fp);
+	}
+
+	return (found);
+}
+
+BOOL write_baseline(char *filename, BENCH_RESULT *results)
+{
+	int workload = 0;
+	BOOL status = FALSE;
+	FILE *fp = fopen(filename, "w");
+
+	if (fp != NULL)
+	{
+		for (workload = 0; workload < BENCH_WORKLOAD_COUNT; ++workload)
+		{
+			fprintf(fp, "%s %.6f %ld\n", workload_name[workload],
+				workload_time(workload, &results[workload]),
+				results[workload].value);
+		}
+
+		status = (fclose(fp) == 0);
+	}
+
+	if (!status) fprintf(stderr, "Error: can't write \"%s\"\n", filename);
+
+	return (status);
+}
+
+/* checks the value of S printed by a workload which ran */
+BOOL check_value(int workload, BENCH_RESULT *results)
+{
+	long value = results[workload].value;
+	BOOL ok = TRUE;
+
+	if (((workload == BENCH_RLC) || (workload == BENCH_ACA)) &&
+		(value != results[BENCH_HEX].value))
+	{
+		fprintf(stderr, "Error: %s printed S %ld, but %s printed S %ld\n",
+			workload_name[workload], value, workload_name[BENCH_HEX],
+			results[BENCH_HEX].value);
+		ok = FALSE;
+	}
+
+	if ((baseline_value[workload] != -1L) &&
+		(value != baseline_value[workload]))
+	{
+		fprintf(stderr, "Error: %s printed S %ld, but S %ld in the baseline\n",
+			workload_name[workload], value, baseline_value[workload]);
+		ok = FALSE;
+	}
+
+	return (ok);
+}
+
+void print_result(int workload, BENCH_RESULT *result)
+{
+	double time = workload_time(workload, result);
+
+	printf("%-8s %-26s %10ld %10ld %9.4f", workload_name[workload],
+		workload_description[workload], result->statement_count,
+		result->bit_count, time);
+
+	if ((workload != BENCH_STARTUP) && (result->execute_time > 0.0))
+	{
+		printf(" %12.0f %12.0f",
+			(double) result->statement_count / result->execute_time,
+			(double) result->bit_count / result->execute_time);
+	}
+	else
+	{
+		printf(" %12s %12s", "-", "-");
+	}
+
+	if ((baseline_time[workload] > 0.0) && (time > 0.0))
+	{
+		printf(" %+8.1f%%", (time / baseline_time[workload] - 1.0) * 100.0);
+	}
+
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	BENCH_RESULT results[BENCH_WORKLOAD_COUNT];
+	char *player = NULL;
+	char *baseline = NULL;
+	int workload = 0;
+	int arg = 1;
+	int exit_status = 0;
+	BOOL save = FALSE;
+	BOOL have_baseline = FALSE;
+
+	if ((argc > 1) && (strcmp(argv[1], "-s") == 0))
+	{
+		save = TRUE;
+		++arg;
+	}
+
+	if (argc != arg + 2)
+	{
+		fprintf(stderr, "Usage: jambench [-s] <player> <baseline file>\n");
+		fprintf(stderr, "    -s : save the results as the new baseline\n");
+		exit_status = 1;
+	}
+	else if ((mkdir(BENCH_DIRECTORY, 0777) != 0) && (errno != EEXIST))
+	{
+		fprintf(stderr, "Error: can't create \"%s\"\n", BENCH_DIRECTORY);
+		exit_status = 1;
+	}
+	else
+	{
+		player = argv[arg];
+		baseline = argv[arg + 1];
+		clear_baseline();
+		have_baseline = !save && read_baseline(baseline);
+
+		printf("%-8s %-26s %10s %10s %9s %12s %12s", "workload", "",
+			"statements", "scan bits", "time (s)", "statements/s", "bits/s");
+		if (have_baseline) printf(" %9s", "change");
+		printf("\n");
+
+		for (workload = 0; workload < BENCH_WORKLOAD_COUNT; ++workload)
+		{
+			if (run_workload(player, workload, &results[workload]) &&
+				check_value(workload, results))
+			{
+				print_result(workload, &results[workload]);
+			}
+			else
+			{
+				printf("%-8s %-26s failed\n", workload_name[workload],
+					workload_description[workload]);
+				exit_status = 1;
+			}
+			fflush(stdout);
+		}
+
+		if (save && (exit_status == 0))
+		{
+			if (write_baseline(baseline, results))
+			{
+				printf("Saved baseline in \"%s\"\n", baseline);
+			}
+			else
+			{
+				exit_status = 1;
+			}
+		}
+		else if (!save && !have_baseline)
+		{
+			printf("No baseline in \"%s\"; make bench-baseline saves one\n",
+				baseline);
+		}
+	}
+
+	return (exit_status);
+}
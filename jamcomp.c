@@ -14,95 +14,104 @@
 /*																			*/
 /****************************************************************************/
 
+#include "jamport.h"
 #include "jamexprt.h"
 #include "jamdefs.h"
 #include "jamcomp.h"
 
-#define	SHORT_BITS			16
 #define	CHAR_BITS			8
 #define	DATA_BLOB_LENGTH	3
 #define	MATCH_DATA_LENGTH	8192
+#define	DATA_LENGTH_BYTES	4	/* size of uncompressed length field */
+
+/*
+*	The bit reader accumulates input bits in a register-sized word, so
+*	that most fields are extracted with a shift and a mask.  A 64-bit
+*	accumulator is used where the compiler supports one.
+*/
+#if PORT == DOS
+typedef unsigned long JAM_BIT_ACCUMULATOR;
+#define	ACCUMULATOR_BITS	32
+#else
+typedef unsigned long long JAM_BIT_ACCUMULATOR;
+#define	ACCUMULATOR_BITS	64
+#endif
+
+/* bit reader state -- bits are taken from the input LSB first */
+typedef struct JAMS_BIT_READER_STRUCT
+{
+	unsigned char *buffer;		/* compressed input */
+	long length;				/* length of input in bytes */
+	long index;					/* index of next byte to load */
+	JAM_BIT_ACCUMULATOR bits;	/* bits loaded but not yet consumed */
+	int count;					/* number of valid bits in "bits" */
+
+} JAMS_BIT_READER;
 
 /****************************************************************************/
 /*																			*/
 
-short jam_bits_required(short n)
+void jam_refill_bits(JAMS_BIT_READER *reader)
 
 /*																			*/
-/*	Description:	Calculate the minimum number of bits required to		*/
-/*					represent n.											*/
+/*	Description:	Loads input bytes into the bit accumulator until it		*/
+/*					is full or the input is exhausted.  Whole 32-bit		*/
+/*					words are loaded while there is room for them.			*/
 /*																			*/
-/*	Returns:		Number of bits.											*/
+/*	Returns:		Nothing													*/
 /*																			*/
 /****************************************************************************/
 {
-	short	result = SHORT_BITS;
+	unsigned char *in = reader->buffer;
+	long index = reader->index;
 
-	if (n == 0) result = 1;
-	else
+	while ((reader->count <= (ACCUMULATOR_BITS - 32)) &&
+		((index + 4) <= reader->length))
 	{
-		/* Look for the highest non-zero bit position */
-		while ((n & (1 << (SHORT_BITS - 1))) == 0)
-		{
-			n = (short) (n << 1);
-			--result;
-		}
+		reader->bits |= ((JAM_BIT_ACCUMULATOR)
+			(((unsigned long) in[index]) |
+			(((unsigned long) in[index + 1]) << 8) |
+			(((unsigned long) in[index + 2]) << 16) |
+			(((unsigned long) in[index + 3]) << 24))) << reader->count;
+		reader->count += 32;
+		index += 4;
 	}
 
-	return (result);
+	while ((reader->count <= (ACCUMULATOR_BITS - CHAR_BITS)) &&
+		(index < reader->length))
+	{
+		reader->bits |= ((JAM_BIT_ACCUMULATOR) in[index]) << reader->count;
+		reader->count += CHAR_BITS;
+		++index;
+	}
+
+	reader->index = index;
 }
 
 /****************************************************************************/
 /*																			*/
 
-short jam_read_packed(char *buffer, long length, short bits)
+short jam_read_bits(JAMS_BIT_READER *reader, int bits)
 
 /*																			*/
-/*	Description:	Read the next value from the input array "buffer".		*/
-/*					Read only "bits" bits from the array. The amount of		*/
-/*					bits that have already been read from "buffer" is		*/
-/*					stored internally to this function.					 	*/
+/*	Description:	Read the next "bits" bits (at most 16) from the input.	*/
 /*																			*/
 /*	Returns:		Up to 16 bit value. -1 if buffer overrun.				*/
 /*																			*/
 /****************************************************************************/
 {
-	short			result = -1;
-	static long		index = 0L;
-	static short	bits_avail = 0;
-	short			shift = 0;
+	short result = -1;
 
-	/* If buffer is NULL then initialize. */
-	if (buffer == NULL)
+	if (reader->count < bits)
 	{
-		index = 0;
-		bits_avail = CHAR_BITS;
+		jam_refill_bits(reader);
 	}
-	else
-	{
-		result = 0;
-		while (result != -1 && bits > 0)
-		{
-			result = (short) (result | (((buffer[index] >> (CHAR_BITS - bits_avail)) & (0xFF >> (CHAR_BITS - bits_avail))) << shift));
 
-			if (bits <= bits_avail)
-			{
-				result = (short) (result & (0xFFFF >> (SHORT_BITS - (bits + shift))));
-				bits_avail = (short) (bits_avail - bits);
-				bits = 0;
-			}
-			else
-			{
-				/* Check for buffer overflow. */
-				if (++index >= length) result = -1;
-				else
-				{
-					shift = (short) (shift + bits_avail);
-					bits = (short) (bits - bits_avail);
-					bits_avail = CHAR_BITS;
-				}
-			}
-		}
+	if (reader->count >= bits)
+	{
+		result = (short) (reader->bits & ((1L << bits) - 1));
+		reader->bits >>= bits;
+		reader->count -= bits;
 	}
 
 	return (result);
@@ -131,54 +140,84 @@ long jam_uncompress
 /****************************************************************************/
 {
 	long	i, j, data_length = 0L;
+	long	count = 0L;
+	short	value = 0;
 	short	offset, length;
+	short	offset_bits = 1;
+	long	limit = 0L;
 	long	match_data_length = MATCH_DATA_LENGTH;
+	char	*dest = NULL;
+	JAMS_BIT_READER reader;
 
 	if (version == 2) --match_data_length;
-	
-	jam_read_packed(NULL, 0, 0);
+
+	reader.buffer = (unsigned char *) in;
+	reader.length = in_length;
+	reader.index = 0L;
+	reader.bits = 0;
+	reader.count = 0;
+
 	for (i = 0; i < out_length; ++i) out[i] = 0;
 
 	/* Read number of bytes in data. */
-	for (i = 0; i < sizeof (in_length); ++i) 
+	for (i = 0; (data_length != -1L) && (i < DATA_LENGTH_BYTES); ++i)
 	{
-		data_length = data_length | ((long) jam_read_packed(in, in_length, CHAR_BITS) << (long) (i * CHAR_BITS));
+		value = jam_read_bits(&reader, CHAR_BITS);
+
+		if (value == -1) data_length = -1L;
+		else data_length = data_length | ((long) value << (long) (i * CHAR_BITS));
 	}
 
 	if (data_length > out_length) data_length = -1L;
-	else
+
+	i = 0;
+	while ((data_length != -1L) && (i < data_length))
 	{
-		i = 0;
-		while (i < data_length)
+		/* A 0 bit indicates literal data. */
+		value = jam_read_bits(&reader, 1);
+
+		if (value == 0)
+		{
+			for (j = 0; (j < DATA_BLOB_LENGTH) && (i < data_length); ++j)
+			{
+				value = jam_read_bits(&reader, CHAR_BITS);
+
+				if (value == -1) data_length = -1L;
+				else out[i++] = (char) value;
+			}
+		}
+		else if (value == 1)
 		{
-			/* A 0 bit indicates literal data. */
-			if (jam_read_packed(in, in_length, 1) == 0)
+			/* A 1 bit indicates offset/length to follow.  The offset */
+			/* field is wide enough to reach the start of the data, up */
+			/* to the size of the match window. */
+			limit = (i > match_data_length) ? match_data_length : i;
+			while ((limit >> offset_bits) != 0) ++offset_bits;
+
+			offset = jam_read_bits(&reader, offset_bits);
+			length = jam_read_bits(&reader, CHAR_BITS);
+
+			if ((offset == -1) || (length == -1) || (offset > i))
 			{
-				for (j = 0; j < DATA_BLOB_LENGTH; ++j)
-				{
-					if (i < data_length)
-					{
-						out[i] = (char) jam_read_packed(in, in_length, CHAR_BITS);
-						i++;
-					}
-				}
+				data_length = -1L;
 			}
 			else
 			{
-				/* A 1 bit indicates offset/length to follow. */
-				offset = jam_read_packed(in, in_length, jam_bits_required((short) (i > match_data_length ? match_data_length : i)));
-				length = jam_read_packed(in, in_length, CHAR_BITS);
-
-				for (j = 0; j < length; ++j)
-				{
-					if (i < data_length)
-					{
-						out[i] = out[i - offset];
-						i++;
-					}
-				}
+				count = length;
+				if (count > (data_length - i)) count = data_length - i;
+
+				/* copy forwards, so that a match which overlaps the */
+				/* bytes being written repeats the last "offset" bytes */
+				dest = &out[i];
+				for (j = 0; j < count; ++j) dest[j] = dest[j - offset];
+
+				i += count;
 			}
 		}
+		else
+		{
+			data_length = -1L;
+		}
 	}
 
 	return (data_length);
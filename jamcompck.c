@@ -0,0 +1,358 @@
+/****************************************************************************/
+/*																			*/
+/*	Module:			jamcompck.c												*/
+/*																			*/
+/*	Description:	Checks jam_uncompress() in jamcomp.c against the		*/
+/*					original bit-at-a-time ACA decoder, which is kept		*/
+/*					here for the purpose.  Random version 1 and version 2	*/
+/*					streams are decoded by both, and must give the same		*/
+/*					data; truncated streams must be rejected, and random	*/
+/*					bytes must either be rejected or decode as the old		*/
+/*					decoder decodes them.									*/
+/*																			*/
+/*					Usage: jamcompck [<streams>]							*/
+/*																			*/
+/****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jamcomp.h"
+
+typedef int BOOL;
+#define TRUE 1
+#define FALSE 0
+
+#define CHECK_STREAMS 2000L			/* streams of each kind, by default */
+#define CHECK_MAX_DATA 20000L		/* longer than the 8 KB match window */
+#define CHECK_MAX_STREAM (CHECK_MAX_DATA * 2L + 16L)
+
+#define	SHORT_BITS			16
+#define	CHAR_BITS			8
+#define	DATA_BLOB_LENGTH	3
+#define	MATCH_DATA_LENGTH	8192
+
+/************************************************************************
+*
+*	Original decoder
+*
+*	This is jam_read_packed() and jam_uncompress() as they were before
+*	the word-level bit reader, renamed.  The only change is that the
+*	length prefix is read as four bytes, which is what sizeof(long) was
+*	on the 32-bit hosts the decoder was written for.
+*/
+
+short old_bits_required(short n)
+{
+	short	result = SHORT_BITS;
+
+	if (n == 0) result = 1;
+	else
+	{
+		/* Look for the highest non-zero bit position */
+		while ((n & (1 << (SHORT_BITS - 1))) == 0)
+		{
+			n = (short) (n << 1);
+			--result;
+		}
+	}
+
+	return (result);
+}
+
+short old_read_packed(char *buffer, long length, short bits)
+{
+	short			result = -1;
+	static long		index = 0L;
+	static short	bits_avail = 0;
+	short			shift = 0;
+
+	/* If buffer is NULL then initialize. */
+	if (buffer == NULL)
+	{
+		index = 0;
+		bits_avail = CHAR_BITS;
+	}
+	else
+	{
+		result = 0;
+		while (result != -1 && bits > 0)
+		{
+			result = (short) (result | (((buffer[index] >> (CHAR_BITS - bits_avail)) & (0xFF >> (CHAR_BITS - bits_avail))) << shift));
+
+			if (bits <= bits_avail)
+			{
+				result = (short) (result & (0xFFFF >> (SHORT_BITS - (bits + shift))));
+				bits_avail = (short) (bits_avail - bits);
+				bits = 0;
+			}
+			else
+			{
+				/* Check for buffer overflow. */
+				if (++index >= length) result = -1;
+				else
+				{
+					shift = (short) (shift + bits_avail);
+					bits = (short) (bits - bits_avail);
+					bits_avail = CHAR_BITS;
+				}
+			}
+		}
+	}
+
+	return (result);
+}
+
+long old_uncompress
+(
+	char *in,
+	long in_length,
+	char *out,
+	long out_length,
+	int version
+)
+{
+	long	i, j, data_length = 0L;
+	short	offset, length;
+	long	match_data_length = MATCH_DATA_LENGTH;
+
+	if (version == 2) --match_data_length;
+
+	old_read_packed(NULL, 0, 0);
+	for (i = 0; i < out_length; ++i) out[i] = 0;
+
+	/* Read number of bytes in data. */
+	for (i = 0; i < 4; ++i)
+	{
+		data_length = data_length | ((long) old_read_packed(in, in_length, CHAR_BITS) << (long) (i * CHAR_BITS));
+	}
+
+	if (data_length > out_length) data_length = -1L;
+	else
+	{
+		i = 0;
+		while (i < data_length)
+		{
+			/* A 0 bit indicates literal data. */
+			if (old_read_packed(in, in_length, 1) == 0)
+			{
+				for (j = 0; j < DATA_BLOB_LENGTH; ++j)
+				{
+					if (i < data_length)
+					{
+						out[i] = (char) old_read_packed(in, in_length, CHAR_BITS);
+						i++;
+					}
+				}
+			}
+			else
+			{
+				/* A 1 bit indicates offset/length to follow. */
+				offset = old_read_packed(in, in_length, old_bits_required((short) (i > match_data_length ? match_data_length : i)));
+				length = old_read_packed(in, in_length, CHAR_BITS);
+
+				for (j = 0; j < length; ++j)
+				{
+					if (i < data_length)
+					{
+						out[i] = out[i - offset];
+						i++;
+					}
+				}
+			}
+		}
+	}
+
+	return (data_length);
+}
+
+/************************************************************************
+*
+*	Stream generator
+*
+*	make_stream() writes a valid stream of random literal triples and
+*	back references.  References may overlap the bytes they produce,
+*	may have an offset or length of zero, and may run past the end of
+*	the data, as the decoders allow all of these.
+*/
+
+unsigned long check_seed = 1UL;
+
+long check_random(long range)
+{
+	check_seed = check_seed * 1103515245UL + 12345UL;
+
+	return ((long) ((check_seed >> 16) & 0x7fffUL) % range);
+}
+
+unsigned char *stream_buffer = NULL;
+long stream_bits = 0L;
+
+void put_stream_bits(unsigned long value, int count)
+{
+	int i = 0;
+
+	for (i = 0; i < count; ++i)
+	{
+		if ((value >> i) & 1UL)
+		{
+			stream_buffer[stream_bits >> 3] |=
+				(unsigned char) (1 << (stream_bits & 7L));
+		}
+		++stream_bits;
+	}
+}
+
+/* returns the length of the stream in bytes */
+long make_stream(unsigned char *buffer, long data_length, int version)
+{
+	long match_data_length = (version == 2) ?
+		(MATCH_DATA_LENGTH - 1L) : MATCH_DATA_LENGTH;
+	long limit = 0L;
+	long i = 0L;
+	long j = 0L;
+	long length = 0L;
+	int offset_bits = 0;
+
+	stream_buffer = buffer;
+	stream_bits = 0L;
+	memset(buffer, 0, (size_t) CHECK_MAX_STREAM);
+
+	put_stream_bits((unsigned long) data_length, 32);
+
+	while (i < data_length)
+	{
+		if ((i == 0L) || (check_random(3) == 0))
+		{
+			put_stream_bits(0UL, 1);
+
+			for (j = 0L; (j < DATA_BLOB_LENGTH) && (i < data_length); ++j)
+			{
+				put_stream_bits((unsigned long) check_random(256), 8);
+				++i;
+			}
+		}
+		else
+		{
+			limit = (i > match_data_length) ? match_data_length : i;
+			offset_bits = 1;
+			while ((limit >> offset_bits) != 0L) ++offset_bits;
+
+			length = check_random(256);
+
+			put_stream_bits(1UL, 1);
+			put_stream_bits((unsigned long) check_random(limit + 1L),
+				offset_bits);
+			put_stream_bits((unsigned long) length, 8);
+
+			i += length;
+		}
+	}
+
+	return ((stream_bits + 7L) / 8L);
+}
+
+/************************************************************************
+*
+*	Checks
+*/
+
+char new_data[CHECK_MAX_DATA];
+char old_data[CHECK_MAX_DATA];
+unsigned char stream[CHECK_MAX_STREAM];
+long failures = 0L;
+
+void report(char *kind, long number, int version, long expected, long actual)
+{
+	if (failures < 10L)
+	{
+		fprintf(stderr,
+			"%s stream %ld, version %d: expected length %ld, got %ld\n",
+			kind, number, version, expected, actual);
+	}
+
+	++failures;
+}
+
+/* decodes with both decoders; they must agree unless the new one fails */
+void compare(char *kind, long number, int version, long length,
+	long out_length, BOOL must_succeed)
+{
+	long new_length = jam_uncompress((char *) stream, length,
+		new_data, out_length, version);
+	long old_length = 0L;
+
+	if (new_length != -1L)
+	{
+		old_length = old_uncompress((char *) stream, length,
+			old_data, out_length, version);
+
+		if ((old_length != new_length) ||
+			(memcmp(old_data, new_data, (size_t) out_length) != 0))
+		{
+			report(kind, number, version, old_length, new_length);
+		}
+	}
+	else if (must_succeed)
+	{
+		report(kind, number, version, out_length, new_length);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	long streams = CHECK_STREAMS;
+	long number = 0L;
+	long data_length = 0L;
+	long length = 0L;
+	long cut = 0L;
+	long new_length = 0L;
+	long i = 0L;
+	int version = 0;
+
+	if (argc > 1) streams = atol(argv[1]);
+
+	for (version = 1; version <= 2; ++version)
+	{
+		for (number = 0L; number < streams; ++number)
+		{
+			/* mostly short data, sometimes past the match window */
+			data_length = (check_random(4) == 0) ?
+				(check_random(CHECK_MAX_DATA / 2L) + CHECK_MAX_DATA / 2L) :
+				check_random(300);
+
+			length = make_stream(stream, data_length, version);
+			compare("valid", number, version, length, data_length, TRUE);
+
+			/* every truncated stream is missing bits it needs */
+			if (length > 4L)
+			{
+				cut = 4L + check_random(length - 4L);
+				new_length = jam_uncompress((char *) stream, cut,
+					new_data, data_length, version);
+
+				if (new_length != -1L)
+				{
+					report("truncated", number, version, -1L, new_length);
+				}
+			}
+
+			/* random bytes after a small length prefix */
+			length = check_random(64) + 5L;
+			for (i = 0L; i < length; ++i)
+			{
+				stream[i] = (unsigned char) check_random(256);
+			}
+			data_length = check_random(200);
+			stream[0] = (unsigned char) data_length;
+			stream[1] = stream[2] = stream[3] = 0;
+			compare("random", number, version, length, data_length, FALSE);
+		}
+	}
+
+	printf("%ld streams of each kind, version 1 and 2: %ld failures\n",
+		streams, failures);
+
+	return ((failures == 0L) ? 0 : 1);
+}
@@ -13,6 +13,73 @@
 #include "jamexec.h"
 #include "jamutil.h"
 
+/*
+*	CRC of each byte value for the reflected CCITT polynomial (0x8408),
+*	indexed by the low byte of the shift register XOR the data byte.
+*/
+static const unsigned short jam_crc_table[256] =
+{
+	0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+	0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+	0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
+	0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
+	0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
+	0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
+	0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
+	0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
+	0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
+	0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
+	0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
+	0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
+	0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
+	0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
+	0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
+	0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
+	0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
+	0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
+	0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
+	0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
+	0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
+	0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
+	0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
+	0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
+	0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
+	0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
+	0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
+	0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
+	0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
+	0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
+	0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
+	0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78
+};
+
+/*
+*	Tables for updating the shift register four bytes at a time, built
+*	from jam_crc_table by jam_crc_init().  jam_crc_slice_table[n - 1]
+*	holds the effect of a byte followed by n further bytes.
+*/
+#define JAMC_CRC_SLICE_COUNT 3
+
+static unsigned short jam_crc_slice_table[JAMC_CRC_SLICE_COUNT][256] = {{0}};
+static BOOL jam_crc_slice_table_ready = FALSE;
+
+/*
+*	CRC check started by jam_start_crc_check(), which may run on a
+*	worker thread while the program executes.
+*/
+typedef struct JAMS_CRC_CHECK_STRUCT
+{
+	char *program;
+	long program_size;
+	unsigned short expected_crc;
+	unsigned short actual_crc;
+	JAM_RETURN_TYPE status;
+	void *work;		/* handle from jam_start_work(), or NULL */
+
+} JAMS_CRC_CHECK;
+
+JAMS_CRC_CHECK jam_background_crc = { NULL, 0L, 0, 0, JAMC_SUCCESS, NULL };
+
 /****************************************************************************/
 /*																			*/
 
@@ -26,7 +93,28 @@ void jam_crc_init(unsigned short *shift_register)
 /*																			*/
 /****************************************************************************/
 {
+	int slice = 0;
+	int index = 0;
+	unsigned short value = 0;
+
 	*shift_register = 0xffff;	/* start with all ones in shift reg */
+
+	if (!jam_crc_slice_table_ready)
+	{
+		for (slice = 0; slice < JAMC_CRC_SLICE_COUNT; ++slice)
+		{
+			for (index = 0; index < 256; ++index)
+			{
+				value = (slice == 0) ? jam_crc_table[index] :
+					jam_crc_slice_table[slice - 1][index];
+
+				jam_crc_slice_table[slice][index] = (unsigned short)
+					((value >> 8) ^ jam_crc_table[value & 0xff]);
+			}
+		}
+
+		jam_crc_slice_table_ready = TRUE;
+	}
 }
 
 /****************************************************************************/
@@ -47,20 +135,68 @@ void jam_crc_update
 /*																			*/
 /****************************************************************************/
 {
-	int bit, feedback;
-	unsigned short shift_register_copy;
+	unsigned short shift_register_copy = *shift_register;
+
+	*shift_register = (unsigned short) ((shift_register_copy >> 8) ^
+		jam_crc_table[(shift_register_copy ^ data) & 0xff]);
+}
+
+/****************************************************************************/
+/*																			*/
 
-	shift_register_copy = *shift_register;	/* copy it to local variable */
+void jam_crc_update_block
+(
+	unsigned short *shift_register,
+	char *data,
+	long length
+)
 
-	for (bit = 0; bit < 8; bit++)	/* compute for each bit */
+/*																			*/
+/*	Description:	Updates the CRC shift register with a block of bytes,	*/
+/*					four at a time where possible.  Carriage return			*/
+/*					characters are skipped, as in jam_check_crc().  The		*/
+/*					result is the same as calling jam_crc_update() for		*/
+/*					each byte.  jam_crc_init() must be called first.		*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	long index = 0L;
+	unsigned int value = 0;
+	unsigned short shift_register_copy = *shift_register;
+
+	while (index < length)
 	{
-		feedback = (data ^ shift_register_copy) & 0x01;
-		shift_register_copy >>= 1;	/* shift the shift register */
-		if (feedback)
+		if ((index + 4L <= length) &&
+			(data[index] != JAMC_RETURN_CHAR) &&
+			(data[index + 1] != JAMC_RETURN_CHAR) &&
+			(data[index + 2] != JAMC_RETURN_CHAR) &&
+			(data[index + 3] != JAMC_RETURN_CHAR))
 		{
-			shift_register_copy ^= 0x8408;	/* invert selected bits */
+			value = shift_register_copy ^
+				((unsigned int) (unsigned char) data[index]) ^
+				(((unsigned int) (unsigned char) data[index + 1]) << 8);
+
+			shift_register_copy = (unsigned short)
+				(jam_crc_slice_table[2][value & 0xff] ^
+				jam_crc_slice_table[1][value >> 8] ^
+				jam_crc_slice_table[0][(unsigned char) data[index + 2]] ^
+				jam_crc_table[(unsigned char) data[index + 3]]);
+
+			index += 4L;
+		}
+		else
+		{
+			if (data[index] != JAMC_RETURN_CHAR)
+			{
+				shift_register_copy = (unsigned short)
+					((shift_register_copy >> 8) ^
+					jam_crc_table[(shift_register_copy ^ data[index]) & 0xff]);
+			}
+
+			++index;
 		}
-		data >>= 1;		/* get the next bit of input_byte */
 	}
 
 	*shift_register = shift_register_copy;
@@ -97,6 +233,40 @@ int jam_hexchar(int ch)
 /****************************************************************************/
 /*																			*/
 
+int jam_crc_getc
+(
+	char *program,
+	long program_size,
+	long *read_position
+)
+
+/*																			*/
+/*	Description:	Gets the next character for jam_check_crc(), directly	*/
+/*					from the program buffer if one was given, else by		*/
+/*					calling jam_getc().										*/
+/*																			*/
+/*	Returns:		character value, or EOF at end of program				*/
+/*																			*/
+/****************************************************************************/
+{
+	int ch = EOF;
+
+	if (program == NULL)
+	{
+		ch = jam_getc();
+	}
+	else if (*read_position < program_size)
+	{
+		ch = (int) (unsigned char) program[*read_position];
+		++(*read_position);
+	}
+
+	return (ch);
+}
+
+/****************************************************************************/
+/*																			*/
+
 JAM_RETURN_TYPE jam_check_crc
 (
 	char *program,
@@ -115,6 +285,10 @@ JAM_RETURN_TYPE jam_check_crc
 /*					text format (with CR-LF) to UNIX text format (only LF)	*/
 /*					and visa-versa.											*/
 /*																			*/
+/*					The first pass only finds where the CRC statement		*/
+/*					begins; the CRC of the text before it is then			*/
+/*					computed in one block.									*/
+/*																			*/
 /*	Returns:		JAMC_SUCCESS for success, else appropriate error code	*/
 /*																			*/
 /****************************************************************************/
@@ -127,28 +301,35 @@ JAM_RETURN_TYPE jam_check_crc
 	int ch = 0;
 	long position = 0L;
 	long left_quote_position = -1L;
+	long read_position = 0L;
+	long crc_end_position = 0L;
 	unsigned short crc_shift_register = 0;
-	unsigned short crc_shift_register_backup[4] = {0};
+	long position_queue[4] = {0};
 	int ch_queue[4] = {0};
 	unsigned short tmp_expected_crc = 0;
 	unsigned short tmp_actual_crc = 0;
 	JAM_RETURN_TYPE status = JAMC_SUCCESS;
 
-	jam_program = program;
-	jam_program_size = program_size;
+	if (program == NULL)
+	{
+		jam_program = program;
+		jam_program_size = program_size;
 
-	status = jam_seek(0);
+		status = jam_seek(0);
+	}
+	else if (program_size <= 0L)
+	{
+		status = EOF;
+	}
 
 	jam_crc_init(&crc_shift_register);
 
 	while ((status == JAMC_SUCCESS) && (!found_expected_crc))
 	{
-		ch = jam_getc();
+		ch = jam_crc_getc(program, program_size, &read_position);
 
 		if ((ch != EOF) && (ch != JAMC_RETURN_CHAR))
 		{
-			jam_crc_update(&crc_shift_register, ch);
-
 			if ((!comment) && (!quoted_string))
 			{
 				if (ch == JAMC_COMMENT_CHAR)
@@ -176,18 +357,22 @@ JAM_RETURN_TYPE jam_check_crc
 				(jam_isspace((char) ch)))
 			{
 				status = JAMC_SYNTAX_ERROR;
-				crc_shift_register = crc_shift_register_backup[3];
+				crc_end_position = position_queue[2];
 
 				/* skip over any additional white space */
-				do { ch = jam_getc(); } while
+				do { ch = jam_crc_getc(program, program_size,
+					&read_position); } while
 					((ch != EOF) && (jam_isspace((char) ch)));
 
 				if (jam_is_hex_char((char) ch))
 				{
 					/* get remaining three characters of CRC */
-					ch_queue[2] = jam_getc();
-					ch_queue[1] = jam_getc();
-					ch_queue[0] = jam_getc();
+					ch_queue[2] = jam_crc_getc(program, program_size,
+						&read_position);
+					ch_queue[1] = jam_crc_getc(program, program_size,
+						&read_position);
+					ch_queue[0] = jam_crc_getc(program, program_size,
+						&read_position);
 
 					if ((jam_is_hex_char((char) ch_queue[2])) &&
 						(jam_is_hex_char((char) ch_queue[1])) &&
@@ -200,7 +385,8 @@ JAM_RETURN_TYPE jam_check_crc
 							jam_hexchar(ch_queue[0]));
 
 						/* skip over any additional white space */
-						do { ch = jam_getc(); } while
+						do { ch = jam_crc_getc(program, program_size,
+					&read_position); } while
 							((ch != EOF) && (jam_isspace((char) ch)));
 
 						if (ch == JAMC_SEMICOLON_CHAR)
@@ -250,7 +436,13 @@ JAM_RETURN_TYPE jam_check_crc
 
 		if (ch == EOF)
 		{
-			/* end of file */
+			/* end of file -- CRC covers the whole file, unless */
+			/* it ended inside the CRC statement */
+			if (status == JAMC_SUCCESS)
+			{
+				crc_end_position = position;
+			}
+
 			status = JAMC_UNEXPECTED_END;
 		}
 
@@ -263,10 +455,30 @@ JAM_RETURN_TYPE jam_check_crc
 			ch_queue[1] = ch_queue[0];
 			ch_queue[0] = ch;
 
-			crc_shift_register_backup[3] = crc_shift_register_backup[2];
-			crc_shift_register_backup[2] = crc_shift_register_backup[1];
-			crc_shift_register_backup[1] = crc_shift_register_backup[0];
-			crc_shift_register_backup[0] = crc_shift_register;
+			position_queue[3] = position_queue[2];
+			position_queue[2] = position_queue[1];
+			position_queue[1] = position_queue[0];
+			position_queue[0] = position - 1L;
+		}
+	}
+
+	/*
+	*	Compute the CRC of everything before crc_end_position
+	*/
+	if (program != NULL)
+	{
+		jam_crc_update_block(&crc_shift_register, program, crc_end_position);
+	}
+	else if ((crc_end_position > 0L) && (jam_seek(0) == 0))
+	{
+		for (position = 0L; position < crc_end_position; ++position)
+		{
+			ch = jam_getc();
+
+			if (ch != JAMC_RETURN_CHAR)
+			{
+				jam_crc_update(&crc_shift_register, ch);
+			}
 		}
 	}
 
@@ -290,3 +502,127 @@ JAM_RETURN_TYPE jam_check_crc
 
 	return (status);
 }
+
+/****************************************************************************/
+/*																			*/
+
+int jam_crc_check_work
+(
+	void *argument
+)
+
+/*																			*/
+/*	Description:	Runs the CRC check described by a JAMS_CRC_CHECK		*/
+/*					record.  This may run on a worker thread, so it only	*/
+/*					reads the program buffer and writes the record.			*/
+/*																			*/
+/*	Returns:		status of jam_check_crc()								*/
+/*																			*/
+/****************************************************************************/
+{
+	JAMS_CRC_CHECK *check = (JAMS_CRC_CHECK *) argument;
+
+	check->status = jam_check_crc(check->program, check->program_size,
+		&check->expected_crc, &check->actual_crc);
+
+	return ((int) check->status);
+}
+
+/****************************************************************************/
+/*																			*/
+
+JAM_RETURN_TYPE jam_start_crc_check
+(
+	char *program,
+	long program_size,
+	char *barrier_statement
+)
+
+/*																			*/
+/*	Description:	Starts checking the CRC of the program in memory, in	*/
+/*					the background if the host provides a worker thread,	*/
+/*					so that jam_execute() can begin at once.  The first		*/
+/*					statement of the type named by barrier_statement		*/
+/*					(DRSCAN if NULL or empty) waits for the check, and		*/
+/*					execution stops with JAMC_CRC_ERROR on a mismatch.		*/
+/*					jam_finish_crc_check() gets the result.					*/
+/*																			*/
+/*	Returns:		JAMC_SUCCESS for success, or JAMC_SYNTAX_ERROR if the	*/
+/*					barrier statement name is not recognized				*/
+/*																			*/
+/****************************************************************************/
+{
+	unsigned short crc_shift_register = 0;
+	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+
+	if ((barrier_statement == NULL) || (barrier_statement[0] == JAMC_NULL_CHAR))
+	{
+		barrier_statement = "DRSCAN";
+	}
+
+	jam_crc_barrier = jam_get_instruction(barrier_statement);
+
+	if (jam_crc_barrier == JAM_ILLEGAL_INSTR)
+	{
+		status = JAMC_SYNTAX_ERROR;
+	}
+	else
+	{
+		/* build the tables here, before the worker thread uses them */
+		jam_crc_init(&crc_shift_register);
+
+		jam_background_crc.program = program;
+		jam_background_crc.program_size = program_size;
+		jam_background_crc.expected_crc = 0;
+		jam_background_crc.actual_crc = 0;
+		jam_background_crc.status = JAMC_SUCCESS;
+		jam_background_crc.work =
+			jam_start_work(jam_crc_check_work, &jam_background_crc);
+
+		if (jam_background_crc.work == NULL)
+		{
+			/* no worker thread -- check it now */
+			jam_crc_check_work(&jam_background_crc);
+		}
+	}
+
+	return (status);
+}
+
+/****************************************************************************/
+/*																			*/
+
+JAM_RETURN_TYPE jam_finish_crc_check
+(
+	unsigned short *expected_crc,
+	unsigned short *actual_crc
+)
+
+/*																			*/
+/*	Description:	Waits for the CRC check started by						*/
+/*					jam_start_crc_check().  It may be called again to get	*/
+/*					the same result.  The barrier stays in place until the	*/
+/*					barrier statement runs, so a mismatch still stops it.	*/
+/*																			*/
+/*	Returns:		status of jam_check_crc()								*/
+/*																			*/
+/****************************************************************************/
+{
+	if (jam_background_crc.work != NULL)
+	{
+		jam_finish_work(jam_background_crc.work);
+		jam_background_crc.work = NULL;
+	}
+
+	if (expected_crc != NULL)
+	{
+		*expected_crc = jam_background_crc.expected_crc;
+	}
+
+	if (actual_crc != NULL)
+	{
+		*actual_crc = jam_background_crc.actual_crc;
+	}
+
+	return (jam_background_crc.status);
+}
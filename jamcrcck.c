@@ -0,0 +1,217 @@
+/****************************************************************************/
+/*																			*/
+/*	Module:			jamcrcck.c												*/
+/*																			*/
+/*	Description:	Checks the CRC functions in jamcrc.c against the		*/
+/*					original bit-at-a-time update, which is kept here for	*/
+/*					the purpose.  The table update, and the byte and		*/
+/*					four-byte paths of jam_crc_update_block(), are checked	*/
+/*					for every shift register and byte value, and then on	*/
+/*					random blocks with many carriage returns and 0xFF		*/
+/*					bytes.													*/
+/*																			*/
+/*					Usage: jamcrcck [<blocks>]								*/
+/*																			*/
+/****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "jamexprt.h"
+#include "jamdefs.h"
+#include "jamexec.h"
+
+#define CHECK_BLOCKS 20000L			/* random blocks, by default */
+#define CHECK_MAX_BLOCK 300
+
+void jam_crc_init(unsigned short *shift_register);
+void jam_crc_update(unsigned short *shift_register, int data);
+void jam_crc_update_block(unsigned short *shift_register, char *data,
+	long length);
+
+/************************************************************************
+*
+*	Interpreter functions
+*
+*	jamcrc.c is linked without the interpreter.  The functions it uses
+*	to find the CRC statement are not reached by these checks.
+*/
+
+char *jam_program = NULL;
+long jam_program_size = 0L;
+JAME_INSTRUCTION jam_crc_barrier = JAM_ILLEGAL_INSTR;
+
+int jam_getc(void) { return (EOF); }
+int jam_seek(long offset) { return (EOF); }
+void *jam_start_work(int (*function)(void *), void *argument) { return (NULL); }
+int jam_finish_work(void *work) { return (0); }
+JAME_INSTRUCTION jam_get_instruction(char *statement_buffer)
+{
+	return (JAM_ILLEGAL_INSTR);
+}
+
+/************************************************************************
+*
+*	Original update
+*
+*	This is jam_crc_update() as it was before the lookup tables.
+*/
+
+void old_crc_update(unsigned short *shift_register, int data)
+{
+	int bit, feedback;
+	unsigned short shift_register_copy;
+
+	shift_register_copy = *shift_register;	/* copy it to local variable */
+
+	for (bit = 0; bit < 8; bit++)	/* compute for each bit */
+	{
+		feedback = (data ^ shift_register_copy) & 0x01;
+		shift_register_copy >>= 1;	/* shift the shift register */
+		if (feedback)
+		{
+			shift_register_copy ^= 0x8408;	/* invert selected bits */
+		}
+		data >>= 1;		/* get the next bit of input_byte */
+	}
+
+	*shift_register = shift_register_copy;
+}
+
+/* the block update, one byte at a time, skipping carriage returns */
+unsigned short old_crc_block(unsigned short shift_register, char *data,
+	long length)
+{
+	long i = 0L;
+
+	for (i = 0L; i < length; ++i)
+	{
+		if (data[i] != JAMC_RETURN_CHAR)
+		{
+			old_crc_update(&shift_register, (unsigned char) data[i]);
+		}
+	}
+
+	return (shift_register);
+}
+
+/************************************************************************
+*
+*	Checks
+*/
+
+unsigned long check_seed = 1UL;
+long failures = 0L;
+
+int check_random(int range)
+{
+	check_seed = check_seed * 1103515245UL + 12345UL;
+
+	return ((int) ((check_seed >> 16) & 0x7fffUL) % range);
+}
+
+void report(char *kind, unsigned int start, int data, unsigned int expected,
+	unsigned int actual)
+{
+	if (failures < 10L)
+	{
+		fprintf(stderr,
+			"%s: register %04X, byte %02X: expected %04X, got %04X\n",
+			kind, start, data, expected, actual);
+	}
+
+	++failures;
+}
+
+/* a byte which is not a carriage return, so the block takes four at once */
+char not_return(unsigned int value)
+{
+	char ch = (char) (value & 0xff);
+
+	return ((ch == JAMC_RETURN_CHAR) ? (char) 0xff : ch);
+}
+
+int main(int argc, char **argv)
+{
+	long blocks = CHECK_BLOCKS;
+	long block = 0L;
+	long length = 0L;
+	long split = 0L;
+	long i = 0L;
+	unsigned int start = 0;
+	unsigned short expected = 0;
+	unsigned short actual = 0;
+	int data = 0;
+	int kind = 0;
+	char bytes[CHECK_MAX_BLOCK];
+
+	if (argc > 1) blocks = atol(argv[1]);
+
+	jam_crc_init(&actual);
+
+	for (start = 0; start < 0x10000; ++start)
+	{
+		for (data = 0; data < 256; ++data)
+		{
+			expected = (unsigned short) start;
+			old_crc_update(&expected, data);
+
+			actual = (unsigned short) start;
+			jam_crc_update(&actual, data);
+			if (actual != expected) report("table", start, data, expected, actual);
+
+			/* a single byte takes the byte path of the block update */
+			bytes[0] = (char) data;
+			expected = old_crc_block((unsigned short) start, bytes, 1L);
+			actual = (unsigned short) start;
+			jam_crc_update_block(&actual, bytes, 1L);
+			if (actual != expected) report("byte", start, data, expected, actual);
+
+			/* four bytes take the slice path, with the byte in each place */
+			bytes[0] = not_return(start);
+			bytes[1] = not_return(start >> 8);
+			bytes[2] = not_return(start ^ (unsigned int) data);
+			bytes[3] = not_return((unsigned int) data * 7U);
+			bytes[start & 3] = not_return((unsigned int) data);
+			expected = old_crc_block((unsigned short) start, bytes, 4L);
+			actual = (unsigned short) start;
+			jam_crc_update_block(&actual, bytes, 4L);
+			if (actual != expected) report("slice", start, data, expected, actual);
+		}
+	}
+
+	for (block = 0L; block < blocks; ++block)
+	{
+		start = (unsigned int) check_random(0x8000) * 2U +
+			(unsigned int) check_random(2);
+		length = (long) check_random(CHECK_MAX_BLOCK + 1);
+
+		for (i = 0L; i < length; ++i)
+		{
+			kind = check_random(8);
+
+			if (kind == 0) bytes[i] = JAMC_RETURN_CHAR;
+			else if (kind == 1) bytes[i] = JAMC_NEWLINE_CHAR;
+			else if (kind == 2) bytes[i] = (char) 0xff;
+			else bytes[i] = (char) check_random(256);
+		}
+
+		expected = old_crc_block((unsigned short) start, bytes, length);
+
+		actual = (unsigned short) start;
+		jam_crc_update_block(&actual, bytes, length);
+		if (actual != expected) report("block", start, -1, expected, actual);
+
+		/* the register carries over between blocks at any split */
+		split = (length > 0L) ? (long) check_random((int) length + 1) : 0L;
+		actual = (unsigned short) start;
+		jam_crc_update_block(&actual, bytes, split);
+		jam_crc_update_block(&actual, &bytes[split], length - split);
+		if (actual != expected) report("split block", start, -1, expected, actual);
+	}
+
+	printf("%ld register and byte values, %ld random blocks: %ld failures\n",
+		0x10000L * 256L, blocks, failures);
+
+	return ((failures == 0L) ? 0 : 1);
+}
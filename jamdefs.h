@@ -49,6 +49,9 @@
 /* size (in bytes) of cache buffer for initialized arrays */
 #define JAMC_ARRAY_CACHE_SIZE 1024
 
+/* initialized arrays with more elements than this are decoded when used */
+#define JAMC_LAZY_ARRAY_SIZE 4096
+
 /* character length limits */
 #define JAMC_MAX_STATEMENT_LENGTH ((const int) jam_statement_buffer_size)
 #define JAMC_MAX_NAME_LENGTH 32
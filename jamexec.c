@@ -33,6 +33,8 @@
 #include "jamarray.h"
 #include "jamjtag.h"
 #include "jamcomp.h"
+#include "jamopt.h"
+#include "jamarena.h"
 
 /****************************************************************************/
 /*																			*/
@@ -64,6 +66,59 @@ long jam_next_statement_position = 0L;
 
 unsigned int jam_statement_buffer_size = 0L;
 
+/* statement which must wait for the CRC check started by */
+/* jam_start_crc_check() before it runs (JAM_ILLEGAL_INSTR if none) */
+JAME_INSTRUCTION jam_crc_barrier = JAM_ILLEGAL_INSTR;
+
+/* TRUE if reading and decoding are marked with jam_profile_phase() */
+BOOL jam_profiling = FALSE;
+
+/* TRUE if each statement is reported to jam_profile_statement() */
+BOOL jam_profiling_statements = FALSE;
+
+/* number of statements executed since jam_execute() began */
+long jam_statement_count = 0L;
+
+/* TRUE while the optimizer scans the program -- jam_get_statement() */
+/* then skips literal Boolean array data instead of reading it */
+BOOL jam_skip_array_data = FALSE;
+
+/*
+*	Statement cache -- holds the preprocessed text of statements which
+*	have been read more than once (e.g. loop bodies and procedures), so
+*	that reading them again does not repeat the character-by-character
+*	work in jam_get_statement().  An entry with NULL text records that
+*	the statement at that position has been read once.
+*/
+#define JAMC_STATEMENT_CACHE_SIZE 1021	/* should be a prime number */
+#define JAMC_MAX_STATEMENT_CACHE_BYTES 0x40000L
+
+typedef struct JAMS_STATEMENT_CACHE_STRUCT
+{
+	long position;				/* file position before the statement */
+	long end_position;			/* file position after the statement */
+	long statement_position;	/* position of first character */
+	long next_statement_position;
+	char *text;					/* preprocessed statement text */
+	char label[JAMC_MAX_NAME_LENGTH + 1];
+
+} JAMS_STATEMENT_CACHE_RECORD;
+
+JAMS_STATEMENT_CACHE_RECORD *jam_statement_cache = NULL;
+
+long jam_statement_cache_bytes = 0L;
+
+/* table of the position of the first character of each line, used to */
+/* find line numbers quickly (NULL if the table could not be built) */
+long *jam_line_table = NULL;
+
+/* number of entries in jam_line_table */
+long jam_line_count = 0L;
+
+/* line table supplied by the caller, used instead of building one */
+long *jam_preset_line_table = NULL;
+long jam_preset_line_count = 0L;
+
 /* name of desired action (Jam 2.0 only) */
 char *jam_action = NULL;
 
@@ -102,7 +157,7 @@ JAM_RETURN_TYPE jam_execute_statement(char *statement_buffer, BOOL *done,
 	BOOL *reuse_statement_buffer, int *exit_code);
 
 /* prototype for external function in jamarray.c */
-extern int jam_6bit_char(int ch);
+extern long jam_pack_6bit_chars(char *buffer, char **terminator);
 
 /* prototype for external function in jamsym.c */
 extern BOOL jam_check_init_list(char *name, long *value);
@@ -308,7 +363,9 @@ JAM_RETURN_TYPE jam_init_statement_buffer
 
 	if ((status == JAMC_SUCCESS) && (max_index != 0))
 	{
-		*statement_buffer = (char *) jam_malloc((unsigned int) (max_index + 1024));
+		/* one more byte for the terminator which jam_get_statement() */
+		/* writes after a statement of the greatest length */
+		*statement_buffer = (char *) jam_arena_malloc((unsigned int) (max_index + 1025));
 
 		if (*statement_buffer == NULL)
 		{
@@ -354,7 +411,7 @@ void jam_free_statement_buffer
 {
 	if (statement_buffer && *statement_buffer)
 	{
-		jam_free(*statement_buffer);
+		jam_arena_free(*statement_buffer);
 		*statement_buffer = 0;
 		*statement_buffer_size = 0;
 	}
@@ -363,6 +420,174 @@ void jam_free_statement_buffer
 /****************************************************************************/
 /*																			*/
 
+void jam_init_statement_cache(void)
+
+/*																			*/
+/*	Description:	Allocates the statement cache.  The cache is not used	*/
+/*					when the program runs in a fixed-size workspace, or if	*/
+/*					memory is not available.								*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	int index = 0;
+
+	jam_statement_cache = NULL;
+	jam_statement_cache_bytes = 0L;
+
+	if (jam_workspace == NULL)
+	{
+		jam_statement_cache = (JAMS_STATEMENT_CACHE_RECORD *) jam_malloc(
+			JAMC_STATEMENT_CACHE_SIZE * sizeof(JAMS_STATEMENT_CACHE_RECORD));
+
+		if (jam_statement_cache != NULL)
+		{
+			for (index = 0; index < JAMC_STATEMENT_CACHE_SIZE; ++index)
+			{
+				jam_statement_cache[index].position = -1L;
+				jam_statement_cache[index].text = NULL;
+			}
+		}
+	}
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_free_statement_cache(void)
+
+/*																			*/
+/*	Description:	Frees the statement cache and all cached text.			*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	int index = 0;
+
+	if (jam_statement_cache != NULL)
+	{
+		for (index = 0; index < JAMC_STATEMENT_CACHE_SIZE; ++index)
+		{
+			if (jam_statement_cache[index].text != NULL)
+			{
+				jam_free(jam_statement_cache[index].text);
+			}
+		}
+
+		jam_free(jam_statement_cache);
+		jam_statement_cache = NULL;
+	}
+
+	jam_statement_cache_bytes = 0L;
+}
+
+/****************************************************************************/
+/*																			*/
+
+long jam_find_statement_end
+(
+	long position
+)
+
+/*																			*/
+/*	Description:	Searches the program in memory, starting at position,	*/
+/*					for the semicolon which ends the statement.  Comments	*/
+/*					and quoted strings are skipped as in					*/
+/*					jam_get_statement().									*/
+/*																			*/
+/*	Returns:		position of the semicolon, or -1 if the program ends	*/
+/*					first													*/
+/*																			*/
+/****************************************************************************/
+{
+	char ch = 0;
+	long result = -1L;
+	BOOL comment = FALSE;
+	BOOL quoted_string = FALSE;
+
+	while ((result < 0L) && (position < jam_program_size))
+	{
+		ch = jam_program[position];
+
+		if (comment)
+		{
+			comment = ((ch != JAMC_NEWLINE_CHAR) && (ch != JAMC_RETURN_CHAR));
+		}
+		else if (quoted_string)
+		{
+			quoted_string = (ch != JAMC_QUOTE_CHAR);
+		}
+		else if (ch == JAMC_COMMENT_CHAR)
+		{
+			comment = TRUE;
+		}
+		else if (ch == JAMC_QUOTE_CHAR)
+		{
+			quoted_string = TRUE;
+		}
+		else if (ch == JAMC_SEMICOLON_CHAR)
+		{
+			result = position;
+		}
+
+		++position;
+	}
+
+	return (result);
+}
+
+/****************************************************************************/
+/*																			*/
+
+BOOL jam_is_array_data_start
+(
+	char *statement_buffer,
+	int index
+)
+
+/*																			*/
+/*	Description:	Checks whether the first index characters of the		*/
+/*					statement end with an equal sign followed by a #, $ or	*/
+/*					@ character, or by a BIN, HEX, RLC or ACA keyword and	*/
+/*					a space, so that the rest of the statement is literal	*/
+/*					Boolean array data.										*/
+/*																			*/
+/*	Returns:		TRUE if the array data begins here, else FALSE			*/
+/*																			*/
+/****************************************************************************/
+{
+	int equal_index = -1;
+	char ch = (index > 0) ? statement_buffer[index - 1] : JAMC_NULL_CHAR;
+
+	if ((ch == JAMC_POUND_CHAR) || (ch == JAMC_DOLLAR_CHAR) ||
+		(ch == JAMC_AT_CHAR))
+	{
+		equal_index = index - 2;
+	}
+	else if ((ch == JAMC_SPACE_CHAR) && (index >= 5) &&
+		((jam_strncmp(&statement_buffer[index - 4], "BIN", 3) == 0) ||
+		(jam_strncmp(&statement_buffer[index - 4], "HEX", 3) == 0) ||
+		(jam_strncmp(&statement_buffer[index - 4], "RLC", 3) == 0) ||
+		(jam_strncmp(&statement_buffer[index - 4], "ACA", 3) == 0)))
+	{
+		equal_index = index - 5;
+	}
+
+	if ((equal_index > 0) &&
+		(statement_buffer[equal_index] == JAMC_SPACE_CHAR))
+	{
+		--equal_index;
+	}
+
+	return ((equal_index >= 0) &&
+		(statement_buffer[equal_index] == JAMC_EQUAL_CHAR));
+}
+
+/****************************************************************************/
+/*																			*/
+
 JAM_RETURN_TYPE jam_get_statement
 (
 	char *statement_buffer,
@@ -377,6 +602,16 @@ JAM_RETURN_TYPE jam_get_statement
 /*					the buffer but must be read from the input stream when	*/
 /*					the array is used.										*/
 /*																			*/
+/*					If the statement is in the statement cache, the			*/
+/*					cached text is copied and the input stream is moved		*/
+/*					past the statement.  The second time a statement is		*/
+/*					read it is added to the cache.							*/
+/*																			*/
+/*					While jam_skip_array_data is set and the program is in	*/
+/*					memory, literal Boolean array data is skipped, and the	*/
+/*					statement ends after the character or keyword which		*/
+/*					begins it.												*/
+/*																			*/
 /*	Returns:		JAMC_SUCCESS for success, else appropriate error code	*/
 /*																			*/
 /****************************************************************************/
@@ -391,15 +626,41 @@ JAM_RETURN_TYPE jam_get_statement
 	BOOL literal_aca_array = FALSE;
 	BOOL label_found = FALSE;
 	BOOL done = FALSE;
+	BOOL cached = FALSE;
 	long position = jam_current_file_position;
 	long first_char_position = -1L;
 	long semicolon_position = -1L;
 	long left_quote_position = -1L;
+	long end_position = -1L;
+	JAMS_STATEMENT_CACHE_RECORD *cache_record = NULL;
 	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+	int profile_phase = JAMC_PROFILE_EXECUTE;
+
+	if (jam_profiling) profile_phase = jam_profile_phase(JAMC_PROFILE_READ);
 
 	label_buffer[0] = JAMC_NULL_CHAR;
 	statement_buffer[0] = JAMC_NULL_CHAR;
 
+	if (jam_statement_cache != NULL)
+	{
+		cache_record = &jam_statement_cache[
+			(int) (jam_current_file_position % JAMC_STATEMENT_CACHE_SIZE)];
+
+		if ((cache_record->position == jam_current_file_position) &&
+			(cache_record->text != NULL) &&
+			(jam_seek(cache_record->end_position) == 0))
+		{
+			jam_strcpy(statement_buffer, cache_record->text);
+			jam_strcpy(label_buffer, cache_record->label);
+			jam_current_file_position = cache_record->end_position;
+			jam_current_statement_position = cache_record->statement_position;
+			jam_next_statement_position =
+				cache_record->next_statement_position;
+			cached = TRUE;
+			done = TRUE;
+		}
+	}
+
 	while (!done)
 	{
 		last_ch = ch;
@@ -512,6 +773,19 @@ JAM_RETURN_TYPE jam_get_statement
 				/* this is the end of the literal ACA array */
 				literal_aca_array = FALSE;
 			}
+
+			/* go straight to the semicolon after literal array data */
+			if (jam_skip_array_data && boolean_array_data &&
+				(jam_program != NULL) && (!quoted_string) &&
+				jam_is_array_data_start(statement_buffer, index))
+			{
+				end_position = jam_find_statement_end(position + 1L);
+
+				if ((end_position > position) && (jam_seek(end_position) == 0))
+				{
+					position = end_position - 1L;
+				}
+			}
 		}
 
 		if ((!comment) && (!quoted_string) && (ch == JAMC_SEMICOLON_CHAR))
@@ -544,27 +818,72 @@ JAM_RETURN_TYPE jam_get_statement
 		++position;	/* position of next character to be read */
 	}
 
-	if (index < JAMC_MAX_STATEMENT_LENGTH)
+	if (!cached)
 	{
-		statement_buffer[index] = JAMC_NULL_CHAR;
-	}
-	else
-	{
-		statement_buffer[JAMC_MAX_STATEMENT_LENGTH] = JAMC_NULL_CHAR;
-	}
+		if (index < JAMC_MAX_STATEMENT_LENGTH)
+		{
+			statement_buffer[index] = JAMC_NULL_CHAR;
+		}
+		else
+		{
+			statement_buffer[JAMC_MAX_STATEMENT_LENGTH] = JAMC_NULL_CHAR;
+		}
 
-	jam_current_file_position = position;
+		/*
+		*	Add complete statements to the cache when they are read for
+		*	the second time.  The first time, just note the position.
+		*/
+		if ((cache_record != NULL) && (status == JAMC_SUCCESS) &&
+			(index < JAMC_MAX_STATEMENT_LENGTH) &&
+			(first_char_position != -1L) && (semicolon_position != -1L))
+		{
+			if (cache_record->position != jam_current_file_position)
+			{
+				if (cache_record->text != NULL)
+				{
+					jam_statement_cache_bytes -=
+						(long) jam_strlen(cache_record->text) + 1L;
+					jam_free(cache_record->text);
+					cache_record->text = NULL;
+				}
 
-	if (first_char_position != -1L)
-	{
-		jam_current_statement_position = first_char_position;
-	}
+				cache_record->position = jam_current_file_position;
+			}
+			else if ((cache_record->text == NULL) &&
+				((jam_statement_cache_bytes + index + 1L) <=
+				JAMC_MAX_STATEMENT_CACHE_BYTES))
+			{
+				cache_record->text = (char *) jam_malloc(
+					(unsigned int) (index + 1));
 
-	if (semicolon_position != -1L)
-	{
-		jam_next_statement_position = semicolon_position + 1;
+				if (cache_record->text != NULL)
+				{
+					jam_strcpy(cache_record->text, statement_buffer);
+					jam_strcpy(cache_record->label, label_buffer);
+					cache_record->end_position = position;
+					cache_record->statement_position = first_char_position;
+					cache_record->next_statement_position =
+						semicolon_position + 1;
+					jam_statement_cache_bytes += (long) index + 1L;
+				}
+			}
+		}
+
+		jam_current_file_position = position;
+
+		if (first_char_position != -1L)
+		{
+			jam_current_statement_position = first_char_position;
+		}
+
+		if (semicolon_position != -1L)
+		{
+			jam_next_statement_position = semicolon_position + 1;
+		}
 	}
 
+	if (jam_profiling) jam_profile_phase(profile_phase);
+
 	return (status);
 }
 
@@ -702,6 +1021,36 @@ JAME_INSTRUCTION jam_get_instruction
 /****************************************************************************/
 /*																			*/
 
+char *jam_get_instruction_name
+(
+	JAME_INSTRUCTION instruction
+)
+
+/*																			*/
+/*	Description:	Looks up the name of an instruction code				*/
+/*																			*/
+/*	Returns:		name of instruction, or NULL for an assignment			*/
+/*					statement, which has no instruction name				*/
+/*																			*/
+/****************************************************************************/
+{
+	int index = 0;
+	char *name = NULL;
+
+	for (index = 0; (name == NULL) && (index < JAMC_INSTR_COUNT); index++)
+	{
+		if (jam_instruction_table[index].instruction == instruction)
+		{
+			name = jam_instruction_table[index].string;
+		}
+	}
+
+	return (name);
+}
+
+/****************************************************************************/
+/*																			*/
+
 int jam_skip_instruction_name
 (
 	char *statement_buffer
@@ -1226,16 +1575,13 @@ JAM_RETURN_TYPE jam_convert_literal_aca
 /*																			*/
 /****************************************************************************/
 {
-	int bit = 0;
-	int value = 0;
-	int index = 0;
-	int index2 = 0;
 	int i = 0;
 	int j = 0;
 	int long_count = 0;
 	long binary_compressed_length = 0L;
 	long uncompressed_length = 0L;
 	char *buffer = NULL;
+	char *terminator = NULL;
 	long *long_ptr = NULL;
 	long out_size = 0L;
 	long address = 0L;
@@ -1246,59 +1592,15 @@ JAM_RETURN_TYPE jam_convert_literal_aca
 		status = JAMC_INTERNAL_ERROR;
 	}
 
-	/* remove all white space */
-	while (statement_buffer[index] != JAMC_NULL_CHAR)
-	{
-		if ((!jam_isspace(statement_buffer[index])) &&
-			(statement_buffer[index] != JAMC_TAB_CHAR) &&
-			(statement_buffer[index] != JAMC_RETURN_CHAR) &&
-			(statement_buffer[index] != JAMC_NEWLINE_CHAR))
-		{
-			statement_buffer[index2] = statement_buffer[index];
-			++index2;
-		}
-		++index;
-	}
-	statement_buffer[index2] = JAMC_NULL_CHAR;
-
 	/* convert 6-bit encoded characters to binary -- in the same buffer */
-	index = 0;
-	while ((status == JAMC_SUCCESS) &&
-		(jam_isalnum(statement_buffer[index]) ||
-		(statement_buffer[index] == JAMC_AT_CHAR) ||
-		(statement_buffer[index] == JAMC_UNDERSCORE_CHAR)))
+	if (status == JAMC_SUCCESS)
 	{
-		value = jam_6bit_char(statement_buffer[index]);
-		statement_buffer[index] = 0;
+		address = jam_pack_6bit_chars(statement_buffer, &terminator);
 
-		if (value == -1)
+		if (*terminator != JAMC_NULL_CHAR)
 		{
 			status = JAMC_SYNTAX_ERROR;
 		}
-		else
-		{
-			for (bit = 0; bit < 6; ++bit)
-			{
-				if (value & (1 << (bit % 6)))
-				{
-					statement_buffer[address >> 3] |= (1L << (address & 7));
-				}
-				else
-				{
-					statement_buffer[address >> 3] &=
-						~(unsigned int) (1 << (address & 7));
-				}
-				++address;
-			}
-		}
-
-		++index;
-	}
-
-	if ((status == JAMC_SUCCESS) &&
-		(statement_buffer[index] != JAMC_NULL_CHAR))
-	{
-		status = JAMC_SYNTAX_ERROR;
 	}
 
 	/* Compute length of binary data string in statement_buffer */
@@ -1322,7 +1624,9 @@ JAM_RETURN_TYPE jam_convert_literal_aca
 		}
 #else
 		buffer = jam_malloc(uncompressed_length + 4);
-		long_ptr = (long *) jam_malloc(uncompressed_length + 4);
+		/* one long for every four bytes -- a long may be wider */
+		long_ptr = (long *) jam_malloc(
+			((uncompressed_length + 3) / 4) * sizeof(long) + 4);
 #endif
 
 		if ((buffer == NULL) || (long_ptr == NULL))
@@ -1402,6 +1706,8 @@ JAM_RETURN_TYPE jam_get_array_argument
 	int expr_end = 0;
 	int bracket_count = 0;
 	long literal_array_length = 0;
+	long first_index = 0L;
+	long last_index = 0L;
 	char save_ch = 0;
 	JAMS_SYMBOL_RECORD *tmp_symbol_rec = NULL;
 	JAMS_HEAP_RECORD *heap_record = NULL;
@@ -1695,6 +2001,45 @@ JAM_RETURN_TYPE jam_get_array_argument
 		}
 	}
 
+	/*
+	*	Decode the data of an initialized array when it is first used
+	*/
+	if ((status == JAMC_SUCCESS) && (heap_record != NULL) &&
+		heap_record->pending)
+	{
+		status = jam_decode_array_data(heap_record);
+	}
+
+	/*
+	*	The data of a cached array is not in the heap.  Decode the
+	*	sub-range into a temporary buffer, and pass it back as a literal.
+	*/
+	if ((status == JAMC_SUCCESS) && (heap_record != NULL) &&
+		heap_record->cached)
+	{
+		first_index = (*start_index < *stop_index) ?
+			*start_index : *stop_index;
+		last_index = (*start_index < *stop_index) ?
+			*stop_index : *start_index;
+
+		*literal_array_data = jam_get_temp_array(
+			(((last_index - first_index) >> 5) + 1) * sizeof(long));
+
+		if (*literal_array_data == NULL)
+		{
+			status = JAMC_OUT_OF_MEMORY;
+		}
+		else
+		{
+			status = jam_get_cached_array_data(heap_record,
+				first_index, last_index, *literal_array_data);
+		}
+
+		*symbol_record = NULL;
+		*start_index -= first_index;
+		*stop_index -= first_index;
+	}
+
 	return (status);
 }
 
@@ -5986,50 +6331,62 @@ JAM_RETURN_TYPE jam_process_next
 		return (JAMC_PHASE_ERROR);
 	}
 
-	index = jam_skip_instruction_name(statement_buffer);
+	/*
+	*	If this NEXT statement has already been matched to the FOR loop on
+	*	top of the stack, the iterator is known -- skip parsing the
+	*	statement and looking up the variable name.
+	*/
+	stack_record = jam_peek_stack_record();
 
-	if (jam_isalpha(statement_buffer[index]))
+	if ((stack_record != NULL) &&
+		(stack_record->type == JAM_STACK_FOR_NEXT) &&
+		(stack_record->next_position == jam_current_statement_position))
 	{
-		/* locate variable name */
-		variable_begin = index;
-		while ((jam_is_name_char(statement_buffer[index])) &&
-			(index < JAMC_MAX_STATEMENT_LENGTH))
-		{
-			++index;	/* skip over variable name */
-		}
-		variable_end = index;
+		symbol_record = stack_record->iterator;
+		status = JAMC_SUCCESS;
+	}
+	else
+	{
+		index = jam_skip_instruction_name(statement_buffer);
 
-		while ((jam_isspace(statement_buffer[index])) &&
-			(index < JAMC_MAX_STATEMENT_LENGTH))
+		if (jam_isalpha(statement_buffer[index]))
 		{
-			++index;	/* skip over white space */
-		}
+			/* locate variable name */
+			variable_begin = index;
+			while ((jam_is_name_char(statement_buffer[index])) &&
+				(index < JAMC_MAX_STATEMENT_LENGTH))
+			{
+				++index;	/* skip over variable name */
+			}
+			variable_end = index;
 
-		if (statement_buffer[index] == JAMC_SEMICOLON_CHAR)
-		{
-			/*
-			*	Look in symbol table for iterator variable
-			*/
-			save_ch = statement_buffer[variable_end];
-			statement_buffer[variable_end] = JAMC_NULL_CHAR;
-			status = jam_get_symbol_record(
-				&statement_buffer[variable_begin], &symbol_record);
-			statement_buffer[variable_end] = save_ch;
+			while ((jam_isspace(statement_buffer[index])) &&
+				(index < JAMC_MAX_STATEMENT_LENGTH))
+			{
+				++index;	/* skip over white space */
+			}
 
-			if ((status == JAMC_SUCCESS) &&
-				(symbol_record->type != JAM_INTEGER_SYMBOL))
+			if (statement_buffer[index] == JAMC_SEMICOLON_CHAR)
 			{
-				status = JAMC_TYPE_MISMATCH;
+				/*
+				*	Look in symbol table for iterator variable
+				*/
+				save_ch = statement_buffer[variable_end];
+				statement_buffer[variable_end] = JAMC_NULL_CHAR;
+				status = jam_get_symbol_record(
+					&statement_buffer[variable_begin], &symbol_record);
+				statement_buffer[variable_end] = save_ch;
+
+				if ((status == JAMC_SUCCESS) &&
+					(symbol_record->type != JAM_INTEGER_SYMBOL))
+				{
+					status = JAMC_TYPE_MISMATCH;
+				}
 			}
 		}
 
 		if (status == JAMC_SUCCESS)
 		{
-			/*
-			*	Get stack record at top of stack
-			*/
-			stack_record = jam_peek_stack_record();
-
 			/*
 			*	Compare iterator to stack record
 			*/
@@ -6041,41 +6398,45 @@ JAM_RETURN_TYPE jam_process_next
 			}
 			else
 			{
-				/*
-				*	Check if loop has run to completion
-				*/
-				if (((stack_record->step_value > 0) &&
-					(symbol_record->value >= stack_record->stop_value)) ||
-					((stack_record->step_value < 0) &&
-					(symbol_record->value <= stack_record->stop_value)))
-				{
-					/*
-					*	Loop has run to completion -- pop the stack record.
-					*	(Do not jump back to FOR statement position.)
-					*/
-					status = jam_pop_stack_record();
-				}
-				else
-				{
-					/*
-					*	Increment (or step) the iterator variable
-					*/
-					symbol_record->value += stack_record->step_value;
+				/* remember this NEXT statement for later iterations */
+				stack_record->next_position = jam_current_statement_position;
+			}
+		}
+	}
 
-					/*
-					*	Jump back to the top of the loop
-					*/
-					if (jam_seek(stack_record->for_position) == 0)
-					{
-						jam_current_file_position =
-							stack_record->for_position;
-						status = JAMC_SUCCESS;
-					}
-					else
-					{
-						status = JAMC_IO_ERROR;
-					}
-				}
+	if (status == JAMC_SUCCESS)
+	{
+		/*
+		*	Check if loop has run to completion
+		*/
+		if (((stack_record->step_value > 0) &&
+			(symbol_record->value >= stack_record->stop_value)) ||
+			((stack_record->step_value < 0) &&
+			(symbol_record->value <= stack_record->stop_value)))
+		{
+			/*
+			*	Loop has run to completion -- pop the stack record.
+			*	(Do not jump back to FOR statement position.)
+			*/
+			status = jam_pop_stack_record();
+		}
+		else
+		{
+			/*
+			*	Increment (or step) the iterator variable
+			*/
+			symbol_record->value += stack_record->step_value;
+
+			/*
+			*	Jump back to the top of the loop
+			*/
+			if (jam_seek(stack_record->for_position) == 0)
+			{
+				jam_current_file_position = stack_record->for_position;
+			}
+			else
+			{
+				status = JAMC_IO_ERROR;
 			}
 		}
 	}
@@ -8384,6 +8745,29 @@ JAM_RETURN_TYPE jam_execute_statement
 	JAM_RETURN_TYPE status = JAMC_SUCCESS;
 
 	instruction_code = jam_get_instruction(statement_buffer);
+	++jam_statement_count;
+
+	if (jam_profiling_statements)
+	{
+		/* without a line table, finding the line would move the file */
+		jam_profile_statement(
+			(jam_line_count > 0L) ?
+				jam_get_line_of_position(jam_current_statement_position) : 0L,
+			jam_get_instruction_name(instruction_code),
+			(jam_current_block == NULL) ? NULL : jam_current_block->name);
+	}
+
+	if ((instruction_code == jam_crc_barrier) &&
+		(instruction_code != JAM_ILLEGAL_INSTR))
+	{
+		/* don't run this statement until the file CRC has been checked */
+		jam_crc_barrier = JAM_ILLEGAL_INSTR;
+
+		if (jam_finish_crc_check(NULL, NULL) == JAMC_CRC_ERROR)
+		{
+			return (JAMC_CRC_ERROR);
+		}
+	}
 
 	switch (instruction_code)
 	{
@@ -8549,6 +8933,7 @@ JAM_RETURN_TYPE jam_execute_statement
 	}
 
 	jam_free_literal_aca_buffers();
+	jam_free_temp_arrays();
 
 	return (status);
 }
@@ -8556,6 +8941,226 @@ JAM_RETURN_TYPE jam_execute_statement
 /****************************************************************************/
 /*																			*/
 
+void jam_init_line_table(void)
+
+/*																			*/
+/*	Description:	Records the position where each line begins, so that	*/
+/*					line numbers can be found by jam_get_line_of_position()	*/
+/*					without rereading the file.  When the program is in		*/
+/*					memory it is scanned once, and the table is grown as	*/
+/*					lines are found; otherwise the input stream is read		*/
+/*					twice, to count the lines and then to record them.		*/
+/*					The table is not built when the program runs in a		*/
+/*					fixed-size workspace, or when one was given to			*/
+/*					jam_set_line_table().  The input stream is returned to	*/
+/*					jam_current_file_position.								*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	long position = 0L;
+	long line = 0L;
+	long capacity = 0L;
+	long index = 0L;
+	long *new_table = NULL;
+	int ch = 0;
+
+	jam_line_table = NULL;
+	jam_line_count = 0L;
+
+	if (jam_preset_line_table != NULL)
+	{
+		jam_line_table = jam_preset_line_table;
+		jam_line_count = jam_preset_line_count;
+	}
+	else if ((jam_workspace == NULL) && (jam_program != NULL))
+	{
+		/*
+		*	Scan the program buffer once, doubling the table when it fills
+		*/
+		capacity = (jam_program_size / 32L) + 16L;
+		jam_line_table = (long *) jam_malloc(
+			(unsigned int) (capacity * sizeof(long)));
+
+		if (jam_line_table != NULL)
+		{
+			jam_line_table[0] = 0L;
+			jam_line_count = 1L;
+		}
+
+		for (position = 0L; (jam_line_table != NULL) &&
+			(position < jam_program_size); ++position)
+		{
+			if (jam_program[position] == JAMC_NEWLINE_CHAR)
+			{
+				if (jam_line_count == capacity)
+				{
+					new_table = (long *) jam_malloc(
+						(unsigned int) (2L * capacity * sizeof(long)));
+
+					if (new_table != NULL)
+					{
+						for (index = 0L; index < jam_line_count; ++index)
+						{
+							new_table[index] = jam_line_table[index];
+						}
+						capacity *= 2L;
+					}
+					else
+					{
+						jam_line_count = 0L;
+					}
+
+					jam_free(jam_line_table);
+					jam_line_table = new_table;
+				}
+
+				if (jam_line_table != NULL)
+				{
+					jam_line_table[jam_line_count] = position + 1L;
+					++jam_line_count;
+				}
+			}
+		}
+	}
+	else if ((jam_workspace == NULL) && (jam_seek(0L) == 0))
+	{
+		/*
+		*	Count the lines
+		*/
+		line = 1L;
+		while ((ch = jam_getc()) != EOF)
+		{
+			if (ch == JAMC_NEWLINE_CHAR) ++line;
+		}
+
+		jam_line_table = (long *) jam_malloc(
+			(unsigned int) (line * sizeof(long)));
+
+		/*
+		*	Record the position of the beginning of each line
+		*/
+		if ((jam_line_table != NULL) && (jam_seek(0L) == 0))
+		{
+			jam_line_table[0] = 0L;
+			jam_line_count = 1L;
+
+			while ((ch = jam_getc()) != EOF)
+			{
+				++position;
+
+				if ((ch == JAMC_NEWLINE_CHAR) && (jam_line_count < line))
+				{
+					jam_line_table[jam_line_count] = position;
+					++jam_line_count;
+				}
+			}
+		}
+
+		jam_seek(jam_current_file_position);
+	}
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_free_line_table(void)
+
+/*																			*/
+/*	Description:	Frees the table of line positions.						*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	if ((jam_line_table != NULL) && (jam_line_table != jam_preset_line_table))
+	{
+		jam_free(jam_line_table);
+		jam_line_table = NULL;
+	}
+
+	jam_line_count = 0L;
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_set_profiling
+(
+	int level
+)
+
+/*																			*/
+/*	Description:	Turns profiling on or off.  At JAMC_PROFILING_PHASES	*/
+/*					the time spent reading statements and decoding array	*/
+/*					data is marked with jam_profile_phase(), and at			*/
+/*					JAMC_PROFILING_STATEMENTS the start of each statement	*/
+/*					is also reported through jam_profile_statement().		*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	jam_profiling = (level != JAMC_PROFILING_OFF) ? TRUE : FALSE;
+	jam_profiling_statements =
+		(level == JAMC_PROFILING_STATEMENTS) ? TRUE : FALSE;
+}
+
+/****************************************************************************/
+/*																			*/
+
+long jam_get_statement_count
+(
+	void
+)
+
+/*																			*/
+/*	Description:	Tells how many statements have been executed since		*/
+/*					jam_execute() began										*/
+/*																			*/
+/*	Returns:		number of statements									*/
+/*																			*/
+/****************************************************************************/
+{
+	return (jam_statement_count);
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_set_line_table
+(
+	long *line_table,
+	long line_count
+)
+
+/*																			*/
+/*	Description:	Gives the position where each line of the program		*/
+/*					begins, so that jam_execute() need not read the whole	*/
+/*					program to find them.  The table belongs to the			*/
+/*					caller and must stay valid while the program runs.		*/
+/*					Passing NULL makes jam_execute() build its own table.	*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	if ((line_table != NULL) && (line_count > 0L) && (line_table[0] == 0L))
+	{
+		jam_preset_line_table = line_table;
+		jam_preset_line_count = line_count;
+	}
+	else
+	{
+		jam_preset_line_table = NULL;
+		jam_preset_line_count = 0L;
+	}
+}
+
+/****************************************************************************/
+/*																			*/
+
 long jam_get_line_of_position
 (
 	long position
@@ -8564,7 +9169,10 @@ long jam_get_line_of_position
 /*																			*/
 /*	Description:	Determines the line number in the input stream which	*/
 /*					corresponds to the given position (offset) in the		*/
-/*					stream.  This is used for error reporting.				*/
+/*					stream.  This is used for error reporting and tracing.	*/
+/*					If the table of line positions is available it is		*/
+/*					searched, otherwise the input stream is reread from		*/
+/*					the beginning and the file position is not restored.	*/
 /*																			*/
 /*	Returns:		line number, or zero if it could not be determined		*/
 /*																			*/
@@ -8572,9 +9180,35 @@ long jam_get_line_of_position
 {
 	long line = 0L;
 	long index = 0L;
+	long low = 0L;
+	long high = 0L;
 	int ch;
 
-	if (jam_seek(0L) == 0)
+	if (jam_line_count > 0L)
+	{
+		/*
+		*	Binary search for the last line beginning at or before position
+		*/
+		low = 0L;
+		high = jam_line_count - 1L;
+
+		while (low < high)
+		{
+			index = (low + high + 1L) / 2L;
+
+			if (jam_line_table[index] <= position)
+			{
+				low = index;
+			}
+			else
+			{
+				high = index - 1L;
+			}
+		}
+
+		line = low + 1L;	/* first line is line 1, not zero */
+	}
+	else if (jam_seek(0L) == 0)
 	{
 		++line;	/* first line is line 1, not zero */
 
@@ -8640,6 +9274,7 @@ JAM_RETURN_TYPE jam_execute
 	jam_version = 0;
 	jam_phase = JAM_UNKNOWN_PHASE;
 	jam_current_block = NULL;
+	jam_statement_count = 0L;
 
 	for (i = 0; i < JAMC_MAX_LITERAL_ARRAYS; ++i)
 	{
@@ -8656,6 +9291,8 @@ JAM_RETURN_TYPE jam_execute
 		jam_workspace = (char *) (((long)jam_workspace + 3L) & (~3L));
 	}
 
+	jam_init_arena();
+
 	/*
 	*	Initialize symbol table and stack
 	*/
@@ -8686,6 +9323,13 @@ JAM_RETURN_TYPE jam_execute
 		status = jam_init_statement_buffer(&statement_buffer, &statement_buffer_size);
 	}
 
+	if (status == JAMC_SUCCESS)
+	{
+		jam_init_optimizer(statement_buffer);
+		jam_init_statement_cache();
+		jam_init_line_table();
+	}
+
 	/*
 	*	Get program statements and execute them
 	*/
@@ -8735,6 +9379,9 @@ JAM_RETURN_TYPE jam_execute
 			jam_current_statement_position);
 	}
 
+	jam_free_line_table();
+	jam_free_statement_cache();
+	jam_free_optimizer();
 	jam_free_literal_aca_buffers();
 	jam_free_jtag_padding_buffers(reset_jtag);
 	jam_free_heap();
@@ -8743,6 +9390,8 @@ JAM_RETURN_TYPE jam_execute
 
 	jam_free_statement_buffer(&statement_buffer, &statement_buffer_size);
 
+	jam_free_arena();
+
 	if (format_version != NULL) *format_version = jam_version;
 
 	return (status);
@@ -25,6 +25,12 @@ extern long jam_next_statement_position;
 
 extern unsigned int jam_statement_buffer_size;
 
+extern JAME_INSTRUCTION jam_crc_barrier;
+
+extern BOOL jam_profiling;
+
+extern BOOL jam_skip_array_data;
+
 /****************************************************************************/
 /*																			*/
 /*	Function Prototypes														*/
@@ -43,12 +49,32 @@ void jam_free_statement_buffer
 	unsigned int *statement_buffer_size
 );
 
+void jam_init_statement_cache
+(
+	void
+);
+
+void jam_free_statement_cache
+(
+	void
+);
+
 JAM_RETURN_TYPE jam_get_statement
 (
 	char *statement_buffer,
 	char *label_buffer
 );
 
+void jam_init_line_table
+(
+	void
+);
+
+void jam_free_line_table
+(
+	void
+);
+
 long jam_get_line_of_position
 (
 	long position
@@ -59,9 +85,20 @@ JAME_INSTRUCTION jam_get_instruction
 	char *statement_buffer
 );
 
+char *jam_get_instruction_name
+(
+	JAME_INSTRUCTION instruction
+);
+
 int jam_skip_instruction_name
 (
 	char *statement_buffer
 );
 
+int jam_find_keyword
+(
+	char *buffer,
+	char *keyword
+);
+
 #endif /* INC_JAMEXEC_H */
@@ -9,6 +9,7 @@
 #include "jamheap.h"
 #include "jamarray.h"
 #include "jamutil.h"
+#include "jamopt.h"
 #include "jamytab.h"
 
 
@@ -354,6 +355,38 @@ long jam_convert_bool_to_int(long *data, long msb, long lsb)
 	return (result);
 }
 
+/*
+*	Same as jam_convert_bool_to_int(), for an array whose data is cached.
+*	Only the 32 elements starting at "lsb" are used.
+*/
+JAM_RETURN_TYPE jam_convert_cached_bool_to_int
+(
+	JAMS_HEAP_RECORD *heap_rec,
+	long msb,
+	long lsb,
+	long *result
+)
+{
+	long data[1];
+	long first = lsb;
+	long count = ((msb > lsb) ? (msb - lsb) : (lsb - msb)) + 1;
+	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+
+	if (count > 32) count = 32;
+	if (msb < lsb) first = lsb - count + 1;
+
+	status = jam_get_cached_array_data(heap_rec, first, first + count - 1,
+		data);
+
+	if (status == JAMC_SUCCESS)
+	{
+		*result = jam_convert_bool_to_int(data,
+			(msb > lsb) ? (count - 1) : 0, lsb - first);
+	}
+
+	return (status);
+}
+
 
 /************************************************************************/
 /*																   		*/
@@ -822,10 +855,24 @@ YYSTYPE jam_exp_eval(OPERATOR_TYPE otype, YYSTYPE op1, YYSTYPE op2)
 				{
 					heap_rec = (JAMS_HEAP_RECORD *) symbol_rec->value;
 
-					if (heap_rec != NULL)
+					if ((heap_rec != NULL) && heap_rec->pending)
+					{
+						jam_return_code = jam_decode_array_data(heap_rec);
+					}
+
+					if ((heap_rec != NULL) &&
+						(jam_return_code == JAMC_SUCCESS))
 					{
-						rtn.val = jam_convert_bool_to_int(heap_rec->data,
-							op1.val, op2.val);
+						if (heap_rec->cached)
+						{
+							jam_return_code = jam_convert_cached_bool_to_int(
+								heap_rec, op1.val, op2.val, &rtn.val);
+						}
+						else
+						{
+							rtn.val = jam_convert_bool_to_int(heap_rec->data,
+								op1.val, op2.val);
+						}
 					}
 					rtn.type = JAM_INTEGER_EXPR;
 				}
@@ -845,10 +892,24 @@ YYSTYPE jam_exp_eval(OPERATOR_TYPE otype, YYSTYPE op1, YYSTYPE op2)
 				{
 					heap_rec = (JAMS_HEAP_RECORD *) symbol_rec->value;
 
-					if (heap_rec != NULL)
+					if ((heap_rec != NULL) && heap_rec->pending)
+					{
+						jam_return_code = jam_decode_array_data(heap_rec);
+					}
+
+					if ((heap_rec != NULL) &&
+						(jam_return_code == JAMC_SUCCESS))
 					{
-						rtn.val = jam_convert_bool_to_int(heap_rec->data,
-							heap_rec->dimension - 1, 0);
+						if (heap_rec->cached)
+						{
+							jam_return_code = jam_convert_cached_bool_to_int(
+								heap_rec, heap_rec->dimension - 1, 0, &rtn.val);
+						}
+						else
+						{
+							rtn.val = jam_convert_bool_to_int(heap_rec->data,
+								heap_rec->dimension - 1, 0);
+						}
 					}
 					rtn.type = JAM_INTEGER_EXPR;
 				}
@@ -1319,12 +1380,33 @@ JAM_RETURN_TYPE jam_evaluate_expression
 /*		  return 0. 											   		*/
 /*																   		*/
 {
-	jam_strcpy(jam_parse_string, expression);
-	jam_strptr = 0;
-	jam_token_buffer_index = 0;
-	jam_return_code = JAMC_SUCCESS;
+	JAMS_FOLD_RECORD *fold_record = jam_get_fold_record(expression);
 
-	jam_yyparse();
+	if ((fold_record != NULL) && (fold_record->state == JAM_FOLD_CONSTANT))
+	{
+		/* expression is constant and was evaluated before */
+		jam_return_code = JAMC_SUCCESS;
+		jam_parse_value = fold_record->value;
+		jam_expr_type = fold_record->type;
+	}
+	else
+	{
+		jam_strcpy(jam_parse_string, expression);
+		jam_strptr = 0;
+		jam_token_buffer_index = 0;
+		jam_return_code = JAMC_SUCCESS;
+
+		jam_yyparse();
+
+		if ((fold_record != NULL) && (jam_return_code == JAMC_SUCCESS) &&
+			(jam_expr_type != JAM_ARRAY_REFERENCE))
+		{
+			/* remember the value of this constant expression */
+			fold_record->value = jam_parse_value;
+			fold_record->type = jam_expr_type;
+			fold_record->state = JAM_FOLD_CONSTANT;
+		}
+	}
 
 	if (jam_return_code == JAMC_SUCCESS)
 	{
@@ -48,6 +48,24 @@
 #define JAMC_SCOPE_ERROR       23
 #define JAMC_ACTION_NOT_FOUND  24
 
+/****************************************************************************/
+/*																			*/
+/*	Kinds of work told apart by the profiler								*/
+/*																			*/
+/****************************************************************************/
+
+#define JAMC_PROFILE_EXECUTE   0	/* executing statements */
+#define JAMC_PROFILE_READ      1	/* reading statements */
+#define JAMC_PROFILE_DECODE    2	/* decoding array data */
+#define JAMC_PROFILE_JTAG      3	/* JTAG I/O (host only) */
+#define JAMC_PROFILE_DELAY     4	/* delays (host only) */
+#define JAMC_PROFILE_COUNT     5
+
+/* levels for jam_set_profiling() */
+#define JAMC_PROFILING_OFF        0
+#define JAMC_PROFILING_PHASES     1	/* jam_profile_phase() only */
+#define JAMC_PROFILING_STATEMENTS 2	/* jam_profile_statement() as well */
+
 /****************************************************************************/
 /*																			*/
 /*	Function Prototypes														*/
@@ -68,6 +86,30 @@ JAM_RETURN_TYPE jam_execute
 	int *format_version
 );
 
+void jam_set_profiling
+(
+	int level
+);
+
+long jam_get_statement_count
+(
+	void
+);
+
+void jam_get_scan_counts
+(
+	long *ir_scan_count,
+	long *ir_bit_count,
+	long *dr_scan_count,
+	long *dr_bit_count
+);
+
+void jam_set_line_table
+(
+	long *line_table,
+	long line_count
+);
+
 JAM_RETURN_TYPE jam_get_note
 (
 	char *program,
@@ -78,6 +120,11 @@ JAM_RETURN_TYPE jam_get_note
 	int length
 );
 
+void jam_free_note_index
+(
+	void
+);
+
 JAM_RETURN_TYPE jam_check_crc
 (
 	char *program,
@@ -86,6 +133,19 @@ JAM_RETURN_TYPE jam_check_crc
 	unsigned short *actual_crc
 );
 
+JAM_RETURN_TYPE jam_start_crc_check
+(
+	char *program,
+	long program_size,
+	char *barrier_statement
+);
+
+JAM_RETURN_TYPE jam_finish_crc_check
+(
+	unsigned short *expected_crc,
+	unsigned short *actual_crc
+);
+
 int jam_getc
 (
 	void
@@ -96,6 +156,50 @@ int jam_seek
 	long offset
 );
 
+int jam_read_array_cache
+(
+	long position,
+	long dimension,
+	long *data,
+	long word_count
+);
+
+void jam_write_array_cache
+(
+	long position,
+	long dimension,
+	long *data,
+	long word_count
+);
+
+void *jam_start_work
+(
+	int (*function)(void *),
+	void *argument
+);
+
+int jam_finish_work
+(
+	void *work
+);
+
+int jam_cancel_work
+(
+	void *work
+);
+
+int jam_profile_phase
+(
+	int phase
+);
+
+void jam_profile_statement
+(
+	long line,
+	char *instruction,
+	char *block
+);
+
 int jam_jtag_io
 (
 	int tms,
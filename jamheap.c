@@ -19,6 +19,7 @@
 #include "jamheap.h"
 #include "jamjtag.h"
 #include "jamutil.h"
+#include "jamarena.h"
 
 /****************************************************************************/
 /*																			*/
@@ -32,6 +33,9 @@ void *jam_heap_top = NULL;
 
 long jam_heap_records = 0L;
 
+/* bytes above jam_heap_top used for temporary arrays */
+long jam_heap_temp_size = 0L;
+
 /****************************************************************************/
 /*																			*/
 
@@ -52,6 +56,7 @@ JAM_RETURN_TYPE jam_init_heap(void)
 	long *jtag_buffer = NULL;
 
 	jam_heap_records = 0L;
+	jam_heap_temp_size = 0L;
 
 	if (jam_workspace != NULL)
 	{
@@ -86,7 +91,25 @@ void jam_free_heap(void)
 	JAMS_HEAP_RECORD *heap_ptr = NULL;
 	JAMS_HEAP_RECORD *tmp_heap_ptr = NULL;
 
-	if ((jam_heap != NULL) && (jam_workspace == NULL))
+	/* background decoding must not write to the heap after it is freed -- */
+	/* jobs not yet started are dropped, and only a running one is waited for */
+	heap_ptr = jam_heap;
+	for (record = 0; record < jam_heap_records; ++record)
+	{
+		if (heap_ptr != NULL)
+		{
+			if (heap_ptr->work != NULL)
+			{
+				jam_cancel_work(heap_ptr->work);
+				heap_ptr->work = NULL;
+			}
+			heap_ptr = heap_ptr->next;
+		}
+	}
+
+	/* with the arena, the records are released by jam_free_arena() */
+	if ((jam_heap != NULL) && (jam_workspace == NULL) &&
+		(!jam_arena_active()))
 	{
 		heap_ptr = jam_heap;
 		for (record = 0; record < jam_heap_records; ++record)
@@ -142,22 +165,25 @@ JAM_RETURN_TYPE jam_add_heap_record
 		break;
 
 	case JAM_INTEGER_ARRAY_INITIALIZED:
+		/* integer data may contain expressions, so it is never cached */
 		space_needed = dimension * sizeof(long);
-/*		if (space_needed > JAMC_ARRAY_CACHE_SIZE)	*/
-/*		{											*/
-/*			space_needed = JAMC_ARRAY_CACHE_SIZE;	*/
-/*			cached = TRUE;							*/
-/*		}											*/
 		break;
 
 	case JAM_BOOLEAN_ARRAY_INITIALIZED:
 		space_needed = ((dimension >> 5) + ((dimension & 0x1f) ? 1 : 0)) *
 			sizeof(long);
-/*		if (space_needed > JAMC_ARRAY_CACHE_SIZE)	*/
-/*		{											*/
-/*			space_needed = JAMC_ARRAY_CACHE_SIZE;	*/
-/*			cached = TRUE;							*/
-/*		}											*/
+
+		/*
+		*	In a fixed-size workspace, large arrays get a cache buffer.
+		*	jam_read_boolean_array_data() may resize it once the data
+		*	representation is known.
+		*/
+		if ((jam_workspace != NULL) &&
+			(space_needed > JAMC_ARRAY_CACHE_SIZE))
+		{
+			space_needed = JAMC_ARRAY_CACHE_SIZE;
+			cached = TRUE;
+		}
 		break;
 
 	case JAM_PROCEDURE_BLOCK:
@@ -191,12 +217,12 @@ JAM_RETURN_TYPE jam_add_heap_record
 #if PORT==DOS
 			if ((sizeof(JAMS_HEAP_RECORD) + space_needed) < 0x10000L)
 			{
-				heap_ptr = (JAMS_HEAP_RECORD *) jam_malloc((unsigned int)
+				heap_ptr = (JAMS_HEAP_RECORD *) jam_arena_malloc((unsigned int)
 					(sizeof(JAMS_HEAP_RECORD) + space_needed));
 			}
 			/* else error: cannot allocate a buffer greater than 64K */
 #else
-			heap_ptr = (JAMS_HEAP_RECORD *) jam_malloc((unsigned int)
+			heap_ptr = (JAMS_HEAP_RECORD *) jam_arena_malloc((unsigned int)
 				(sizeof(JAMS_HEAP_RECORD) + space_needed));
 #endif
 
@@ -219,6 +245,8 @@ JAM_RETURN_TYPE jam_add_heap_record
 		heap_ptr->symbol_record = symbol_record;
 		heap_ptr->dimension = dimension;
 		heap_ptr->cached = cached;
+		heap_ptr->pending = FALSE;
+		heap_ptr->work = NULL;
 		heap_ptr->position = 0L;
 
 		if (jam_workspace != NULL)
@@ -251,6 +279,116 @@ JAM_RETURN_TYPE jam_add_heap_record
 /****************************************************************************/
 /*																			*/
 
+JAM_RETURN_TYPE jam_resize_heap_record
+(
+	JAMS_HEAP_RECORD *heap_record,
+	long space_needed,
+	BOOL cached
+)
+
+/*																			*/
+/*	Description:	Changes the size of the data area of the last record	*/
+/*					added to the heap in workspace mode.  The data area is	*/
+/*					cleared to zero.										*/
+/*																			*/
+/*	Returns:		JAMC_SUCCESS for success, or JAMC_OUT_OF_MEMORY if not	*/
+/*					enough memory was available.							*/
+/*																			*/
+/****************************************************************************/
+{
+	int count = 0;
+	int element = 0;
+	void *new_heap_top = NULL;
+	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+
+	if ((jam_workspace == NULL) ||
+		((void *) heap_record->next != jam_heap_top))
+	{
+		/* only the top record of the workspace heap can be resized */
+		status = JAMC_INTERNAL_ERROR;
+	}
+	else
+	{
+		new_heap_top = (void *) ((long)heap_record +
+			(long)sizeof(JAMS_HEAP_RECORD) + space_needed);
+
+		if ((long)new_heap_top > (long)jam_symbol_bottom)
+		{
+			status = JAMC_OUT_OF_MEMORY;
+		}
+	}
+
+	if (status == JAMC_SUCCESS)
+	{
+		jam_heap_top = new_heap_top;
+		heap_record->next = (JAMS_HEAP_RECORD *) jam_heap_top;
+		heap_record->cached = cached;
+
+		/* initialize data area to zero */
+		count = (int) (space_needed / sizeof(long));
+		for (element = 0; element < count; ++element)
+		{
+			heap_record->data[element] = 0L;
+		}
+	}
+
+	return (status);
+}
+
+/****************************************************************************/
+/*																			*/
+
+long *jam_get_temp_array
+(
+	long size
+)
+
+/*																			*/
+/*	Description:	Allocates a buffer above the last heap record which		*/
+/*					stays valid until jam_free_temp_arrays() is called at	*/
+/*					the end of the statement.  Used in workspace mode to	*/
+/*					hold data decoded from cached arrays.					*/
+/*																			*/
+/*	Returns:		pointer to memory, or NULL if memory not available		*/
+/*																			*/
+/****************************************************************************/
+{
+	long *temp_array = NULL;
+
+	/* keep each buffer aligned on a long word */
+	size = ((size + sizeof(long) - 1) / sizeof(long)) * sizeof(long);
+
+	if ((jam_workspace != NULL) && (((long)jam_heap_top) +
+		jam_heap_temp_size + size <= (long)jam_symbol_bottom))
+	{
+		temp_array = (long *) ((long)jam_heap_top + jam_heap_temp_size);
+		jam_heap_temp_size += size;
+	}
+
+	return (temp_array);
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_free_temp_arrays
+(
+	void
+)
+
+/*																			*/
+/*	Description:	Frees all buffers allocated by jam_get_temp_array()		*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	jam_heap_temp_size = 0L;
+}
+
+/****************************************************************************/
+/*																			*/
+
 void *jam_get_temp_workspace
 (
 	long size
@@ -269,14 +407,15 @@ void *jam_get_temp_workspace
 
 	if (jam_workspace != NULL)
 	{
-		if (((long)jam_heap_top) + size <= (long)jam_symbol_bottom)
+		if (((long)jam_heap_top) + jam_heap_temp_size + size <=
+			(long)jam_symbol_bottom)
 		{
-			temp_workspace = jam_heap_top;
+			temp_workspace = (void *) ((long)jam_heap_top + jam_heap_temp_size);
 		}
 	}
 	else
 	{
-		temp_workspace = jam_malloc((unsigned int) size);
+		temp_workspace = jam_arena_malloc((unsigned int) size);
 	}
 
 	return (temp_workspace);
@@ -299,6 +438,6 @@ void jam_free_temp_workspace
 {
 	if ((ptr != NULL) && (jam_workspace == NULL))
 	{
-		jam_free(ptr);
+		jam_arena_free(ptr);
 	}
 }
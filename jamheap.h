@@ -49,6 +49,8 @@ typedef struct JAMS_HEAP_STRUCT
 	JAMS_SYMBOL_RECORD *symbol_record;
 	JAME_BOOLEAN_REP rep;	/* data representation format */
 	BOOL cached;		/* TRUE if array data is cached */
+	BOOL pending;		/* TRUE if data has not been decoded yet */
+	void *work;			/* background decoding of data, if started */
 	long dimension;		/* number of elements in array */
 	long position;		/* position in file of initialization data */
 	long data[1];		/* first word of data (or cache buffer) */
@@ -88,6 +90,23 @@ JAM_RETURN_TYPE jam_add_heap_record
 	long dimension
 );
 
+JAM_RETURN_TYPE jam_resize_heap_record
+(
+	JAMS_HEAP_RECORD *heap_record,
+	long space_needed,
+	BOOL cached
+);
+
+long *jam_get_temp_array
+(
+	long size
+);
+
+void jam_free_temp_arrays
+(
+	void
+);
+
 void *jam_get_temp_workspace
 (
 	long size
@@ -50,6 +50,14 @@ long *jam_ir_postamble_data = NULL;
 char *jam_dr_buffer         = NULL;
 char *jam_ir_buffer         = NULL;
 
+/*
+*	Number of scans, and bits shifted by them, during this run
+*/
+long jam_ir_scan_count = 0L;
+long jam_ir_bit_count  = 0L;
+long jam_dr_scan_count = 0L;
+long jam_dr_bit_count  = 0L;
+
 /*
 *	Table of JTAG state names
 */
@@ -157,6 +165,10 @@ JAM_RETURN_TYPE jam_init_jtag(void)
 	jam_ir_postamble = 0;
 	jam_dr_length    = 0;
 	jam_ir_length    = 0;
+	jam_ir_scan_count = 0L;
+	jam_ir_bit_count  = 0L;
+	jam_dr_scan_count = 0L;
+	jam_dr_bit_count  = 0L;
 
 	if (jam_workspace != NULL)
 	{
@@ -923,6 +935,9 @@ int jam_jtag_drscan
 
 	if (status)
 	{
+		++jam_dr_scan_count;
+		jam_dr_bit_count += count;
+
 		/* loop in the SHIFT-DR state */
 		for (i = 0; i < count; i++)
 		{
@@ -1000,6 +1015,9 @@ int jam_jtag_irscan
 
 	if (status)
 	{
+		++jam_ir_scan_count;
+		jam_ir_bit_count += count;
+
 		/* loop in the SHIFT-IR state */
 		for (i = 0; i < count; i++)
 		{
@@ -1030,6 +1048,33 @@ int jam_jtag_irscan
 /****************************************************************************/
 /*																			*/
 
+void jam_get_scan_counts
+(
+	long *ir_scan_count,
+	long *ir_bit_count,
+	long *dr_scan_count,
+	long *dr_bit_count
+)
+
+/*																			*/
+/*	Description:	Tells how many IR and DR scans have been done since		*/
+/*					jam_execute() began, and how many bits they shifted		*/
+/*					through the chain, including preamble and postamble		*/
+/*					bits													*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	*ir_scan_count = jam_ir_scan_count;
+	*ir_bit_count  = jam_ir_bit_count;
+	*dr_scan_count = jam_dr_scan_count;
+	*dr_bit_count  = jam_dr_bit_count;
+}
+
+/****************************************************************************/
+/*																			*/
+
 JAM_RETURN_TYPE jam_do_irscan
 (
 	long count,
@@ -13,6 +13,55 @@
 #include "jamexec.h"
 #include "jamutil.h"
 
+/****************************************************************************/
+/*																			*/
+/*	Type definitions														*/
+/*																			*/
+/****************************************************************************/
+
+/*
+*	The NOTE fields of the last program searched are kept in an index, so
+*	that jam_get_note() need not parse the program again on each call.
+*	The index is built by reading the header of the program -- the NOTE
+*	and ACTION statements at its start -- and is found again by program
+*	address and size.  A hash table of the keys gives the first NOTE with
+*	a given key.
+*/
+#define JAMC_NOTE_HASH_EMPTY (-1)
+
+/* size of the statement buffer used to read the header */
+#define JAMC_NOTE_BUFFER_SIZE 4096
+
+typedef struct JAMS_NOTE_STRUCT
+{
+	char *key;
+	char *value;
+	long position;		/* position of the NOTE statement */
+	long next_position;	/* position of the statement after it */
+
+} JAMS_NOTE_RECORD;
+
+/****************************************************************************/
+/*																			*/
+/*	Global variables														*/
+/*																			*/
+/****************************************************************************/
+
+/* program for which the index was built */
+char *jam_note_program = NULL;
+long jam_note_program_size = 0L;
+
+JAMS_NOTE_RECORD *jam_note_table = NULL;
+int jam_note_count = 0;
+int jam_note_table_size = 0;
+
+/* hash table of indexes into jam_note_table */
+int *jam_note_hash_table = NULL;
+int jam_note_hash_size = 0;
+
+/* status returned once all NOTEs in the index have been read */
+JAM_RETURN_TYPE jam_note_end_status = JAMC_UNEXPECTED_END;
+
 /****************************************************************************/
 /*																			*/
 
@@ -197,31 +246,160 @@ BOOL jam_get_note_value
 /****************************************************************************/
 /*																			*/
 
-JAM_RETURN_TYPE jam_get_note
+void jam_free_note_index(void)
+
+/*																			*/
+/*	Description:	Frees the index of NOTE fields.  This should be called	*/
+/*					when the program is no longer in memory, so that the	*/
+/*					index is not used for another program loaded at the		*/
+/*					same address.											*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	int index = 0;
+
+	for (index = 0; index < jam_note_count; ++index)
+	{
+		jam_free(jam_note_table[index].key);
+	}
+
+	if (jam_note_table != NULL) jam_free(jam_note_table);
+	if (jam_note_hash_table != NULL) jam_free(jam_note_hash_table);
+
+	jam_note_program = NULL;
+	jam_note_program_size = 0L;
+	jam_note_table = NULL;
+	jam_note_count = 0;
+	jam_note_table_size = 0;
+	jam_note_hash_table = NULL;
+	jam_note_hash_size = 0;
+	jam_note_end_status = JAMC_UNEXPECTED_END;
+}
+
+/****************************************************************************/
+/*																			*/
+
+int jam_hash_note_key
+(
+	char *key
+)
+
+/*																			*/
+/*	Description:	Computes the hash table slot for a key.  Case is		*/
+/*					ignored, as it is when keys are compared.				*/
+/*																			*/
+/*	Returns:		slot number												*/
+/*																			*/
+/****************************************************************************/
+{
+	unsigned long hash = 0L;
+
+	while (*key != JAMC_NULL_CHAR)
+	{
+		hash = (hash * 31L) + (unsigned long) jam_toupper(*key);
+		++key;
+	}
+
+	return ((int) (hash & (unsigned long) (jam_note_hash_size - 1)));
+}
+
+/****************************************************************************/
+/*																			*/
+
+JAM_RETURN_TYPE jam_add_note
 (
-	char *program,
-	long program_size,
-	long *offset,
 	char *key,
 	char *value,
-	int length
+	long position,
+	long next_position
 )
 
 /*																			*/
-/*	Description:	Gets key and value of NOTE fields in the JAM file.		*/
-/*					Can be called in two modes:  if offset pointer is NULL,	*/
-/*					then the function searches for note fields which match 	*/
-/*					the key string provided.  If offset is not NULL, then	*/
-/*					the function finds the next note field of any key,		*/
-/*					starting at the offset specified by the offset pointer.	*/
+/*	Description:	Adds a NOTE field to the end of the index				*/
 /*																			*/
-/*	Returns:		JAMC_SUCCESS for success, else appropriate error code	*/
+/*	Returns:		JAMC_SUCCESS for success, or JAMC_OUT_OF_MEMORY			*/
 /*																			*/
 /****************************************************************************/
 {
 	JAM_RETURN_TYPE status = JAMC_SUCCESS;
-	char *statement_buffer = NULL;
-	unsigned int statement_buffer_size = 0;
+	JAMS_NOTE_RECORD *table = NULL;
+	char *text = NULL;
+	int key_length = jam_strlen(key);
+	int index = 0;
+
+	/* grow the table by doubling it */
+	if (jam_note_count == jam_note_table_size)
+	{
+		table = (JAMS_NOTE_RECORD *) jam_malloc((unsigned int)
+			((jam_note_table_size + 8) * 2 * sizeof(JAMS_NOTE_RECORD)));
+
+		if (table == NULL)
+		{
+			status = JAMC_OUT_OF_MEMORY;
+		}
+		else
+		{
+			for (index = 0; index < jam_note_count; ++index)
+			{
+				table[index] = jam_note_table[index];
+			}
+
+			if (jam_note_table != NULL) jam_free(jam_note_table);
+			jam_note_table = table;
+			jam_note_table_size = (jam_note_table_size + 8) * 2;
+		}
+	}
+
+	/* the key and value are kept together in one block */
+	if (status == JAMC_SUCCESS)
+	{
+		text = (char *) jam_malloc((unsigned int)
+			(key_length + jam_strlen(value) + 2));
+
+		if (text == NULL)
+		{
+			status = JAMC_OUT_OF_MEMORY;
+		}
+		else
+		{
+			jam_strcpy(text, key);
+			jam_strcpy(&text[key_length + 1], value);
+
+			jam_note_table[jam_note_count].key = text;
+			jam_note_table[jam_note_count].value = &text[key_length + 1];
+			jam_note_table[jam_note_count].position = position;
+			jam_note_table[jam_note_count].next_position = next_position;
+			++jam_note_count;
+		}
+	}
+
+	return (status);
+}
+
+/****************************************************************************/
+/*																			*/
+
+JAM_RETURN_TYPE jam_read_note_header
+(
+	char *statement_buffer
+)
+
+/*																			*/
+/*	Description:	Reads the NOTE fields in the header of the program		*/
+/*					into the index.  Reading stops at the first statement	*/
+/*					which is not a NOTE or ACTION statement, at the end of	*/
+/*					the program, or at a NOTE which can't be parsed; the	*/
+/*					reason is kept in jam_note_end_status, to be returned	*/
+/*					by jam_get_note() once the NOTEs before it are read.	*/
+/*																			*/
+/*	Returns:		JAMC_SUCCESS for success, or JAMC_OUT_OF_MEMORY			*/
+/*																			*/
+/****************************************************************************/
+{
+	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+	JAM_RETURN_TYPE read_status = JAMC_SUCCESS;
 	char label_buffer[JAMC_MAX_NAME_LENGTH + 1];
 	JAME_INSTRUCTION instruction = JAM_ILLEGAL_INSTR;
 	long key_begin = 0L;
@@ -229,109 +407,303 @@ JAM_RETURN_TYPE jam_get_note
 	long value_begin = 0L;
 	long value_end = 0L;
 	BOOL done = FALSE;
+
+	jam_current_statement_position = 0L;
+	jam_next_statement_position = 0L;
+	jam_current_file_position = 0L;
+	read_status = jam_seek(0L);
+
+	while ((!done) && (status == JAMC_SUCCESS) &&
+		(read_status == JAMC_SUCCESS))
+	{
+		read_status = jam_get_statement(statement_buffer, label_buffer);
+
+		if (read_status == JAMC_SUCCESS)
+		{
+			instruction = jam_get_instruction(statement_buffer);
+
+			if (instruction == JAM_NOTE_INSTR)
+			{
+				if (jam_get_note_key(statement_buffer, &key_begin, &key_end) &&
+					jam_get_note_value(&statement_buffer[key_end + 1],
+						&value_begin, &value_end))
+				{
+					value_begin += (key_end + 1);
+					value_end += (key_end + 1);
+					statement_buffer[key_end] = JAMC_NULL_CHAR;
+					statement_buffer[value_end] = JAMC_NULL_CHAR;
+
+					status = jam_add_note(&statement_buffer[key_begin],
+						&statement_buffer[value_begin],
+						jam_current_statement_position,
+						jam_current_file_position);
+				}
+				else
+				{
+					read_status = JAMC_SYNTAX_ERROR;
+				}
+			}
+			else if (instruction != JAM_ACTION_INSTR)
+			{
+				/* end of the header */
+				done = TRUE;
+			}
+		}
+	}
+
+	jam_note_end_status = done ? JAMC_UNEXPECTED_END : read_status;
+
+	return (status);
+}
+
+/****************************************************************************/
+/*																			*/
+
+JAM_RETURN_TYPE jam_build_note_index
+(
+	char *program,
+	long program_size
+)
+
+/*																			*/
+/*	Description:	Builds the index of NOTE fields for a program, and the	*/
+/*					hash table of their keys.  NOTE statements are short,	*/
+/*					so unless the statement buffer size is known already	*/
+/*					the header is first read with a small buffer, which		*/
+/*					saves reading the whole program to find its longest		*/
+/*					statement.  If a NOTE does not fit in it, the header	*/
+/*					is read again with a full-size buffer.					*/
+/*																			*/
+/*	Returns:		JAMC_SUCCESS for success, or JAMC_OUT_OF_MEMORY			*/
+/*																			*/
+/****************************************************************************/
+{
+	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+	char *statement_buffer = NULL;
+	unsigned int statement_buffer_size = 0;
+	int index = 0;
+	int slot = 0;
+	BOOL full_size = (jam_statement_buffer_size != 0);
 	char *tmp_program = jam_program;
 	long tmp_program_size = jam_program_size;
 	long tmp_current_file_position = jam_current_file_position;
 	long tmp_current_statement_position = jam_current_statement_position;
 	long tmp_next_statement_position = jam_next_statement_position;
 
+	jam_free_note_index();
+
 	jam_program = program;
 	jam_program_size = program_size;
 
-	jam_current_statement_position = 0L;
-	jam_next_statement_position = 0L;
+	if (!full_size)
+	{
+		statement_buffer = (char *) jam_malloc(JAMC_NOTE_BUFFER_SIZE + 1);
 
-	status = jam_init_statement_buffer(&statement_buffer, &statement_buffer_size);
+		if (statement_buffer == NULL)
+		{
+			status = JAMC_OUT_OF_MEMORY;
+		}
+		else
+		{
+			jam_statement_buffer_size = JAMC_NOTE_BUFFER_SIZE;
+			status = jam_read_note_header(statement_buffer);
+			jam_statement_buffer_size = 0;
+			jam_free(statement_buffer);
+			statement_buffer = NULL;
+
+			if ((status == JAMC_SUCCESS) &&
+				(jam_note_end_status == JAMC_SYNTAX_ERROR))
+			{
+				jam_free_note_index();
+				full_size = TRUE;
+			}
+		}
+	}
 
-	if (status == JAMC_SUCCESS)
+	if ((status == JAMC_SUCCESS) && full_size)
 	{
-		if (offset == NULL)
+		status = jam_init_statement_buffer(
+			&statement_buffer, &statement_buffer_size);
+
+		if (status == JAMC_SUCCESS)
 		{
-			/*
-			*	We will search for the first note with a specific key, and
-			*	return only the value
-			*/
-			status = jam_seek(0L);
-			jam_current_file_position = 0L;
+			status = jam_read_note_header(statement_buffer);
 		}
 		else
 		{
-			/*
-			*	We will search for the next note, regardless of the key, and
-			*	return both the value and the key
-			*/
-			status = jam_seek(*offset);
-			jam_current_file_position = *offset;
+			/* the program can't be read, so it has no NOTEs */
+			jam_note_end_status = status;
+			status = JAMC_SUCCESS;
 		}
+
+		jam_free_statement_buffer(&statement_buffer, &statement_buffer_size);
 	}
 
 	/*
-	*	Get program statements and look for NOTE statements
+	*	Build the hash table, at most half full
 	*/
-	while ((!done) && (status == JAMC_SUCCESS))
+	if (status == JAMC_SUCCESS)
 	{
-		status = jam_get_statement(statement_buffer, label_buffer);
+		jam_note_hash_size = 16;
 
-		if (status == JAMC_SUCCESS)
+		while (jam_note_hash_size < (jam_note_count * 2))
 		{
-			instruction = jam_get_instruction(statement_buffer);
+			jam_note_hash_size *= 2;
+		}
 
-			if (instruction == JAM_NOTE_INSTR)
+		jam_note_hash_table = (int *) jam_malloc(
+			(unsigned int) (jam_note_hash_size * sizeof(int)));
+
+		if (jam_note_hash_table == NULL)
+		{
+			status = JAMC_OUT_OF_MEMORY;
+		}
+	}
+
+	if (status == JAMC_SUCCESS)
+	{
+		for (slot = 0; slot < jam_note_hash_size; ++slot)
+		{
+			jam_note_hash_table[slot] = JAMC_NOTE_HASH_EMPTY;
+		}
+
+		/* NOTEs go in in order, so the first with each key is found first */
+		for (index = 0; index < jam_note_count; ++index)
+		{
+			slot = jam_hash_note_key(jam_note_table[index].key);
+
+			while (jam_note_hash_table[slot] != JAMC_NOTE_HASH_EMPTY)
 			{
-				if (jam_get_note_key(statement_buffer, &key_begin, &key_end))
-				{
-					statement_buffer[key_end] = JAMC_NULL_CHAR;
+				slot = (slot + 1) & (jam_note_hash_size - 1);
+			}
 
-					if ((offset != NULL) || (jam_stricmp(
-						key, &statement_buffer[key_begin]) == 0))
-					{
-						if (jam_get_note_value(&statement_buffer[key_end + 1],
-							&value_begin, &value_end))
-						{
-							done = TRUE;
-							value_begin += (key_end + 1);
-							value_end += (key_end + 1);
-							statement_buffer[value_end] = JAMC_NULL_CHAR;
-
-							if (offset != NULL)
-							{
-								*offset = jam_current_file_position;
-							}
-						}
-						else
-						{
-							status = JAMC_SYNTAX_ERROR;
-						}
-					}
-				}
-				else
-				{
-					status = JAMC_SYNTAX_ERROR;
-				}
+			jam_note_hash_table[slot] = index;
+		}
+
+		jam_note_program = program;
+		jam_note_program_size = program_size;
+	}
+	else
+	{
+		jam_free_note_index();
+	}
+
+	jam_program = tmp_program;
+	jam_program_size = tmp_program_size;
+	jam_current_file_position = tmp_current_file_position;
+	jam_current_statement_position = tmp_current_statement_position;
+	jam_next_statement_position = tmp_next_statement_position;
+
+	return (status);
+}
+
+/****************************************************************************/
+/*																			*/
+
+JAM_RETURN_TYPE jam_get_note
+(
+	char *program,
+	long program_size,
+	long *offset,
+	char *key,
+	char *value,
+	int length
+)
+
+/*																			*/
+/*	Description:	Gets key and value of NOTE fields in the JAM file.		*/
+/*					Can be called in two modes:  if offset pointer is NULL,	*/
+/*					then the function searches for note fields which match 	*/
+/*					the key string provided.  If offset is not NULL, then	*/
+/*					the function finds the next note field of any key,		*/
+/*					starting at the offset specified by the offset pointer.	*/
+/*					Both use the index of NOTE fields, which is built on	*/
+/*					the first call for a program.							*/
+/*																			*/
+/*	Returns:		JAMC_SUCCESS for success, else appropriate error code	*/
+/*																			*/
+/****************************************************************************/
+{
+	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+	JAMS_NOTE_RECORD *note = NULL;
+	int index = 0;
+	int slot = 0;
+	int low = 0;
+	int high = 0;
+
+	if ((program != jam_note_program) ||
+		(program_size != jam_note_program_size))
+	{
+		status = jam_build_note_index(program, program_size);
+	}
+
+	if ((status == JAMC_SUCCESS) && (offset == NULL))
+	{
+		/*
+		*	Look up the first note with a specific key
+		*/
+		slot = jam_hash_note_key(key);
+
+		while ((note == NULL) &&
+			(jam_note_hash_table[slot] != JAMC_NOTE_HASH_EMPTY))
+		{
+			index = jam_note_hash_table[slot];
+
+			if (jam_stricmp(key, jam_note_table[index].key) == 0)
+			{
+				note = &jam_note_table[index];
 			}
+
+			slot = (slot + 1) & (jam_note_hash_size - 1);
+		}
+	}
+	else if (status == JAMC_SUCCESS)
+	{
+		/*
+		*	Binary search for the first note at or after the offset
+		*/
+		low = 0;
+		high = jam_note_count;
+
+		while (low < high)
+		{
+			index = (low + high) / 2;
+
+			if (jam_note_table[index].position < *offset)
+			{
+				low = index + 1;
+			}
+			else
+			{
+				high = index;
+			}
+		}
+
+		index = low;
+
+		if (index < jam_note_count)
+		{
+			note = &jam_note_table[index];
+			*offset = note->next_position;
 		}
 	}
 
 	/*
 	*	Copy the key and value strings into buffers provided
 	*/
-	if (done && (status == JAMC_SUCCESS))
+	if (note != NULL)
 	{
 		if (offset != NULL)
 		{
 			/* only copy the key string if we were looking for all NOTEs */
-			jam_strncpy(
-				key, &statement_buffer[key_begin], JAMC_MAX_NAME_LENGTH);
+			jam_strncpy(key, note->key, JAMC_MAX_NAME_LENGTH);
 		}
-		jam_strncpy(value, &statement_buffer[value_begin], length);
+		jam_strncpy(value, note->value, length);
+	}
+	else if (status == JAMC_SUCCESS)
+	{
+		status = jam_note_end_status;
 	}
-
-	jam_program = tmp_program;
-	jam_program_size = tmp_program_size;
-	jam_current_file_position = tmp_current_file_position;
-	jam_current_statement_position = tmp_current_statement_position;
-	jam_next_statement_position = tmp_next_statement_position;
-	jam_free_statement_buffer(&statement_buffer, &statement_buffer_size);
 
 	return (status);
 }
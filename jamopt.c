@@ -0,0 +1,1033 @@
+/****************************************************************************/
+/*																			*/
+/*	Module:			jamopt.c												*/
+/*																			*/
+/*	Description:	Load-time program optimizer.  Before execution begins	*/
+/*					the whole program is scanned once to find the			*/
+/*					procedures which can be reached from the selected		*/
+/*					action, and the variables which are never modified by	*/
+/*					any reachable statement after they are declared.  Such	*/
+/*					variables hold the same value for the whole run, so		*/
+/*					any expression which uses only these variables (and		*/
+/*					literals) is evaluated once and the result is reused.	*/
+/*					This folds constant expressions such as array bounds	*/
+/*					and turns IF statements whose condition is fixed by		*/
+/*					the -d initialization list into dead branches which		*/
+/*					cost no expression evaluation.							*/
+/*																			*/
+/*					Symbol names are tracked by their symbol table hash		*/
+/*					value.  Two names with the same hash value are			*/
+/*					treated alike, which can only prevent folding, never	*/
+/*					produce a wrong result.									*/
+/*																			*/
+/****************************************************************************/
+
+#include "jamexprt.h"
+#include "jamdefs.h"
+#include "jamexec.h"
+#include "jamsym.h"
+#include "jamheap.h"
+#include "jamutil.h"
+#include "jamopt.h"
+
+/****************************************************************************/
+/*																			*/
+/*	Constant definitions													*/
+/*																			*/
+/****************************************************************************/
+
+/* capacity of the tables used while scanning the program */
+#define JAMC_MAX_OPT_BLOCKS 512
+#define JAMC_MAX_OPT_EDGES 2048
+#define JAMC_MAX_OPT_DEPENDENCIES 2048
+
+/* minimum number of records in the folded expression table -- the */
+/* table is made larger for long programs (two records per statement) */
+#define JAMC_MIN_FOLD_TABLE_SIZE 509
+
+/* with a fixed-size workspace, the fold table may use this fraction */
+/* (1/n) of the free space, so that most of it is left for the program */
+#define JAMC_FOLD_WORKSPACE_SHARE 4L
+
+/* maximum number of records examined when searching the fold table */
+#define JAMC_MAX_FOLD_PROBES 16
+
+/* returned by jam_opt_next_name() when no more names are present */
+#define JAMC_OPT_END_OF_STATEMENT (-2)
+
+/****************************************************************************/
+/*																			*/
+/*	Type definitions														*/
+/*																			*/
+/****************************************************************************/
+
+/*
+*	Information collected while scanning the program.  A block is a
+*	PROCEDURE or DATA block, numbered in order of appearance.  An edge
+*	records that a block calls (or uses) the block with the given name;
+*	edges from block -1 come from the selected ACTION statement.  A
+*	dependency records that the initial value of a variable is computed
+*	from another variable.
+*/
+typedef struct JAMS_OPT_SCAN_STRUCT
+{
+	int block_count;
+	int edge_count;
+	int dependency_count;
+	BOOL action_found;
+	BOOL all_reachable;
+	int block_hash[JAMC_MAX_OPT_BLOCKS];
+	BOOL block_reachable[JAMC_MAX_OPT_BLOCKS];
+	int edge_from[JAMC_MAX_OPT_EDGES];
+	int edge_to[JAMC_MAX_OPT_EDGES];
+	int dependency_name[JAMC_MAX_OPT_DEPENDENCIES];
+	int dependency_on[JAMC_MAX_OPT_DEPENDENCIES];
+
+} JAMS_OPT_SCAN;
+
+/****************************************************************************/
+/*																			*/
+/*	Global variables														*/
+/*																			*/
+/****************************************************************************/
+
+/* one bit per symbol hash value -- set if a variable with that hash */
+/* value may be modified after it is declared */
+unsigned char jam_mutable_names[(JAMC_MAX_SYMBOL_COUNT + 7) / 8];
+
+/* table of folded expressions, or NULL if folding is disabled */
+JAMS_FOLD_RECORD *jam_fold_table = NULL;
+
+/* number of records in the folded expression table */
+long jam_fold_table_size = 0L;
+
+/* name of desired action (Jam 2.0 only) */
+extern char *jam_action;
+
+/* prototype for external function in jamsym.c */
+extern BOOL jam_check_init_list(char *name, long *value);
+
+/****************************************************************************/
+/*																			*/
+
+void jam_opt_set_mutable
+(
+	int hash
+)
+
+/*																			*/
+/*	Description:	Marks names with the given hash value as modifiable.	*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	if ((hash >= 0) && (hash < JAMC_MAX_SYMBOL_COUNT))
+	{
+		jam_mutable_names[hash >> 3] |= (unsigned char) (1 << (hash & 7));
+	}
+}
+
+/****************************************************************************/
+/*																			*/
+
+BOOL jam_opt_is_mutable
+(
+	int hash
+)
+
+/*																			*/
+/*	Description:	Checks whether a name may be modified after it is		*/
+/*					declared.												*/
+/*																			*/
+/*	Returns:		TRUE if the name may be modified, else FALSE			*/
+/*																			*/
+/****************************************************************************/
+{
+	BOOL result = TRUE;
+
+	if ((hash >= 0) && (hash < JAMC_MAX_SYMBOL_COUNT))
+	{
+		result = (jam_mutable_names[hash >> 3] & (1 << (hash & 7))) ? 1 : 0;
+	}
+
+	return (result);
+}
+
+/****************************************************************************/
+/*																			*/
+
+int jam_opt_name_hash
+(
+	char *buffer,
+	int *index
+)
+
+/*																			*/
+/*	Description:	Reads the symbolic name which begins at buffer[*index]	*/
+/*					and advances *index past the end of the name.			*/
+/*																			*/
+/*	Returns:		hash value of the name, or -1 if the name is empty or	*/
+/*					too long to be a legal symbol name						*/
+/*																			*/
+/****************************************************************************/
+{
+	char name[JAMC_MAX_NAME_LENGTH + 1];
+	int length = 0;
+	int hash = -1;
+
+	while (jam_is_name_char(buffer[*index]))
+	{
+		if (length < JAMC_MAX_NAME_LENGTH)
+		{
+			name[length] = buffer[*index];
+		}
+		++length;
+		++(*index);
+	}
+
+	if ((length > 0) && (length <= JAMC_MAX_NAME_LENGTH))
+	{
+		name[length] = JAMC_NULL_CHAR;
+		hash = jam_hash(name);
+	}
+
+	return (hash);
+}
+
+/****************************************************************************/
+/*																			*/
+
+int jam_opt_next_name
+(
+	char *buffer,
+	int *index
+)
+
+/*																			*/
+/*	Description:	Finds the next symbolic name in the buffer, starting	*/
+/*					at buffer[*index].  Quoted strings, numbers and			*/
+/*					literal array data (#, $ and @ prefixes) are skipped.	*/
+/*					On return *index points past the end of the name.		*/
+/*																			*/
+/*	Returns:		hash value of the name, -1 for an illegal name, or		*/
+/*					JAMC_OPT_END_OF_STATEMENT if no name was found			*/
+/*																			*/
+/****************************************************************************/
+{
+	char ch = 0;
+	int hash = JAMC_OPT_END_OF_STATEMENT;
+	BOOL found = FALSE;
+
+	while ((!found) && (buffer[*index] != JAMC_NULL_CHAR))
+	{
+		ch = buffer[*index];
+
+		if (ch == JAMC_QUOTE_CHAR)
+		{
+			/* skip over quoted string */
+			++(*index);
+			while ((buffer[*index] != JAMC_NULL_CHAR) &&
+				(buffer[*index] != JAMC_QUOTE_CHAR))
+			{
+				++(*index);
+			}
+			if (buffer[*index] == JAMC_QUOTE_CHAR) ++(*index);
+		}
+		else if ((ch == JAMC_POUND_CHAR) || (ch == JAMC_DOLLAR_CHAR) ||
+			(ch == JAMC_AT_CHAR) || jam_isdigit(ch))
+		{
+			/* skip over number or literal array data */
+			++(*index);
+			while (jam_is_name_char(buffer[*index])) ++(*index);
+		}
+		else if (jam_isalpha(ch))
+		{
+			hash = jam_opt_name_hash(buffer, index);
+			found = TRUE;
+		}
+		else
+		{
+			++(*index);
+		}
+	}
+
+	return (hash);
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_opt_mark_all_names
+(
+	char *buffer
+)
+
+/*																			*/
+/*	Description:	Marks every symbolic name in the buffer as modifiable.	*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	int index = 0;
+	int hash = 0;
+
+	while ((hash = jam_opt_next_name(buffer, &index)) !=
+		JAMC_OPT_END_OF_STATEMENT)
+	{
+		jam_opt_set_mutable(hash);
+	}
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_opt_add_edge
+(
+	JAMS_OPT_SCAN *scan,
+	int from_block,
+	int to_hash
+)
+
+/*																			*/
+/*	Description:	Records that a block (or the selected action, if		*/
+/*					from_block is -1) refers to the named block.			*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	if (to_hash >= 0)
+	{
+		if (scan->edge_count < JAMC_MAX_OPT_EDGES)
+		{
+			scan->edge_from[scan->edge_count] = from_block;
+			scan->edge_to[scan->edge_count] = to_hash;
+			++scan->edge_count;
+		}
+		else
+		{
+			/* table is full -- assume everything is reachable */
+			scan->all_reachable = TRUE;
+		}
+	}
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_opt_scan_action
+(
+	JAMS_OPT_SCAN *scan,
+	char *statement_buffer
+)
+
+/*																			*/
+/*	Description:	Examines an ACTION statement.  If it is the selected	*/
+/*					action, each procedure it will call is recorded as a	*/
+/*					starting point for the reachability analysis.			*/
+/*					OPTIONAL and RECOMMENDED procedures are resolved		*/
+/*					against the initialization list exactly as				*/
+/*					jam_call_procedure_from_action() does.					*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	int index = jam_skip_instruction_name(statement_buffer);
+	int name_begin = 0;
+	int name_end = 0;
+	int hash = 0;
+	long init_value = 0L;
+	char save_ch = 0;
+	BOOL init_value_set = FALSE;
+	BOOL call_it = FALSE;
+
+	name_begin = index;
+	while (jam_is_name_char(statement_buffer[index])) ++index;
+	name_end = index;
+
+	save_ch = statement_buffer[name_end];
+	statement_buffer[name_end] = JAMC_NULL_CHAR;
+	if ((jam_action != NULL) && (name_end > name_begin) &&
+		(jam_stricmp(&statement_buffer[name_begin], jam_action) == 0))
+	{
+		scan->action_found = TRUE;
+	}
+	statement_buffer[name_end] = save_ch;
+
+	if (scan->action_found)
+	{
+		/* skip over the description string to the equal sign */
+		while ((statement_buffer[index] != JAMC_NULL_CHAR) &&
+			(statement_buffer[index] != JAMC_EQUAL_CHAR))
+		{
+			if (statement_buffer[index] == JAMC_QUOTE_CHAR)
+			{
+				++index;
+				while ((statement_buffer[index] != JAMC_NULL_CHAR) &&
+					(statement_buffer[index] != JAMC_QUOTE_CHAR))
+				{
+					++index;
+				}
+			}
+			if (statement_buffer[index] != JAMC_NULL_CHAR) ++index;
+		}
+
+		while (statement_buffer[index] == JAMC_EQUAL_CHAR ||
+			statement_buffer[index] == JAMC_COMMA_CHAR)
+		{
+			++index;	/* skip over equal sign or comma */
+
+			while (jam_isspace(statement_buffer[index])) ++index;
+
+			name_begin = index;
+			while (jam_is_name_char(statement_buffer[index])) ++index;
+			name_end = index;
+
+			save_ch = statement_buffer[name_end];
+			statement_buffer[name_end] = JAMC_NULL_CHAR;
+			hash = (name_end > name_begin) ?
+				jam_hash(&statement_buffer[name_begin]) : -1;
+			init_value_set = jam_check_init_list(
+				&statement_buffer[name_begin], &init_value);
+			statement_buffer[name_end] = save_ch;
+
+			while (jam_isspace(statement_buffer[index])) ++index;
+
+			call_it = TRUE;
+			if (jam_strncmp(&statement_buffer[index], "OPTIONAL", 8) == 0)
+			{
+				call_it = (init_value_set && (init_value != 0));
+			}
+			else if (jam_strncmp(&statement_buffer[index], "RECOMMENDED", 11)
+				== 0)
+			{
+				call_it = !(init_value_set && (init_value == 0));
+			}
+
+			if (call_it)
+			{
+				jam_opt_add_edge(scan, -1, hash);
+			}
+
+			while ((statement_buffer[index] != JAMC_NULL_CHAR) &&
+				(statement_buffer[index] != JAMC_COMMA_CHAR) &&
+				(statement_buffer[index] != JAMC_SEMICOLON_CHAR))
+			{
+				++index;
+			}
+		}
+	}
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_opt_scan_declaration
+(
+	JAMS_OPT_SCAN *scan,
+	char *statement_buffer
+)
+
+/*																			*/
+/*	Description:	Examines an INTEGER or BOOLEAN declaration.  Every		*/
+/*					name used in the array bounds or in the initial value	*/
+/*					is recorded as a dependency of the declared variable,	*/
+/*					so that the variable is only treated as constant if		*/
+/*					its initial value is constant.  Literal Boolean array	*/
+/*					data is not examined.									*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	int index = jam_skip_instruction_name(statement_buffer);
+	int data_index = 0;
+	int stop_index = 0;
+	int hash = 0;
+	int dependency = 0;
+	char save_ch = 0;
+
+	hash = jam_opt_name_hash(statement_buffer, &index);
+
+	if (hash >= 0)
+	{
+		/*
+		*	Find the beginning of literal array data, if any
+		*/
+		stop_index = index;
+		while ((statement_buffer[stop_index] != JAMC_NULL_CHAR) &&
+			(statement_buffer[stop_index] != JAMC_EQUAL_CHAR))
+		{
+			++stop_index;
+		}
+
+		if (statement_buffer[stop_index] == JAMC_EQUAL_CHAR)
+		{
+			data_index = stop_index + 1;
+			while (jam_isspace(statement_buffer[data_index])) ++data_index;
+
+			if ((statement_buffer[data_index] != JAMC_POUND_CHAR) &&
+				(statement_buffer[data_index] != JAMC_DOLLAR_CHAR) &&
+				(statement_buffer[data_index] != JAMC_AT_CHAR) &&
+				(((jam_strncmp(&statement_buffer[data_index], "BIN", 3) != 0) &&
+				(jam_strncmp(&statement_buffer[data_index], "HEX", 3) != 0) &&
+				(jam_strncmp(&statement_buffer[data_index], "RLC", 3) != 0) &&
+				(jam_strncmp(&statement_buffer[data_index], "ACA", 3) != 0)) ||
+				!jam_isspace(statement_buffer[data_index + 3])))
+			{
+				/* initial value is an expression -- examine all of it */
+				stop_index = jam_strlen(statement_buffer);
+			}
+		}
+
+		save_ch = statement_buffer[stop_index];
+		statement_buffer[stop_index] = JAMC_NULL_CHAR;
+
+		while ((dependency = jam_opt_next_name(statement_buffer, &index)) !=
+			JAMC_OPT_END_OF_STATEMENT)
+		{
+			if (scan->dependency_count < JAMC_MAX_OPT_DEPENDENCIES)
+			{
+				scan->dependency_name[scan->dependency_count] = hash;
+				scan->dependency_on[scan->dependency_count] = dependency;
+				++scan->dependency_count;
+			}
+			else
+			{
+				/* table is full -- assume the variable is modified */
+				jam_opt_set_mutable(hash);
+			}
+		}
+
+		statement_buffer[stop_index] = save_ch;
+	}
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_opt_scan_statement
+(
+	JAMS_OPT_SCAN *scan,
+	char *statement_buffer,
+	int pass,
+	int block
+)
+
+/*																			*/
+/*	Description:	Examines one executable statement.  On the first pass	*/
+/*					CALL statements are recorded as edges from the			*/
+/*					current block.  On the second pass every variable		*/
+/*					which the statement may modify is marked, and			*/
+/*					declarations are recorded.  The statement after THEN	*/
+/*					in an IF statement is examined recursively.				*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	int index = 0;
+	int then_index = 0;
+	int capture_index = 0;
+	int compare_index = 0;
+	JAME_INSTRUCTION instruction_code = jam_get_instruction(statement_buffer);
+
+	index = jam_skip_instruction_name(statement_buffer);
+
+	if (instruction_code == JAM_IF_INSTR)
+	{
+		then_index = jam_find_keyword(&statement_buffer[index], "THEN");
+
+		if (then_index > 0)
+		{
+			index += then_index + 4;
+			while (jam_isspace(statement_buffer[index])) ++index;
+
+			jam_opt_scan_statement(scan, &statement_buffer[index], pass, block);
+		}
+	}
+	else if (pass == 0)
+	{
+		if (instruction_code == JAM_CALL_INSTR)
+		{
+			jam_opt_add_edge(scan, block,
+				jam_opt_name_hash(statement_buffer, &index));
+		}
+	}
+	else
+	{
+		/*
+		*	If the first word is longer than the instruction name, the
+		*	statement may be an assignment to a variable whose name starts
+		*	with an instruction name (e.g. DATA_OUT = 1)
+		*/
+		while (jam_isalpha(statement_buffer[then_index])) ++then_index;
+
+		if ((instruction_code == JAM_ILLEGAL_INSTR) ||
+			jam_is_name_char(statement_buffer[then_index]))
+		{
+			then_index = 0;
+			jam_opt_set_mutable(jam_opt_name_hash(statement_buffer, &then_index));
+		}
+
+		switch (instruction_code)
+		{
+		case JAM_LET_INSTR:
+		case JAM_FOR_INSTR:
+			jam_opt_set_mutable(jam_opt_name_hash(statement_buffer, &index));
+			break;
+
+		case JAM_POP_INSTR:
+			jam_opt_mark_all_names(&statement_buffer[index]);
+			break;
+
+		case JAM_DRSCAN_INSTR:
+		case JAM_IRSCAN_INSTR:
+		case JAM_VECTOR_INSTR:
+			capture_index = jam_find_keyword(statement_buffer, "CAPTURE");
+			compare_index = jam_find_keyword(statement_buffer, "COMPARE");
+
+			if ((capture_index < 0) ||
+				((compare_index >= 0) && (compare_index < capture_index)))
+			{
+				capture_index = compare_index;
+			}
+
+			if (capture_index >= 0)
+			{
+				jam_opt_mark_all_names(&statement_buffer[capture_index]);
+			}
+			break;
+
+		case JAM_INTEGER_INSTR:
+		case JAM_BOOLEAN_INSTR:
+			jam_opt_scan_declaration(scan, statement_buffer);
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_opt_find_reachable
+(
+	JAMS_OPT_SCAN *scan
+)
+
+/*																			*/
+/*	Description:	Marks the blocks which can be reached from the			*/
+/*					selected action through procedure calls and USES		*/
+/*					lists.  If the action was not found (Jam 1.1 programs	*/
+/*					or a missing action) every block is reachable.			*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	int block = 0;
+	int edge = 0;
+	BOOL changed = TRUE;
+
+	if (!scan->action_found) scan->all_reachable = TRUE;
+
+	for (block = 0; block < scan->block_count; ++block)
+	{
+		scan->block_reachable[block] = scan->all_reachable;
+	}
+
+	while (changed && !scan->all_reachable)
+	{
+		changed = FALSE;
+
+		for (edge = 0; edge < scan->edge_count; ++edge)
+		{
+			if ((scan->edge_from[edge] < 0) ||
+				scan->block_reachable[scan->edge_from[edge]])
+			{
+				for (block = 0; block < scan->block_count; ++block)
+				{
+					if ((!scan->block_reachable[block]) &&
+						(scan->block_hash[block] == scan->edge_to[edge]))
+					{
+						scan->block_reachable[block] = TRUE;
+						changed = TRUE;
+					}
+				}
+			}
+		}
+	}
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_opt_resolve_dependencies
+(
+	JAMS_OPT_SCAN *scan
+)
+
+/*																			*/
+/*	Description:	A variable whose initial value depends on a				*/
+/*					modifiable variable is itself modifiable, since its		*/
+/*					declaration may be executed again with a different		*/
+/*					value.  Repeats until no more variables are marked.		*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	int dependency = 0;
+	BOOL changed = TRUE;
+
+	while (changed)
+	{
+		changed = FALSE;
+
+		for (dependency = 0; dependency < scan->dependency_count; ++dependency)
+		{
+			if (jam_opt_is_mutable(scan->dependency_on[dependency]) &&
+				!jam_opt_is_mutable(scan->dependency_name[dependency]))
+			{
+				jam_opt_set_mutable(scan->dependency_name[dependency]);
+				changed = TRUE;
+			}
+		}
+	}
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_init_optimizer
+(
+	char *statement_buffer
+)
+
+/*																			*/
+/*	Description:	Scans the whole program without executing it.  The		*/
+/*					first pass records the procedure call graph and the		*/
+/*					second pass records which variables may be modified		*/
+/*					by the reachable statements.  Literal Boolean array		*/
+/*					data is skipped, as nothing in it can be folded.  The	*/
+/*					input stream is left at the beginning of the program.	*/
+/*					If anything goes wrong, expression folding is simply	*/
+/*					disabled -- errors will be reported when the program	*/
+/*					executes.												*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	int index = 0;
+	int pass = 0;
+	int block = -1;
+	int block_count = 0;
+	int hash = 0;
+	long statement_count = 0L;
+	long max_table_size = 0L;
+	char label_buffer[JAMC_MAX_NAME_LENGTH + 1];
+	BOOL done = FALSE;
+	JAME_INSTRUCTION instruction_code = JAM_ILLEGAL_INSTR;
+	JAM_RETURN_TYPE status = JAMC_SUCCESS;
+	JAMS_OPT_SCAN *scan = NULL;
+
+	jam_fold_table = NULL;
+
+	for (index = 0; index < (JAMC_MAX_SYMBOL_COUNT + 7) / 8; ++index)
+	{
+		jam_mutable_names[index] = 0;
+	}
+
+	scan = (JAMS_OPT_SCAN *) jam_malloc(sizeof(JAMS_OPT_SCAN));
+
+	if (scan == NULL)
+	{
+		status = JAMC_OUT_OF_MEMORY;
+	}
+	else
+	{
+		scan->block_count = 0;
+		scan->edge_count = 0;
+		scan->dependency_count = 0;
+		scan->action_found = FALSE;
+		scan->all_reachable = FALSE;
+	}
+
+	jam_skip_array_data = TRUE;
+
+	for (pass = 0; (status == JAMC_SUCCESS) && (pass < 2); ++pass)
+	{
+		if (jam_seek(0L) != 0) status = JAMC_IO_ERROR;
+		jam_current_file_position = 0L;
+		block = -1;
+		block_count = 0;
+		done = FALSE;
+
+		while ((status == JAMC_SUCCESS) && !done)
+		{
+			status = jam_get_statement(statement_buffer, label_buffer);
+
+			if (status == JAMC_UNEXPECTED_END)
+			{
+				/* normal end of program */
+				status = JAMC_SUCCESS;
+				done = TRUE;
+			}
+			else if (status == JAMC_SUCCESS)
+			{
+				if (pass == 0) ++statement_count;
+
+				instruction_code = jam_get_instruction(statement_buffer);
+
+				switch (instruction_code)
+				{
+				case JAM_ACTION_INSTR:
+					if (pass == 0)
+					{
+						jam_opt_scan_action(scan, statement_buffer);
+					}
+					break;
+
+				case JAM_PROCEDURE_INSTR:
+				case JAM_DATA_INSTR:
+					block = block_count++;
+					index = jam_skip_instruction_name(statement_buffer);
+
+					if (block >= JAMC_MAX_OPT_BLOCKS)
+					{
+						/* table is full -- assume everything is reachable */
+						scan->all_reachable = TRUE;
+						block = -1;
+					}
+					else if (pass == 0)
+					{
+						scan->block_hash[block] =
+							jam_opt_name_hash(statement_buffer, &index);
+						scan->block_count = block_count;
+
+						/* record the USES list */
+						while (jam_isspace(statement_buffer[index])) ++index;
+						if (jam_strncmp(&statement_buffer[index], "USES", 4) == 0)
+						{
+							index += 4;
+							while ((hash = jam_opt_next_name(statement_buffer,
+								&index)) != JAMC_OPT_END_OF_STATEMENT)
+							{
+								jam_opt_add_edge(scan, block, hash);
+							}
+						}
+					}
+					break;
+
+				case JAM_ENDPROC_INSTR:
+				case JAM_ENDDATA_INSTR:
+					block = -1;
+					break;
+
+				default:
+					if ((block < 0) || scan->block_reachable[block] ||
+						(pass == 0))
+					{
+						jam_opt_scan_statement(scan, statement_buffer,
+							pass, block);
+					}
+					break;
+				}
+			}
+		}
+
+		if ((status == JAMC_SUCCESS) && (pass == 0))
+		{
+			jam_opt_find_reachable(scan);
+		}
+	}
+
+	jam_skip_array_data = FALSE;
+
+	if (status == JAMC_SUCCESS)
+	{
+		jam_opt_resolve_dependencies(scan);
+
+		jam_fold_table_size = (2L * statement_count) | 1L;
+		if (jam_fold_table_size < JAMC_MIN_FOLD_TABLE_SIZE)
+		{
+			jam_fold_table_size = JAMC_MIN_FOLD_TABLE_SIZE;
+		}
+
+		if (jam_workspace != NULL)
+		{
+			/*
+			*	Take the table from the top of the workspace, where the
+			*	symbol records go, shrinking it to leave room for them and
+			*	for the heap.  Folding is disabled if it doesn't fit.
+			*/
+			max_table_size = (((long) jam_symbol_bottom) -
+				((long) jam_heap_top)) / JAMC_FOLD_WORKSPACE_SHARE /
+				(long) sizeof(JAMS_FOLD_RECORD);
+
+			if (jam_fold_table_size > max_table_size)
+			{
+				jam_fold_table_size = max_table_size;
+			}
+
+			if (jam_fold_table_size >= JAMC_MIN_FOLD_TABLE_SIZE)
+			{
+				jam_symbol_bottom = (void *) (((long) jam_symbol_bottom) -
+					jam_fold_table_size * (long) sizeof(JAMS_FOLD_RECORD));
+				jam_fold_table = (JAMS_FOLD_RECORD *) jam_symbol_bottom;
+			}
+		}
+		else
+		{
+			jam_fold_table = (JAMS_FOLD_RECORD *) jam_malloc(
+				(unsigned int) jam_fold_table_size * sizeof(JAMS_FOLD_RECORD));
+		}
+
+		if (jam_fold_table != NULL)
+		{
+			for (index = 0; index < jam_fold_table_size; ++index)
+			{
+				jam_fold_table[index].state = JAM_FOLD_EMPTY;
+			}
+		}
+	}
+
+	if (scan != NULL) jam_free(scan);
+
+	/*
+	*	Return to the beginning of the program
+	*/
+	jam_seek(0L);
+	jam_current_file_position = 0L;
+	jam_current_statement_position = 0L;
+	jam_next_statement_position = 0L;
+}
+
+/****************************************************************************/
+/*																			*/
+
+void jam_free_optimizer(void)
+
+/*																			*/
+/*	Description:	Frees memory used by the folded expression table.		*/
+/*					A table in the workspace needs no freeing.				*/
+/*																			*/
+/*	Returns:		Nothing													*/
+/*																			*/
+/****************************************************************************/
+{
+	if ((jam_fold_table != NULL) && (jam_workspace == NULL))
+	{
+		jam_free(jam_fold_table);
+	}
+
+	jam_fold_table = NULL;
+}
+
+/****************************************************************************/
+/*																			*/
+
+BOOL jam_opt_expression_is_constant
+(
+	char *expression
+)
+
+/*																			*/
+/*	Description:	Checks whether every name used in an expression is a	*/
+/*					variable which is never modified after declaration.		*/
+/*																			*/
+/*	Returns:		TRUE if the expression is constant, else FALSE			*/
+/*																			*/
+/****************************************************************************/
+{
+	int index = 0;
+	int hash = 0;
+	BOOL constant = TRUE;
+
+	while (constant && ((hash = jam_opt_next_name(expression, &index)) !=
+		JAMC_OPT_END_OF_STATEMENT))
+	{
+		if ((hash < 0) || jam_opt_is_mutable(hash)) constant = FALSE;
+	}
+
+	return (constant);
+}
+
+/****************************************************************************/
+/*																			*/
+
+JAMS_FOLD_RECORD *jam_get_fold_record
+(
+	char *expression
+)
+
+/*																			*/
+/*	Description:	Looks up an expression of the current statement in		*/
+/*					the folded expression table, adding it if it is not		*/
+/*					yet present.  The caller evaluates the expression when	*/
+/*					the record state is JAM_FOLD_PENDING and stores the		*/
+/*					result, and can use the stored result when the state	*/
+/*					is JAM_FOLD_CONSTANT.									*/
+/*																			*/
+/*	Returns:		pointer to fold record, or NULL if the expression		*/
+/*					cannot be folded										*/
+/*																			*/
+/****************************************************************************/
+{
+	int length = 0;
+	int probe = 0;
+	unsigned long hash = (unsigned long) jam_current_statement_position;
+	JAMS_FOLD_RECORD *fold_record = NULL;
+	JAMS_FOLD_RECORD *result = NULL;
+	BOOL done = FALSE;
+
+	if (jam_fold_table != NULL)
+	{
+		while ((length <= JAMC_MAX_FOLD_LENGTH) &&
+			(expression[length] != JAMC_NULL_CHAR))
+		{
+			hash = (hash * 31) + (unsigned char) expression[length];
+			++length;
+		}
+
+		if (length > JAMC_MAX_FOLD_LENGTH) done = TRUE;
+
+		for (probe = 0; (!done) && (probe < JAMC_MAX_FOLD_PROBES); ++probe)
+		{
+			fold_record = &jam_fold_table[
+				(hash + (unsigned long) probe) %
+				(unsigned long) jam_fold_table_size];
+
+			if (fold_record->state == JAM_FOLD_EMPTY)
+			{
+				/* add a new record for this expression */
+				fold_record->position = jam_current_statement_position;
+				jam_strcpy(fold_record->expression, expression);
+				fold_record->state = jam_opt_expression_is_constant(expression) ?
+					JAM_FOLD_PENDING : JAM_FOLD_VARIABLE;
+				result = fold_record;
+				done = TRUE;
+			}
+			else if ((fold_record->position == jam_current_statement_position)
+				&& (jam_strcmp(fold_record->expression, expression) == 0))
+			{
+				result = fold_record;
+				done = TRUE;
+			}
+		}
+	}
+
+	if ((result != NULL) && (result->state == JAM_FOLD_VARIABLE))
+	{
+		result = NULL;
+	}
+
+	return (result);
+}
@@ -0,0 +1,66 @@
+/****************************************************************************/
+/*																			*/
+/*	Module:			jamopt.h												*/
+/*																			*/
+/*	Description:	Prototypes for the load-time program optimizer, which	*/
+/*					finds variables that are never modified after they		*/
+/*					are declared and folds expressions that use only		*/
+/*					those variables.										*/
+/*																			*/
+/****************************************************************************/
+
+#ifndef INC_JAMOPT_H
+#define INC_JAMOPT_H
+
+/****************************************************************************/
+/*																			*/
+/*	Type definitions														*/
+/*																			*/
+/****************************************************************************/
+
+/* longest expression (in characters) kept in the folded expression table */
+#define JAMC_MAX_FOLD_LENGTH 47
+
+/* states of a folded expression record */
+typedef enum
+{
+	JAM_FOLD_EMPTY = 0,
+	JAM_FOLD_VARIABLE,	/* expression uses a variable which may change */
+	JAM_FOLD_PENDING,	/* expression is constant, not yet evaluated */
+	JAM_FOLD_CONSTANT	/* expression is constant, value is known */
+
+} JAME_FOLD_STATE;
+
+/* folded expression record structure */
+typedef struct JAMS_FOLD_STRUCT
+{
+	JAME_FOLD_STATE state;
+	long position;		/* position of statement containing expression */
+	long value;
+	JAME_EXPRESSION_TYPE type;
+	char expression[JAMC_MAX_FOLD_LENGTH + 1];
+
+} JAMS_FOLD_RECORD;
+
+/****************************************************************************/
+/*																			*/
+/*	Function prototypes														*/
+/*																			*/
+/****************************************************************************/
+
+void jam_init_optimizer
+(
+	char *statement_buffer
+);
+
+void jam_free_optimizer
+(
+	void
+);
+
+JAMS_FOLD_RECORD *jam_get_fold_record
+(
+	char *expression
+);
+
+#endif /* INC_JAMOPT_H */
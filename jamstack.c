@@ -67,6 +67,7 @@ JAM_RETURN_TYPE jam_init_stack(void)
 			jam_stack[index].type = JAM_ILLEGAL_STACK_TYPE;
 			jam_stack[index].iterator = (JAMS_SYMBOL_RECORD *) 0;
 			jam_stack[index].for_position = 0L;
+			jam_stack[index].next_position = 0L;
 			jam_stack[index].stop_value = 0L;
 			jam_stack[index].step_value = 0L;
 			jam_stack[index].push_value = 0L;
@@ -123,6 +124,7 @@ JAM_RETURN_TYPE jam_push_stack_record
 		jam_stack[index].type            = stack_record->type;
 		jam_stack[index].iterator        = stack_record->iterator;
 		jam_stack[index].for_position    = stack_record->for_position;
+		jam_stack[index].next_position   = stack_record->next_position;
 		jam_stack[index].stop_value      = stack_record->stop_value;
 		jam_stack[index].step_value      = stack_record->step_value;
 		jam_stack[index].push_value      = stack_record->push_value;
@@ -202,6 +204,7 @@ JAM_RETURN_TYPE jam_pop_stack_record(void)
 		jam_stack[index].type = JAM_ILLEGAL_STACK_TYPE;
 		jam_stack[index].iterator = (JAMS_SYMBOL_RECORD *) 0;
 		jam_stack[index].for_position = 0L;
+		jam_stack[index].next_position = 0L;
 		jam_stack[index].stop_value = 0L;
 		jam_stack[index].step_value = 0L;
 		jam_stack[index].push_value = 0L;
@@ -236,6 +239,7 @@ JAM_RETURN_TYPE jam_push_fornext_record
 	stack_record.type            = JAM_STACK_FOR_NEXT;
 	stack_record.iterator        = iterator;
 	stack_record.for_position    = for_position;
+	stack_record.next_position   = -1L;	/* not known until NEXT is found */
 	stack_record.stop_value      = stop_value;
 	stack_record.step_value      = step_value;
 	stack_record.push_value      = 0L;
@@ -264,6 +268,7 @@ JAM_RETURN_TYPE jam_push_pushpop_record
 	stack_record.type            = JAM_STACK_PUSH_POP;
 	stack_record.iterator        = NULL;
 	stack_record.for_position    = 0L;
+	stack_record.next_position   = 0L;
 	stack_record.stop_value      = 0L;
 	stack_record.step_value      = 0L;
 	stack_record.push_value      = value;
@@ -292,6 +297,7 @@ JAM_RETURN_TYPE jam_push_callret_record
 	stack_record.type            = JAM_STACK_CALL_RETURN;
 	stack_record.iterator        = NULL;
 	stack_record.for_position    = 0L;
+	stack_record.next_position   = 0L;
 	stack_record.stop_value      = 0L;
 	stack_record.step_value      = 0L;
 	stack_record.push_value      = 0L;
@@ -36,6 +36,7 @@ typedef struct
 	JAME_STACK_RECORD_TYPE type;
 	JAMS_SYMBOL_RECORD *iterator;	/* used only for FOR/NEXT */
 	long for_position;				/* used only for FOR/NEXT */
+	long next_position;				/* used only for FOR/NEXT */
 	long stop_value;				/* used only for FOR/NEXT */
 	long step_value;				/* used only for FOR/NEXT */
 	long push_value;				/* used only for PUSH/POP */
@@ -64,6 +64,14 @@ typedef unsigned long DWORD;
 #include <ctype.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
 
 #include "jamexprt.h"
 #include "iolib.h"
@@ -79,10 +87,49 @@ typedef unsigned long DWORD;
 char *file_buffer = NULL;
 long file_pointer = 0L;
 long file_length = 0L;
+BOOL file_mapped = FALSE;	/* TRUE if file_buffer is a mapping of the file */
 
 /* delay count for one millisecond delay */
 long one_ms_delay = 0L;
 
+/* counters kept on every run, as described under "Counters" below */
+typedef struct
+{
+	long run_count;
+	long statement_count;
+	long tck_count;
+	long cycle_count[2];		/* TCK cycles moving and shifting */
+	long sample_count[2];		/* cycles timed, moving and shifting */
+	double sample_time[2];		/* seconds */
+	long ir_scan_count;
+	long ir_bit_count;
+	long dr_scan_count;
+	long dr_bit_count;
+	long gpio_write_count;
+	long gpio_read_count;
+	long delay_count;
+	long delay_requested;		/* microseconds */
+	double delay_actual;		/* seconds */
+} PLAYER_COUNTERS;
+
+PLAYER_COUNTERS counters;
+
+/* state of the TAP controller, or -1 until it has been reset */
+int tap_state = -1;
+int tap_tms_high_count = 0;
+
+/* results as JSON lines, with the --json option */
+BOOL json_output = FALSE;
+
+/* execution profile, with the -e option */
+BOOL profiling = FALSE;
+
+/* JTAG trace, with the -j option */
+BOOL tracing = FALSE;
+
+/* scan vector file, with the -x option */
+BOOL vector_export = FALSE;
+
 /* delay count to reduce the maximum TCK frequency */
 int tck_delay = 0;
 
@@ -116,6 +163,12 @@ void close_jtag_hardware(void);
 
 /* function prototypes to allow forward reference */
 extern void delay_loop(long count);
+double profile_clock(void);
+void print_json_string(char *text);
+void trace_jtag_cycle(int tms, int tdi, int read_tdo, int tdo);
+void trace_delay(long microseconds);
+void export_vector_cycle(int tms, int tdi, int read_tdo, int tdo);
+void export_vector_wait(long microseconds);
 
 /*
 *	This structure stores information about each available vector signal
@@ -206,16 +259,50 @@ int BTDO=13;
 int BTDI=14;
 
 // Beaglebone via iolib
-void pin_set(int x, int p) { if (x) pin_high(BANK,p); else pin_low(BANK,p); }
-int pin_get(int p) { return is_high(BANK,p); }
+void pin_set(int x, int p) { ++counters.gpio_write_count; if (x) pin_high(BANK,p); else pin_low(BANK,p); }
+int pin_get(int p) { ++counters.gpio_read_count; return is_high(BANK,p); }
 
-int jam_jtag_io(int tms, int tdi, int read_tdo)
+/* TAP controller states, as used by tap_transitions */
+#define TAP_RESET 0
+#define TAP_SHIFT_DR 4
+#define TAP_SHIFT_IR 11
+
+/* next state for TMS low and high, from each state */
+const int tap_transitions[16][2] =
+{
+	{  1,  0 },		/* Test-Logic-Reset */
+	{  1,  2 },		/* Run-Test/Idle */
+	{  3,  9 },		/* Select-DR-Scan */
+	{  4,  5 },		/* Capture-DR */
+	{  4,  5 },		/* Shift-DR */
+	{  6,  8 },		/* Exit1-DR */
+	{  6,  7 },		/* Pause-DR */
+	{  4,  8 },		/* Exit2-DR */
+	{  1,  2 },		/* Update-DR */
+	{ 10,  0 },		/* Select-IR-Scan */
+	{ 11, 12 },		/* Capture-IR */
+	{ 11, 12 },		/* Shift-IR */
+	{ 13, 15 },		/* Exit1-IR */
+	{ 13, 14 },		/* Pause-IR */
+	{ 11, 15 },		/* Exit2-IR */
+	{  1,  2 }		/* Update-IR */
+};
+
+/* one cycle in this many, moving or shifting, is timed */
+#define COUNTER_SAMPLE_INTERVAL 64L
+
+/* drives one TCK cycle on the pins */
+int jtag_cycle(int tms, int tdi, int read_tdo)
 {
 	tdi = !!tdi;
 	static int oms = -1;
 	static int odi = -1;
 	const int SLOW = 0;
-
+	int shifting = ((tap_state == TAP_SHIFT_DR) ||
+		(tap_state == TAP_SHIFT_IR)) ? 1 : 0;
+	BOOL sample = ((++counters.cycle_count[shifting] %
+		COUNTER_SAMPLE_INTERVAL) == 0L);
+	double start_time = sample ? profile_clock() : 0.0;
 	
 	if (!jtag_hardware_initialized)
 	{
@@ -240,18 +327,71 @@ int jam_jtag_io(int tms, int tdi, int read_tdo)
 
 	//fprintf(stderr,"tagio:: tms:%d tdi:%d rd=%d %s\n",tms,tdi,read_tdo,read_tdo==0?"":tdo?"1":"0");
 
+	if (sample)
+	{
+		counters.sample_time[shifting] += profile_clock() - start_time;
+		++counters.sample_count[shifting];
+	}
+
+	++counters.tck_count;
+
+	/* the state is known once TMS has been high for five cycles */
+	tms = !!tms;
+	if (tap_state >= 0)
+	{
+		tap_state = tap_transitions[tap_state][tms];
+	}
+	else
+	{
+		tap_tms_high_count = tms ? (tap_tms_high_count + 1) : 0;
+		if (tap_tms_high_count >= 5) tap_state = TAP_RESET;
+	}
+
+	return (tdo);
+}
+
+int jam_jtag_io(int tms, int tdi, int read_tdo)
+{
+	int tdo = 0;
+	int profile_phase = JAMC_PROFILE_EXECUTE;
+
+	if (profiling) profile_phase = jam_profile_phase(JAMC_PROFILE_JTAG);
+
+	tdo = jtag_cycle(tms, tdi, read_tdo);
+
+	if (tracing) trace_jtag_cycle(tms, tdi, read_tdo, tdo);
+	if (vector_export) export_vector_cycle(tms, tdi, read_tdo, tdo);
+
+	if (profiling) jam_profile_phase(profile_phase);
+
 	return (tdo);
 }
 
 void jam_message(char *message_text)
 {
-	puts(message_text);
+	if (json_output)
+	{
+		printf("{\"type\":\"message\",\"text\":");
+		print_json_string(message_text);
+		printf("}\n");
+	}
+	else
+	{
+		puts(message_text);
+	}
 	fflush(stdout);
 }
 
 void jam_export_integer(char *key, long value)
 {
-	if (verbose)
+	if (json_output)
+	{
+		printf("{\"type\":\"export\",\"key\":");
+		print_json_string(key);
+		printf(",\"value\":%ld}\n", value);
+		fflush(stdout);
+	}
+	else if (verbose)
 	{
 		printf("Export: key = \"%s\", value = %ld\n", key, value);
 		fflush(stdout);
@@ -283,7 +423,28 @@ void jam_export_boolean_array(char *key, unsigned char *data, long count)
 	char string[HEX_LINE_CHARS + 1];
 	long i, offset;
 
-	if (verbose)
+	if (json_output)
+	{
+		/* the whole value as one hex string, most significant first */
+		printf("{\"type\":\"export\",\"key\":");
+		print_json_string(key);
+		printf(",\"bits\":%ld,\"value\":\"", count);
+
+		for (i = ((count + 3) / 4) - 1; i >= 0; --i)
+		{
+			value = 0;
+			for (k = 0; (k < 4) && ((i * 4) + (long) k < count); ++k)
+			{
+				j = (unsigned long) ((i * 4) + (long) k);
+				if (data[j >> 3] & (1 << (j & 7))) value |= (1 << k);
+			}
+			putchar(conv_to_hex(value));
+		}
+
+		printf("\"}\n");
+		fflush(stdout);
+	}
+	else if (verbose)
 	{
 		if (count > HEX_LINE_BITS)
 		{
@@ -355,7 +516,18 @@ void jam_export_boolean_array(char *key, unsigned char *data, long count)
 
 void jam_delay(long microseconds)
 {
+	int profile_phase = JAMC_PROFILE_EXECUTE;
+	double start_time = 0.0;
+
+	if (profiling) profile_phase = jam_profile_phase(JAMC_PROFILE_DELAY);
+	if (tracing) trace_delay(microseconds);
+	if (vector_export) export_vector_wait(microseconds);
+	start_time = profile_clock();
 	usleep(microseconds);
+	counters.delay_actual += profile_clock() - start_time;
+	counters.delay_requested += microseconds;
+	++counters.delay_count;
+	if (profiling) jam_profile_phase(profile_phase);
 	return;
 #if PORT == WINDOWS
 	/* if Windows NT, flush I/O cache buffer before delay loop */
@@ -584,241 +756,3389 @@ void jam_free(void *ptr)
 
 /************************************************************************
 *
-*	get_tick_count() -- Get system tick count in milliseconds
+*	Jam file mapping
 *
-*	for DOS, use BIOS function _bios_timeofday()
-*	for WINDOWS use GetTickCount() function
-*	for UNIX use clock() system function
+*	The Jam file is mapped into memory read-only rather than read into a
+*	buffer, so it is not copied and its pages are shared with the page
+*	cache.  The kernel is asked to start reading the whole file at once,
+*	so that the CRC pass and execution can begin before it is all in.
+*	If the file can't be mapped it is read into a buffer as before.
 */
-DWORD get_tick_count(void)
+
+char *map_jam_file(char *filename, long *length)
 {
-	DWORD tick_count = 0L;
+	int fd = -1;
+	struct stat file_stat;
+	char *map = NULL;
 
-	/* assume clock() function returns microseconds */
-	tick_count = (DWORD) (clock()*1000 / CLOCKS_PER_SEC);
+	if ((fd = open(filename, O_RDONLY)) >= 0)
+	{
+		if ((fstat(fd, &file_stat) == 0) && (file_stat.st_size > 0))
+		{
+			map = (char *) mmap(NULL, (size_t) file_stat.st_size,
+				PROT_READ, MAP_PRIVATE, fd, 0);
 
-	return (tick_count);
-}
+			if (map == (char *) MAP_FAILED)
+			{
+				map = NULL;
+			}
+			else
+			{
+				madvise(map, (size_t) file_stat.st_size, MADV_WILLNEED);
+				*length = (long) file_stat.st_size;
+			}
+		}
 
-#define DELAY_SAMPLES 10
-#define DELAY_CHECK_LOOPS 10000
+		close(fd);
+	}
 
-void calibrate_delay(void)
-{
-	one_ms_delay = 1000L;
+	return (map);
 }
 
-char *error_text[] =
-{
-/* JAMC_SUCCESS            0 */ "success",
-/* JAMC_OUT_OF_MEMORY      1 */ "out of memory",
-/* JAMC_IO_ERROR           2 */ "file access error",
-/* JAMC_SYNTAX_ERROR       3 */ "syntax error",
-/* JAMC_UNEXPECTED_END     4 */ "unexpected end of file",
-/* JAMC_UNDEFINED_SYMBOL   5 */ "undefined symbol",
-/* JAMC_REDEFINED_SYMBOL   6 */ "redefined symbol",
-/* JAMC_INTEGER_OVERFLOW   7 */ "integer overflow",
-/* JAMC_DIVIDE_BY_ZERO     8 */ "divide by zero",
-/* JAMC_CRC_ERROR          9 */ "CRC mismatch",
-/* JAMC_INTERNAL_ERROR    10 */ "internal error",
-/* JAMC_BOUNDS_ERROR      11 */ "bounds error",
-/* JAMC_TYPE_MISMATCH     12 */ "type mismatch",
-/* JAMC_ASSIGN_TO_CONST   13 */ "assignment to constant",
-/* JAMC_NEXT_UNEXPECTED   14 */ "NEXT unexpected",
-/* JAMC_POP_UNEXPECTED    15 */ "POP unexpected",
-/* JAMC_RETURN_UNEXPECTED 16 */ "RETURN unexpected",
-/* JAMC_ILLEGAL_SYMBOL    17 */ "illegal symbol name",
-/* JAMC_VECTOR_MAP_FAILED 18 */ "vector signal name not found",
-/* JAMC_USER_ABORT        19 */ "execution cancelled",
-/* JAMC_STACK_OVERFLOW    20 */ "stack overflow",
-/* JAMC_ILLEGAL_OPCODE    21 */ "illegal instruction code",
-/* JAMC_PHASE_ERROR       22 */ "phase error",
-/* JAMC_SCOPE_ERROR       23 */ "scope error",
-/* JAMC_ACTION_NOT_FOUND  24 */ "action not found",
-};
-
-#define MAX_ERROR_CODE (int)((sizeof(error_text)/sizeof(error_text[0]))+1)
+/************************************************************************
+*
+*	Job server
+*
+*	With -l<socket>, the player stays running as a server which keeps
+*	the JTAG hardware set up, and keeps the Jam files it has been asked
+*	to run mapped with their CRC already checked, and runs jobs sent to
+*	it on a Unix domain socket.  A job is one line giving the file name
+*	and, optionally, -a<action>, -d<var=val> and -v options separated by
+*	spaces.  Each job is run by a child process, so that it starts with
+*	a clean interpreter, and everything it prints goes back over the
+*	socket, followed by a line giving its exit code and time.  Jobs are
+*	run one at a time, in the order they are accepted.  A line holding
+*	--counters instead gets the counters of all jobs run so far.
+*	Only the user running the server can connect to the socket, and a
+*	client must send its job line within JOB_READ_TIMEOUT seconds.
+*/
 
-/************************************************************************/
+#define JOB_PROGRAM_COUNT 8
+#define JOB_LINE_LENGTH 1024
+#define JOB_FAILED 255		/* exit status of a job which didn't run */
+#define JOB_READ_TIMEOUT 10	/* seconds to wait for the job line */
 
-int main(int argc, char **argv)
+typedef struct JOB_PROGRAM_STRUCT
 {
-	BOOL help = FALSE;
-	BOOL error = FALSE;
-	char *filename = NULL;
-	long offset = 0L;
-	long error_line = 0L;
-	JAM_RETURN_TYPE crc_result = JAMC_SUCCESS;
-	JAM_RETURN_TYPE exec_result = JAMC_SUCCESS;
-	unsigned short expected_crc = 0;
-	unsigned short actual_crc = 0;
-	char key[33] = {0};
-	char value[257] = {0};
-	int exit_status = 0;
-	int arg = 0;
-	int exit_code = 0;
-	int format_version = 0;
-	time_t start_time = 0;
-	time_t end_time = 0;
-	int time_delta = 0;
-	char *workspace = NULL;
-	char *action = NULL;
-	char *init_list[10];
-	int init_count = 0;
-	FILE *fp = NULL;
-	struct stat sbuf;
-	long workspace_size = 0;
-	char *exit_string = NULL;
-	int reset_jtag = 1;
-
-	verbose = FALSE;
-
-	init_list[0] = NULL;
-
-	/* print out the version string and copyright message */
-	fprintf(stderr, "Jam STAPL Player Version 2.5 (20040526)\nCopyright (C) 1997-2004 Altera Corporation\n\n");
-
-	for (arg = 1; arg < argc; arg++)
+	char name[JOB_LINE_LENGTH];
+	time_t mtime;
+	long mtime_nsec;
+	ino_t inode;
+	long length;
+	char *buffer;
+	long last_used;
+	JAM_RETURN_TYPE crc_result;
+	unsigned short expected_crc;
+	unsigned short actual_crc;
+} JOB_PROGRAM;
+
+char *job_socket_name = NULL;
+JOB_PROGRAM job_programs[JOB_PROGRAM_COUNT];
+long job_count = 0L;
+
+/* the program being run by this process, if it is running a job */
+JOB_PROGRAM *job_program = NULL;
+
+extern PLAYER_COUNTERS *job_counters;
+void print_counters(FILE *fp, PLAYER_COUNTERS *c);
+char *image_program_text(char *buffer, long length, long *text_length);
+
+JOB_PROGRAM *get_job_program(char *name)
+{
+	struct stat file_stat;
+	int index = 0;
+	JOB_PROGRAM *program = NULL;
+	JOB_PROGRAM *oldest = &job_programs[0];
+	char *text = NULL;
+	long text_length = 0L;
+
+	if ((strlen(name) < JOB_LINE_LENGTH) && (stat(name, &file_stat) == 0))
 	{
-		if ((argv[arg][0] == '-') || (argv[arg][0] == '/'))
+		for (index = 0; index < JOB_PROGRAM_COUNT; ++index)
 		{
-			switch(toupper(argv[arg][1]))
+			if ((program == NULL) && (job_programs[index].buffer != NULL) &&
+				(strcmp(job_programs[index].name, name) == 0))
 			{
-			case 'A':				/* set action name */
-				action = &argv[arg][2];
-				if (action[0] == '"') ++action;
-				break;
-
-			case 'D':				/* initialization list */
-				if (argv[arg][2] == '"')
-				{
-					init_list[init_count] = &argv[arg][3];
-				}
-				else
-				{
-					init_list[init_count] = &argv[arg][2];
-				}
-				init_list[++init_count] = NULL;
-				break;
-			case 'P': 
-				BTCK=atoi(&argv[arg][2]);
-				break;
-				
-			case 'R':		/* don't reset the JTAG chain after use */
-				reset_jtag = 0;
-				break;
-
-			case 'S':				/* set serial port address */
-				serial_port_name = &argv[arg][2];
-				specified_com_port = TRUE;
-				break;
-
-			case 'M':				/* set memory size */
-				if (sscanf(&argv[arg][2], "%ld", &workspace_size) != 1)
-					error = TRUE;
-				if (workspace_size == 0) error = TRUE;
-				break;
+				program = &job_programs[index];
+			}
 
-			case 'H':				/* help */
-				help = TRUE;
-				break;
+			if (job_programs[index].last_used < oldest->last_used)
+			{
+				oldest = &job_programs[index];
+			}
+		}
 
-			case 'V':				/* verbose */
-				verbose = TRUE;
-				break;
+		/* reuse the least recently used entry for a new file */
+		if (program == NULL) program = oldest;
 
-			default:
-				error = TRUE;
-				break;
-			}
+		/* map the file again if it is new or has changed */
+		if ((program->buffer != NULL) &&
+			((strcmp(program->name, name) != 0) ||
+			(program->mtime != file_stat.st_mtime) ||
+			(program->mtime_nsec != (long) file_stat.st_mtim.tv_nsec) ||
+			(program->inode != file_stat.st_ino) ||
+			(program->length != (long) file_stat.st_size)))
+		{
+			munmap(program->buffer, (size_t) program->length);
+			program->buffer = NULL;
 		}
-		else
+
+		if (program->buffer == NULL)
 		{
-			/* it's a filename */
-			if (filename == NULL)
-			{
-				filename = argv[arg];
-			}
-			else
+			strcpy(program->name, name);
+			program->mtime = file_stat.st_mtime;
+			program->mtime_nsec = (long) file_stat.st_mtim.tv_nsec;
+			program->inode = file_stat.st_ino;
+			program->buffer = map_jam_file(name, &program->length);
+			program->expected_crc = 0;
+			program->actual_crc = 0;
+
+			/* only the Jam text of a program image has a CRC */
+			if (program->buffer != NULL)
 			{
-				/* error -- we already found a filename */
-				error = TRUE;
+				text = image_program_text(program->buffer, program->length,
+					&text_length);
+				program->crc_result = jam_check_crc(text, text_length,
+					&program->expected_crc, &program->actual_crc);
 			}
 		}
 
-		if (error)
+		if (program->buffer == NULL)
 		{
-			fprintf(stderr, "Illegal argument: \"%s\"\n", argv[arg]);
-			help = TRUE;
-			error = FALSE;
+			program->last_used = 0L;
+			program = NULL;
+		}
+		else
+		{
+			program->last_used = ++job_count;
 		}
 	}
 
-	if (help || (filename == NULL))
-	{
-		fprintf(stderr, "Usage:  jam [options] <filename>\n");
-		fprintf(stderr, "\nAvailable options:\n");
-		fprintf(stderr, "    -h          : show help message\n");
-		fprintf(stderr, "    -v          : show verbose messages\n");
-		fprintf(stderr, "    -a<action>  : specify action name (Jam STAPL)\n");
-		fprintf(stderr, "    -d<var=val> : initialize variable to specified value (Jam 1.1)\n");
-		fprintf(stderr, "    -d<proc=1>  : enable optional procedure (Jam STAPL)\n");
-		fprintf(stderr, "    -d<proc=0>  : disable recommended procedure (Jam STAPL)\n");
-		fprintf(stderr, "    -p<clk_pin> : BBB pin for clk, defaults 811, which is pin 11, header P8.\n");
-		fprintf(stderr, "    -s<port>    : serial port name (for BitBlaster)\n");
-		fprintf(stderr, "    -r          : don't reset JTAG TAP after use\n");
-		exit_status = 1;
-	}
-	else if ((workspace_size > 0) &&
-		((workspace = (char *) jam_malloc((size_t) workspace_size)) == NULL))
+	return (program);
+}
+
+int read_job_line(int fd, char *line, int size)
+{
+	int length = 0;
+	int count = 1;
+	char ch = '\0';
+
+	while ((length < size - 1) && (ch != '\n') &&
+		((count = (int) read(fd, &ch, 1)) == 1))
 	{
-		fprintf(stderr, "Error: can't allocate memory (%d Kbytes)\n",
-			(int) (workspace_size / 1024L));
-		exit_status = 1;
+		line[length++] = ch;
 	}
-	else if (access(filename, 0) != 0)
+
+	line[length] = '\0';
+
+	/* -1 if the client sent nothing for JOB_READ_TIMEOUT seconds */
+	return ((count < 0) ? -1 : length);
+}
+
+BOOL serve_jobs
+(
+	char **filename,
+	char **action,
+	char **init_list
+)
+{
+	static char line[JOB_LINE_LENGTH];
+	struct sockaddr_un address;
+	struct timeval read_timeout;
+	struct timeval start_time;
+	struct timeval end_time;
+	int server = -1;
+	int client = -1;
+	int status = 0;
+	int job_exit_code = 0;
+	int init_count = 0;
+	long job_time = 0L;
+	char *name = NULL;
+	char *job_action = NULL;
+	char *token = NULL;
+	BOOL job_verbose = FALSE;
+	BOOL query = FALSE;
+	BOOL timed_out = FALSE;
+	BOOL job = FALSE;
+	pid_t child = -1;
+	FILE *client_fp = NULL;
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, job_socket_name, sizeof(address.sun_path) - 1);
+	read_timeout.tv_sec = JOB_READ_TIMEOUT;
+	read_timeout.tv_usec = 0;
+
+	/* a client which goes away must not stop the server */
+	signal(SIGPIPE, SIG_IGN);
+	unlink(job_socket_name);
+
+	if (((server = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) ||
+		(bind(server, (struct sockaddr *) &address, sizeof(address)) != 0) ||
+		(chmod(job_socket_name, S_IRUSR | S_IWUSR) != 0) ||
+		(listen(server, 8) != 0))
 	{
-		fprintf(stderr, "Error: can't access file \"%s\"\n", filename);
-		exit_status = 1;
+		fprintf(stderr, "Error: can't listen on socket \"%s\"\n",
+			job_socket_name);
 	}
 	else
 	{
-		/* get length of file */
-		if (stat(filename, &sbuf) == 0) file_length = sbuf.st_size;
+		if (!jtag_hardware_initialized)
+		{
+			initialize_jtag_hardware();
+			jtag_hardware_initialized = TRUE;
+		}
 
-		if ((fp = fopen(filename, "rb")) == NULL)
+		/* the children add their counters to these */
+		job_counters = (PLAYER_COUNTERS *) mmap(NULL, sizeof(PLAYER_COUNTERS),
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+		if (job_counters == (PLAYER_COUNTERS *) MAP_FAILED)
 		{
-			fprintf(stderr, "Error: can't open file \"%s\"\n", filename);
-			exit_status = 1;
+			job_counters = NULL;
 		}
 		else
 		{
-			/*
-			*	Read entire file into a buffer
-			*/
+			memset(job_counters, 0, sizeof(PLAYER_COUNTERS));
+		}
+
+		fprintf(stderr, "Waiting for jobs on socket \"%s\"\n",
+			job_socket_name);
+		fflush(stderr);
+
+		while ((!job) && ((client = accept(server, NULL, NULL)) >= 0))
+		{
+			/* a client which never sends its job must not hang the server */
+			setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &read_timeout,
+				sizeof(read_timeout));
+			timed_out = (read_job_line(client, line, JOB_LINE_LENGTH) < 0);
+			gettimeofday(&start_time, NULL);
+
+			name = NULL;
+			job_action = NULL;
+			job_verbose = FALSE;
+			query = FALSE;
+			init_count = 0;
+			init_list[0] = NULL;
+
+			for (token = strtok(line, " \t\r\n"); token != NULL;
+				token = strtok(NULL, " \t\r\n"))
+			{
+				if ((token[0] == '-') && (toupper(token[1]) == 'A'))
+				{
+					job_action = &token[2];
+				}
+				else if ((token[0] == '-') && (toupper(token[1]) == 'D') &&
+					(init_count < 9))
+				{
+					init_list[init_count] = &token[2];
+					init_list[++init_count] = NULL;
+				}
+				else if ((token[0] == '-') && (toupper(token[1]) == 'V'))
+				{
+					job_verbose = TRUE;
+				}
+				else if (strcmp(token, "--counters") == 0)
+				{
+					query = TRUE;
+				}
+				else if (name == NULL)
+				{
+					name = token;
+				}
+			}
+
+			job_exit_code = (query && !timed_out) ? 0 : -1;
+			job_program = ((name == NULL) || query || timed_out) ?
+				NULL : get_job_program(name);
+
+			/* don't let the child inherit unwritten output */
+			fflush(stdout);
+			fflush(stderr);
+
+			if (timed_out)
+			{
+				dprintf(client, "Error: timed out waiting for the job\n");
+			}
+			else if (query)
+			{
+				if ((job_counters == NULL) ||
+					((client_fp = fdopen(dup(client), "w")) == NULL))
+				{
+					dprintf(client, "Error: counters not available\n");
+					job_exit_code = -1;
+				}
+				else
+				{
+					print_counters(client_fp, job_counters);
+					fclose(client_fp);
+				}
+			}
+			else if (job_program == NULL)
+			{
+				dprintf(client, "Error: can't access file \"%s\"\n",
+					(name == NULL) ? "" : name);
+			}
+			else if ((child = fork()) == 0)
+			{
+				/* the child runs the job and sends its output back */
+				dup2(client, STDOUT_FILENO);
+				dup2(client, STDERR_FILENO);
+				close(client);
+				close(server);
+				memset(&counters, 0, sizeof(counters));
+
+				*filename = job_program->name;
+				*action = job_action;
+				if (job_verbose) verbose = TRUE;
+				file_buffer = job_program->buffer;
+				file_length = job_program->length;
+				file_mapped = TRUE;
+				job = TRUE;
+			}
+			else if (child < 0)
+			{
+				dprintf(client, "Error: can't start job\n");
+			}
+			else if ((waitpid(child, &status, 0) == child) &&
+				WIFEXITED(status) && (WEXITSTATUS(status) != JOB_FAILED))
+			{
+				job_exit_code = WEXITSTATUS(status);
+			}
+
+			if (!job)
+			{
+				gettimeofday(&end_time, NULL);
+				job_time = (long) (end_time.tv_sec - start_time.tv_sec) * 1000L +
+					(long) (end_time.tv_usec - start_time.tv_usec) / 1000L;
+				dprintf(client, "Job finished: exit code = %d, time = %ld ms\n",
+					job_exit_code, job_time);
+				close(client);
+			}
+		}
+
+		if (!job) close(server);
+	}
+
+	return (job);
+}
+
+/************************************************************************
+*
+*	Decoded array data cache
+*
+*	Boolean arrays which are initialized from BIN, HEX, RLC or ACA data
+*	can be saved in a cache file after they are decoded, so that later
+*	runs of the same Jam file copy the words straight into the heap.
+*	The file is only used if the CRC and length of the Jam file match
+*	the values in its header.  It is laid out as a header, a table of
+*	entries sorted by file position, and the data words, so it can be
+*	mapped into memory and searched without any parsing.  The cache is
+*	in the native word size and byte order of the host.
+*/
+
+#define ARRAY_CACHE_MAGIC 0x4143414AL	/* "JACA" */
+#define ARRAY_CACHE_VERSION 2L
+
+typedef struct
+{
+	long magic;
+	long version;
+	long word_size;
+	long crc;
+	long file_length;
+	long entry_count;
+} ARRAY_CACHE_HEADER;
+
+typedef struct
+{
+	long position;		/* position of array data in Jam file */
+	long dimension;		/* number of elements in array */
+	long word_count;	/* number of data words */
+	long data_offset;	/* offset of data words from start of cache file */
+} ARRAY_CACHE_ENTRY;
+
+typedef struct ARRAY_CACHE_NEW_STRUCT
+{
+	struct ARRAY_CACHE_NEW_STRUCT *next;
+	ARRAY_CACHE_ENTRY entry;
+	long *data;
+} ARRAY_CACHE_NEW;
+
+char *array_cache_name = NULL;
+char *array_cache_map = NULL;
+long array_cache_map_size = 0L;
+long array_cache_crc = 0L;
+ARRAY_CACHE_HEADER *array_cache_header = NULL;
+ARRAY_CACHE_ENTRY *array_cache_table = NULL;
+ARRAY_CACHE_NEW *array_cache_new = NULL;
+long array_cache_new_count = 0L;
+
+void use_array_cache_map(char *source);
+
+void open_array_cache(unsigned short crc)
+{
+	int fd = -1;
+	struct stat cache_stat;
+
+	array_cache_crc = (long) crc;
+
+	if ((fd = open(array_cache_name, O_RDONLY)) >= 0)
+	{
+		if ((fstat(fd, &cache_stat) == 0) &&
+			(cache_stat.st_size >= (off_t) sizeof(ARRAY_CACHE_HEADER)))
+		{
+			array_cache_map = (char *) mmap(NULL, (size_t) cache_stat.st_size,
+				PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if (array_cache_map == (char *) MAP_FAILED)
+			{
+				array_cache_map = NULL;
+			}
+			else
+			{
+				array_cache_map_size = (long) cache_stat.st_size;
+			}
+		}
+
+		close(fd);
+	}
+
+	use_array_cache_map(array_cache_name);
+}
+
+void use_array_cache_map(char *source)
+{
+	ARRAY_CACHE_HEADER *header = NULL;
+
+	if (array_cache_map != NULL)
+	{
+		header = (ARRAY_CACHE_HEADER *) array_cache_map;
+
+		if ((header->magic == ARRAY_CACHE_MAGIC) &&
+			(header->version == ARRAY_CACHE_VERSION) &&
+			(header->word_size == (long) sizeof(long)) &&
+			(header->crc == array_cache_crc) &&
+			(header->file_length == file_length) &&
+			(header->entry_count >= 0L) &&
+			(header->entry_count <= (long) ((array_cache_map_size -
+				sizeof(ARRAY_CACHE_HEADER)) / sizeof(ARRAY_CACHE_ENTRY))))
+		{
+			array_cache_header = header;
+			array_cache_table = (ARRAY_CACHE_ENTRY *)
+				(array_cache_map + sizeof(ARRAY_CACHE_HEADER));
+
+			if (verbose)
+			{
+				printf("Array cache: %ld arrays in \"%s\"\n",
+					header->entry_count, source);
+			}
+		}
+	}
+}
+
+ARRAY_CACHE_ENTRY *find_array_cache_entry(long position)
+{
+	long low = 0L;
+	long high = 0L;
+	long mid = 0L;
+	ARRAY_CACHE_ENTRY *entry = NULL;
+
+	if (array_cache_header != NULL)
+	{
+		high = array_cache_header->entry_count - 1L;
+
+		while ((entry == NULL) && (low <= high))
+		{
+			mid = (low + high) / 2L;
+
+			if (array_cache_table[mid].position < position) low = mid + 1L;
+			else if (array_cache_table[mid].position > position) high = mid - 1L;
+			else entry = &array_cache_table[mid];
+		}
+	}
+
+	return (entry);
+}
+
+BOOL valid_array_cache_entry(ARRAY_CACHE_ENTRY *entry)
+{
+	return ((entry != NULL) &&
+		(entry->word_count >= 0L) &&
+		(entry->data_offset >= (long) sizeof(ARRAY_CACHE_HEADER)) &&
+		((entry->data_offset % (long) sizeof(long)) == 0L) &&
+		(entry->data_offset <= array_cache_map_size) &&
+		(entry->word_count <= ((array_cache_map_size - entry->data_offset) /
+			(long) sizeof(long))));
+}
+
+int jam_read_array_cache
+(
+	long position,
+	long dimension,
+	long *data,
+	long word_count
+)
+{
+	int return_code = EOF;
+	ARRAY_CACHE_ENTRY *entry = find_array_cache_entry(position);
+
+	if (valid_array_cache_entry(entry) &&
+		(entry->dimension == dimension) &&
+		(entry->word_count == word_count))
+	{
+		memcpy(data, array_cache_map + entry->data_offset,
+			(size_t) word_count * sizeof(long));
+		return_code = 0;
+	}
+
+	return (return_code);
+}
+
+void jam_write_array_cache
+(
+	long position,
+	long dimension,
+	long *data,
+	long word_count
+)
+{
+	ARRAY_CACHE_NEW *record = NULL;
+	BOOL found = FALSE;
+
+	for (record = array_cache_new; record != NULL; record = record->next)
+	{
+		if (record->entry.position == position) found = TRUE;
+	}
+
+	if ((array_cache_name != NULL) && !found)
+	{
+		record = (ARRAY_CACHE_NEW *) jam_malloc(sizeof(ARRAY_CACHE_NEW));
+
+		if (record != NULL)
+		{
+			record->data = (long *)
+				jam_malloc((unsigned int) (word_count * sizeof(long)));
+
+			if (record->data == NULL)
+			{
+				jam_free(record);
+				record = NULL;
+			}
+		}
+
+		if (record != NULL)
+		{
+			record->entry.position = position;
+			record->entry.dimension = dimension;
+			record->entry.word_count = word_count;
+			record->entry.data_offset = 0L;
+			memcpy(record->data, data, (size_t) word_count * sizeof(long));
+			record->next = array_cache_new;
+			array_cache_new = record;
+			++array_cache_new_count;
+		}
+	}
+}
+
+int compare_array_cache_records(const void *a, const void *b)
+{
+	long pa = ((ARRAY_CACHE_NEW *) a)->entry.position;
+	long pb = ((ARRAY_CACHE_NEW *) b)->entry.position;
+
+	return ((pa < pb) ? -1 : ((pa > pb) ? 1 : 0));
+}
+
+void close_array_cache(void)
+{
+	ARRAY_CACHE_HEADER header;
+	ARRAY_CACHE_NEW *records = NULL;
+	ARRAY_CACHE_NEW *record = NULL;
+	ARRAY_CACHE_ENTRY *entry = NULL;
+	char *temp_name = NULL;
+	FILE *cache_fp = NULL;
+	long old_count = 0L;
+	long count = 0L;
+	long offset = 0L;
+	long i = 0L;
+	BOOL superseded = FALSE;
+	BOOL ok = TRUE;
+
+	if (array_cache_new_count > 0L)
+	{
+		if (array_cache_header != NULL)
+		{
+			old_count = array_cache_header->entry_count;
+		}
+
+		records = (ARRAY_CACHE_NEW *) jam_malloc((unsigned int)
+			((old_count + array_cache_new_count) * sizeof(ARRAY_CACHE_NEW)));
+		temp_name = (char *) jam_malloc((unsigned int)
+			(strlen(array_cache_name) + 5));
+		ok = (records != NULL) && (temp_name != NULL);
+
+		/* keep the old entries which were not replaced by new ones */
+		for (i = 0L; ok && (i < old_count); ++i)
+		{
+			entry = &array_cache_table[i];
+			superseded = FALSE;
+
+			for (record = array_cache_new; record != NULL;
+				record = record->next)
+			{
+				if (record->entry.position == entry->position)
+				{
+					superseded = TRUE;
+				}
+			}
+
+			if (valid_array_cache_entry(entry) && !superseded)
+			{
+				records[count].entry = *entry;
+				records[count].data =
+					(long *) (array_cache_map + entry->data_offset);
+				++count;
+			}
+		}
+
+		for (record = array_cache_new; ok && (record != NULL);
+			record = record->next)
+		{
+			records[count++] = *record;
+		}
+
+		if (ok)
+		{
+			qsort(records, (size_t) count, sizeof(ARRAY_CACHE_NEW),
+				compare_array_cache_records);
+
+			/* write to a temporary file, then replace the old cache */
+			sprintf(temp_name, "%s.tmp", array_cache_name);
+			ok = ((cache_fp = fopen(temp_name, "wb")) != NULL);
+		}
+
+		if (ok)
+		{
+			header.magic = ARRAY_CACHE_MAGIC;
+			header.version = ARRAY_CACHE_VERSION;
+			header.word_size = (long) sizeof(long);
+			header.crc = array_cache_crc;
+			header.file_length = file_length;
+			header.entry_count = count;
+			ok = (fwrite(&header, sizeof(header), 1, cache_fp) == 1);
+
+			offset = (long) (sizeof(ARRAY_CACHE_HEADER) +
+				(count * sizeof(ARRAY_CACHE_ENTRY)));
+
+			for (i = 0L; ok && (i < count); ++i)
+			{
+				records[i].entry.data_offset = offset;
+				ok = (fwrite(&records[i].entry, sizeof(ARRAY_CACHE_ENTRY), 1,
+					cache_fp) == 1);
+				offset += records[i].entry.word_count * (long) sizeof(long);
+			}
+
+			for (i = 0L; ok && (i < count); ++i)
+			{
+				ok = (fwrite(records[i].data, sizeof(long),
+					(size_t) records[i].entry.word_count, cache_fp) ==
+					(size_t) records[i].entry.word_count);
+			}
+
+			if (fclose(cache_fp) != 0) ok = FALSE;
+			if (ok) ok = (rename(temp_name, array_cache_name) == 0);
+			if (!ok) remove(temp_name);
+		}
+
+		if (!ok && verbose)
+		{
+			fprintf(stderr, "Warning: can't write array cache file \"%s\"\n",
+				array_cache_name);
+		}
+
+		if (records != NULL) jam_free(records);
+		if (temp_name != NULL) jam_free(temp_name);
+	}
+
+	while (array_cache_new != NULL)
+	{
+		record = array_cache_new;
+		array_cache_new = record->next;
+		jam_free(record->data);
+		jam_free(record);
+	}
+	array_cache_new_count = 0L;
+
+	if (array_cache_map != NULL)
+	{
+		/* without a cache file, the map is part of a program image */
+		if (array_cache_name != NULL)
+		{
+			munmap(array_cache_map, (size_t) array_cache_map_size);
+		}
+
+		array_cache_map = NULL;
+		array_cache_header = NULL;
+		array_cache_table = NULL;
+	}
+}
+
+/************************************************************************
+*
+*	Compiled program images
+*
+*	"jam --compile <filename> <image>" writes a program image, which
+*	holds the Jam file together with the results of the work done on it
+*	before it runs: its CRC, the position of each line, its NOTE fields
+*	and, if a cache file is given with -c, its decoded array data.  The
+*	player knows an image by its header and uses these results as they
+*	are, except for the CRC, which is computed again (in the background
+*	with -b) and must match the one the image was compiled with.  The
+*	program itself is still interpreted statement by statement, as the
+*	player has no other form of it.  Like the array cache, an image is
+*	in the native word size and byte order of the host, and an image for
+*	another kind of host is rejected rather than read as Jam text.
+*/
+
+#define PROGRAM_IMAGE_MAGIC 0x4950414AL	/* "JAPI" */
+#define PROGRAM_IMAGE_VERSION 1L
+
+typedef struct
+{
+	long magic;
+	long version;
+	long word_size;
+	long crc_result;
+	long expected_crc;
+	long actual_crc;
+	long program_offset;	/* text of the Jam file */
+	long program_length;
+	long line_offset;		/* position where each line begins */
+	long line_count;
+	long note_offset;		/* NOTE keys and values, each ending in a null */
+	long note_length;
+	long array_offset;		/* decoded arrays, laid out as an array cache */
+	long array_length;
+} PROGRAM_IMAGE_HEADER;
+
+PROGRAM_IMAGE_HEADER *program_image = NULL;
+char *program_image_buffer = NULL;
+long program_image_length = 0L;
+
+void report_crc(JAM_RETURN_TYPE crc_result,
+	unsigned short expected_crc, unsigned short actual_crc);
+void print_json_note(char *key, char *value);
+
+BOOL valid_image_section(long offset, long length, long image_length)
+{
+	return ((offset >= (long) sizeof(PROGRAM_IMAGE_HEADER)) &&
+		((offset % (long) sizeof(long)) == 0L) &&
+		(offset <= image_length) &&
+		(length >= 0L) &&
+		(length <= image_length - offset));
+}
+
+BOOL has_image_magic(char *buffer, long length)
+{
+	/* the magic number as the first long of a little-endian host, a */
+	/* 32-bit big-endian host or a 64-bit big-endian host */
+	return (((length >= 4L) &&
+		((memcmp(buffer, "JAPI", 4) == 0) ||
+		(memcmp(buffer, "IPAJ", 4) == 0))) ||
+		((length >= 8L) &&
+		(memcmp(buffer, "\0\0\0\0IAPJ", 8) == 0)));
+}
+
+/* the Jam text in a buffer holding a Jam file or a program image */
+char *image_program_text(char *buffer, long length, long *text_length)
+{
+	PROGRAM_IMAGE_HEADER *header = (PROGRAM_IMAGE_HEADER *) buffer;
+	char *text = buffer;
+
+	*text_length = length;
+
+	/* an image which is not valid is rejected when it is loaded */
+	if (has_image_magic(buffer, length) &&
+		(length >= (long) sizeof(PROGRAM_IMAGE_HEADER)) &&
+		valid_image_section(header->program_offset,
+			header->program_length, length))
+	{
+		text = buffer + header->program_offset;
+		*text_length = header->program_length;
+	}
+
+	return (text);
+}
+
+BOOL load_program_image(void)
+{
+	PROGRAM_IMAGE_HEADER *header = (PROGRAM_IMAGE_HEADER *) file_buffer;
+	BOOL valid = TRUE;
+
+	if (has_image_magic(file_buffer, file_length))
+	{
+		program_image_buffer = file_buffer;
+		program_image_length = file_length;
+
+		valid = ((file_length >= (long) sizeof(PROGRAM_IMAGE_HEADER)) &&
+			(header->magic == PROGRAM_IMAGE_MAGIC) &&
+			(header->version == PROGRAM_IMAGE_VERSION) &&
+			(header->word_size == (long) sizeof(long)) &&
+			(header->line_count > 0L) &&
+			(header->line_count <= file_length / (long) sizeof(long)) &&
+			valid_image_section(header->program_offset,
+				header->program_length,
+				program_image_length) &&
+			valid_image_section(header->line_offset,
+				header->line_count * (long) sizeof(long),
+				program_image_length) &&
+			valid_image_section(header->note_offset,
+				header->note_length,
+				program_image_length) &&
+			valid_image_section(header->array_offset,
+				header->array_length,
+				program_image_length) &&
+			((header->note_length == 0L) || (program_image_buffer[
+				header->note_offset + header->note_length - 1L] == '\0')));
+
+		if (valid)
+		{
+			program_image = header;
+			file_buffer = program_image_buffer + header->program_offset;
+			file_length = header->program_length;
+
+			jam_set_line_table((long *) (program_image_buffer +
+				header->line_offset), header->line_count);
+		}
+	}
+
+	return (valid);
+}
+
+JAM_RETURN_TYPE check_image_crc(JAM_RETURN_TYPE crc_result,
+	unsigned short *expected_crc, unsigned short actual_crc)
+{
+	/* the CRC the program had when the image was compiled */
+	unsigned short compiled_crc = (unsigned short)
+		((program_image->crc_result == (long) JAMC_SUCCESS) ?
+		program_image->expected_crc : program_image->actual_crc);
+
+	if (actual_crc != compiled_crc)
+	{
+		*expected_crc = compiled_crc;
+		crc_result = JAMC_CRC_ERROR;
+	}
+
+	return (crc_result);
+}
+
+void print_image_notes(void)
+{
+	char *note = program_image_buffer + program_image->note_offset;
+	char *end = note + program_image->note_length;
+	char *value = NULL;
+
+	while ((note < end) && ((value = note + strlen(note) + 1) < end))
+	{
+		if (json_output) print_json_note(note, value);
+		else printf("NOTE \"%s\" = \"%s\"\n", note, value);
+		note = value + strlen(value) + 1;
+	}
+}
+
+void open_image_array_cache(void)
+{
+	if (program_image->array_length > 0L)
+	{
+		array_cache_crc = program_image->actual_crc;
+		array_cache_map = program_image_buffer + program_image->array_offset;
+		array_cache_map_size = program_image->array_length;
+		use_array_cache_map("program image");
+	}
+}
+
+long write_image_section(FILE *image_fp, char *data, long length)
+{
+	long offset = ftell(image_fp);
+
+	/* sections start on a word boundary */
+	while ((offset >= 0L) && ((offset % (long) sizeof(long)) != 0L))
+	{
+		offset = (fputc(0, image_fp) == EOF) ? -1L : (offset + 1L);
+	}
+
+	if ((offset >= 0L) && (length > 0L) &&
+		(fwrite(data, 1, (size_t) length, image_fp) != (size_t) length))
+	{
+		offset = -1L;
+	}
+
+	return (offset);
+}
+
+BOOL compile_program_image(char *image_name)
+{
+	PROGRAM_IMAGE_HEADER header;
+	JAM_RETURN_TYPE crc_result = JAMC_SUCCESS;
+	unsigned short expected_crc = 0;
+	unsigned short actual_crc = 0;
+	char key[33] = {0};
+	char value[257] = {0};
+	long *line_table = NULL;
+	char *notes = NULL;
+	long note_length = 0L;
+	long line_count = 1L;
+	long position = 0L;
+	long offset = 0L;
+	FILE *image_fp = NULL;
+	BOOL ok = TRUE;
+
+	memset(&header, 0, sizeof(header));
+
+	if (program_image != NULL)
+	{
+		fprintf(stderr, "Error: file is already a program image\n");
+		ok = FALSE;
+	}
+
+	if (ok)
+	{
+		crc_result = jam_check_crc(file_buffer, file_length,
+			&expected_crc, &actual_crc);
+		report_crc(crc_result, expected_crc, actual_crc);
+
+		if (crc_result == JAMC_CRC_ERROR)
+		{
+			fprintf(stderr, "Error: CRC mismatch, image not written\n");
+			ok = FALSE;
+		}
+	}
+
+	/*
+	*	Find where each line begins
+	*/
+	for (position = 0L; ok && (position < file_length); ++position)
+	{
+		if (file_buffer[position] == '\n') ++line_count;
+	}
+
+	if (ok)
+	{
+		line_table = (long *) jam_malloc(
+			(unsigned int) (line_count * sizeof(long)));
+		ok = (line_table != NULL);
+	}
+
+	if (ok)
+	{
+		line_table[0] = 0L;
+		line_count = 1L;
+
+		for (position = 0L; position < file_length; ++position)
+		{
+			if (file_buffer[position] == '\n')
+			{
+				line_table[line_count++] = position + 1L;
+			}
+		}
+	}
+
+	/*
+	*	Collect the NOTE fields
+	*/
+	while (ok && (jam_get_note(file_buffer, file_length,
+		&offset, key, value, 256) == 0))
+	{
+		note_length += (long) (strlen(key) + strlen(value) + 2);
+	}
+
+	if (ok && (note_length > 0L))
+	{
+		notes = (char *) jam_malloc((unsigned int) note_length);
+		ok = (notes != NULL);
+		note_length = 0L;
+		offset = 0L;
+
+		while (ok && (jam_get_note(file_buffer, file_length,
+			&offset, key, value, 256) == 0))
+		{
+			strcpy(&notes[note_length], key);
+			note_length += (long) (strlen(key) + 1);
+			strcpy(&notes[note_length], value);
+			note_length += (long) (strlen(value) + 1);
+		}
+	}
+
+	/*
+	*	Take the decoded arrays from the cache file, if it matches
+	*/
+	if (ok && (array_cache_name != NULL))
+	{
+		open_array_cache(actual_crc);
+	}
+
+	if (ok)
+	{
+		ok = ((image_fp = fopen(image_name, "wb")) != NULL);
+
+		if (ok)
+		{
+			ok = (fwrite(&header, sizeof(header), 1, image_fp) == 1);
+
+			header.magic = PROGRAM_IMAGE_MAGIC;
+			header.version = PROGRAM_IMAGE_VERSION;
+			header.word_size = (long) sizeof(long);
+			header.crc_result = (long) crc_result;
+			header.expected_crc = (long) expected_crc;
+			header.actual_crc = (long) actual_crc;
+			header.program_length = file_length;
+			header.line_count = line_count;
+			header.note_length = note_length;
+			header.array_length = (array_cache_header == NULL) ?
+				0L : array_cache_map_size;
+		}
+
+		if (ok)
+		{
+			header.program_offset = write_image_section(image_fp,
+				file_buffer, header.program_length);
+			header.line_offset = write_image_section(image_fp,
+				(char *) line_table, line_count * (long) sizeof(long));
+			header.note_offset = write_image_section(image_fp,
+				notes, note_length);
+			header.array_offset = write_image_section(image_fp,
+				array_cache_map, header.array_length);
+
+			ok = (header.program_offset >= 0L) && (header.line_offset >= 0L) &&
+				(header.note_offset >= 0L) && (header.array_offset >= 0L) &&
+				(fseek(image_fp, 0L, SEEK_SET) == 0) &&
+				(fwrite(&header, sizeof(header), 1, image_fp) == 1);
+		}
+
+		if ((image_fp != NULL) && (fclose(image_fp) != 0)) ok = FALSE;
+
+		if (!ok)
+		{
+			fprintf(stderr, "Error: can't write program image \"%s\"\n",
+				image_name);
+			if (image_fp != NULL) remove(image_name);
+		}
+		else if (verbose)
+		{
+			printf("Program image: %ld lines, %ld bytes of NOTE fields, %ld bytes of arrays\n",
+				line_count, note_length, header.array_length);
+		}
+	}
+
+	close_array_cache();
+	if (line_table != NULL) jam_free(line_table);
+	if (notes != NULL) jam_free(notes);
+
+	return (ok);
+}
+
+/************************************************************************
+*
+*	Background work
+*
+*	With the -t option, the interpreter may hand work such as decoding
+*	large arrays to a worker thread, so that it overlaps with JTAG I/O
+*	on hosts with more than one core.  The -b option also uses it to
+*	check the CRC while the program starts.  Work is done one job at a
+*	time, in the order it was started.  jam_finish_work() waits for a
+*	job to finish and returns its result.  jam_cancel_work() takes a job
+*	off the queue if the worker has not started it, and otherwise waits
+*	for it to finish.
+*/
+
+typedef struct WORK_STRUCT
+{
+	struct WORK_STRUCT *next;
+	int (*function)(void *);
+	void *argument;
+	int result;
+	BOOL done;
+} WORK;
+
+BOOL work_enabled = FALSE;
+BOOL work_thread_running = FALSE;
+BOOL work_stop = FALSE;
+pthread_t work_thread;
+pthread_mutex_t work_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+WORK *work_head = NULL;
+WORK *work_tail = NULL;
+
+void *work_thread_main(void *unused)
+{
+	WORK *work = NULL;
+	int result = 0;
+
+	pthread_mutex_lock(&work_mutex);
+
+	while (!work_stop || (work_head != NULL))
+	{
+		if (work_head == NULL)
+		{
+			pthread_cond_wait(&work_cond, &work_mutex);
+		}
+		else
+		{
+			work = work_head;
+			work_head = work->next;
+			if (work_head == NULL) work_tail = NULL;
+
+			pthread_mutex_unlock(&work_mutex);
+			result = work->function(work->argument);
+			pthread_mutex_lock(&work_mutex);
+
+			work->result = result;
+			work->done = TRUE;
+			pthread_cond_broadcast(&work_cond);
+		}
+	}
+
+	pthread_mutex_unlock(&work_mutex);
+
+	return (NULL);
+}
+
+void *jam_start_work(int (*function)(void *), void *argument)
+{
+	WORK *work = NULL;
+
+	if (work_enabled)
+	{
+		work = (WORK *) jam_malloc(sizeof(WORK));
+	}
+
+	if (work != NULL)
+	{
+		work->next = NULL;
+		work->function = function;
+		work->argument = argument;
+		work->result = 0;
+		work->done = FALSE;
+
+		pthread_mutex_lock(&work_mutex);
+
+		if (!work_thread_running)
+		{
+			work_stop = FALSE;
+			work_thread_running = (pthread_create(&work_thread, NULL,
+				work_thread_main, NULL) == 0);
+		}
+
+		if (work_thread_running)
+		{
+			if (work_tail == NULL) work_head = work;
+			else work_tail->next = work;
+			work_tail = work;
+			pthread_cond_broadcast(&work_cond);
+		}
+
+		pthread_mutex_unlock(&work_mutex);
+
+		if (!work_thread_running)
+		{
+			/* no thread -- the caller will do the work itself */
+			jam_free(work);
+			work = NULL;
+		}
+	}
+
+	return ((void *) work);
+}
+
+int jam_finish_work(void *handle)
+{
+	WORK *work = (WORK *) handle;
+	int result = 0;
+
+	pthread_mutex_lock(&work_mutex);
+
+	while (!work->done)
+	{
+		pthread_cond_wait(&work_cond, &work_mutex);
+	}
+
+	result = work->result;
+
+	pthread_mutex_unlock(&work_mutex);
+
+	jam_free(work);
+
+	return (result);
+}
+
+/* returns TRUE if the job was taken off the queue before it started */
+int jam_cancel_work(void *handle)
+{
+	WORK *work = (WORK *) handle;
+	WORK *previous = NULL;
+	WORK *queued = NULL;
+	BOOL cancelled = FALSE;
+
+	pthread_mutex_lock(&work_mutex);
+
+	for (queued = work_head; (queued != NULL) && !cancelled;
+		queued = queued->next)
+	{
+		if (queued == work)
+		{
+			if (previous == NULL) work_head = work->next;
+			else previous->next = work->next;
+			if (work_tail == work) work_tail = previous;
+			cancelled = TRUE;
+		}
+		previous = queued;
+	}
+
+	while (!cancelled && !work->done)
+	{
+		pthread_cond_wait(&work_cond, &work_mutex);
+	}
+
+	pthread_mutex_unlock(&work_mutex);
+
+	jam_free(work);
+
+	return (cancelled);
+}
+
+void stop_work_thread(void)
+{
+	if (work_thread_running)
+	{
+		pthread_mutex_lock(&work_mutex);
+		work_stop = TRUE;
+		pthread_cond_broadcast(&work_cond);
+		pthread_mutex_unlock(&work_mutex);
+
+		pthread_join(work_thread, NULL);
+		work_thread_running = FALSE;
+	}
+}
+
+/************************************************************************
+*
+*	Execution profile
+*
+*	With -e, the time between one event and the next is charged to the
+*	statement which is running (by source line, statement type and the
+*	procedure or data block it is in) and to the kind of work being done
+*	(reading statements, decoding arrays, executing them, JTAG I/O or
+*	delays).  Events are the start of each statement, reported by the
+*	interpreter, and each change in the kind of work.  Time is measured
+*	on the monotonic clock, and each call to jam_jtag_io() counts as one
+*	TCK cycle.  The time spent reading a statement is charged to the one
+*	before it.  After the run a report sorted by time is printed, and
+*	with -e<file> the figures are also written to the file, one record
+*	per line with tab-separated fields.
+*/
+
+#define PROFILE_TOP_LINES 20
+#define PROFILE_TYPE_COUNT 48
+
+typedef struct
+{
+	char *name;			/* statement type or procedure name */
+	long line;			/* line number, for lines */
+	int type;			/* last statement type seen, for lines */
+	int block;			/* last procedure seen, for lines */
+	long count;			/* number of statements started */
+	long tck_count;
+	double time;		/* seconds */
+} PROFILE_ENTRY;
+
+char *profile_file_name = NULL;
+char *profile_phase_names[JAMC_PROFILE_COUNT] =
+{
+	"executing statements",
+	"reading statements",
+	"decoding arrays",
+	"JTAG I/O",
+	"delays"
+};
+double profile_phase_time[JAMC_PROFILE_COUNT];
+int profile_phase = JAMC_PROFILE_EXECUTE;
+double profile_last_time = 0.0;
+long profile_start_tck_count = 0L;
+long profile_last_tck_count = 0L;
+
+/* time spent decoding arrays, measured for --json without -e */
+double decode_time = 0.0;
+double decode_start_time = 0.0;
+long profile_statement_count = 0L;
+
+/* entry 0 of each table is for time before the first statement */
+PROFILE_ENTRY *profile_lines = NULL;
+long profile_line_count = 0L;
+long profile_line = 0L;
+PROFILE_ENTRY profile_types[PROFILE_TYPE_COUNT];
+int profile_type_count = 0;
+int profile_type = 0;
+PROFILE_ENTRY *profile_blocks = NULL;
+int profile_block_count = 0;
+int profile_block = 0;
+char *profile_block_name = NULL;	/* name passed in for profile_block */
+
+double profile_clock(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return ((double) now.tv_sec + ((double) now.tv_nsec * 1e-9));
+}
+
+void profile_charge(void)
+{
+	double now = profile_clock();
+	double time = now - profile_last_time;
+	long tck_delta = counters.tck_count - profile_last_tck_count;
+
+	profile_phase_time[profile_phase] += time;
+	profile_lines[profile_line].time += time;
+	profile_lines[profile_line].tck_count += tck_delta;
+	profile_types[profile_type].time += time;
+	profile_types[profile_type].tck_count += tck_delta;
+	profile_blocks[profile_block].time += time;
+	profile_blocks[profile_block].tck_count += tck_delta;
+
+	profile_last_time = now;
+	profile_last_tck_count = counters.tck_count;
+}
+
+BOOL start_profile(void)
+{
+	int phase = 0;
+
+	profile_line_count = 1024L;
+	profile_lines = (PROFILE_ENTRY *) calloc((size_t) profile_line_count,
+		sizeof(PROFILE_ENTRY));
+	profile_blocks = (PROFILE_ENTRY *) calloc(1, sizeof(PROFILE_ENTRY));
+	memset(profile_types, 0, sizeof(profile_types));
+
+	for (phase = 0; phase < JAMC_PROFILE_COUNT; ++phase)
+	{
+		profile_phase_time[phase] = 0.0;
+	}
+
+	profiling = (profile_lines != NULL) && (profile_blocks != NULL);
+
+	if (profiling)
+	{
+		profile_types[0].name = "(start)";
+		profile_type_count = 1;
+		profile_blocks[0].name = "(none)";
+		profile_block_count = 1;
+		profile_phase = JAMC_PROFILE_EXECUTE;
+		profile_line = 0L;
+		profile_type = 0;
+		profile_block = 0;
+		profile_block_name = NULL;
+		profile_statement_count = 0L;
+		profile_start_tck_count = counters.tck_count;
+		profile_last_tck_count = counters.tck_count;
+		profile_last_time = profile_clock();
+		jam_set_profiling(JAMC_PROFILING_STATEMENTS);
+	}
+	else
+	{
+		fprintf(stderr, "Warning: not enough memory to profile execution\n");
+	}
+
+	return (profiling);
+}
+
+int jam_profile_phase(int phase)
+{
+	int previous = profile_phase;
+
+	if (profiling)
+	{
+		profile_charge();
+	}
+	else if ((phase == JAMC_PROFILE_DECODE) &&
+		(previous != JAMC_PROFILE_DECODE))
+	{
+		decode_start_time = profile_clock();
+	}
+	else if ((previous == JAMC_PROFILE_DECODE) &&
+		(phase != JAMC_PROFILE_DECODE))
+	{
+		decode_time += profile_clock() - decode_start_time;
+	}
+
+	profile_phase = phase;
+
+	return (previous);
+}
+
+void jam_profile_statement(long line, char *instruction, char *block)
+{
+	PROFILE_ENTRY *table = NULL;
+	long count = profile_line_count;
+	int index = 0;
+
+	if (profiling)
+	{
+		profile_charge();
+
+		/*
+		*	Find the line, growing the table if needed
+		*/
+		while ((line >= count) && (count > 0L)) count *= 2L;
+
+		if ((line >= profile_line_count) && (count > profile_line_count))
+		{
+			table = (PROFILE_ENTRY *) realloc(profile_lines,
+				(size_t) count * sizeof(PROFILE_ENTRY));
+
+			if (table != NULL)
+			{
+				memset(&table[profile_line_count], 0, (size_t)
+					(count - profile_line_count) * sizeof(PROFILE_ENTRY));
+				profile_lines = table;
+				profile_line_count = count;
+			}
+		}
+
+		profile_line = ((line > 0L) && (line < profile_line_count)) ?
+			line : 0L;
+
+		/*
+		*	Find the statement type; instruction names are constants
+		*/
+		if (instruction == NULL) instruction = "(assignment)";
+
+		profile_type = -1;
+		for (index = 0; (profile_type < 0) && (index < profile_type_count);
+			++index)
+		{
+			if (profile_types[index].name == instruction) profile_type = index;
+		}
+
+		if ((profile_type < 0) && (profile_type_count < PROFILE_TYPE_COUNT))
+		{
+			profile_type = profile_type_count++;
+			profile_types[profile_type].name = instruction;
+		}
+
+		if (profile_type < 0) profile_type = 0;
+
+		/*
+		*	Find the procedure, keeping a copy of its name, as the
+		*	symbol table is gone by the time the report is printed
+		*/
+		if (block != profile_block_name)
+		{
+			profile_block = -1;
+			profile_block_name = block;
+			if (block == NULL) profile_block = 0;
+
+			for (index = 1; (profile_block < 0) &&
+				(index < profile_block_count); ++index)
+			{
+				if (strcmp(profile_blocks[index].name, block) == 0)
+				{
+					profile_block = index;
+				}
+			}
+
+			table = (profile_block < 0) ? (PROFILE_ENTRY *) realloc(
+				profile_blocks, (size_t) (profile_block_count + 1) *
+				sizeof(PROFILE_ENTRY)) : NULL;
+
+			if (table != NULL)
+			{
+				profile_blocks = table;
+				profile_block = profile_block_count++;
+				memset(&profile_blocks[profile_block], 0, sizeof(PROFILE_ENTRY));
+				profile_blocks[profile_block].name = strdup(block);
+			}
+
+			if ((profile_block < 0) ||
+				(profile_blocks[profile_block].name == NULL))
+			{
+				profile_block = 0;
+			}
+		}
+
+		profile_lines[profile_line].line = profile_line;
+		profile_lines[profile_line].type = profile_type;
+		profile_lines[profile_line].block = profile_block;
+		++profile_lines[profile_line].count;
+		++profile_types[profile_type].count;
+		++profile_blocks[profile_block].count;
+		++profile_statement_count;
+	}
+}
+
+int compare_profile_entries(const void *a, const void *b)
+{
+	PROFILE_ENTRY *pa = *((PROFILE_ENTRY **) a);
+	PROFILE_ENTRY *pb = *((PROFILE_ENTRY **) b);
+	BOOL used_a = (pa->count > 0L) || (pa->time > 0.0);
+	BOOL used_b = (pb->count > 0L) || (pb->time > 0.0);
+	int result = 0;
+
+	/* entries never used go last */
+	if (used_a && !used_b) result = -1;
+	else if (used_b && !used_a) result = 1;
+	else if (pa->time > pb->time) result = -1;
+	else if (pa->time < pb->time) result = 1;
+	else if (pa->line < pb->line) result = -1;
+	else if (pa->line > pb->line) result = 1;
+
+	return (result);
+}
+
+/* sorts a table by time, returning an array of pointers to its entries */
+PROFILE_ENTRY **sort_profile_entries(PROFILE_ENTRY *table, long count)
+{
+	PROFILE_ENTRY **sorted = NULL;
+	long index = 0L;
+
+	sorted = (PROFILE_ENTRY **) malloc((size_t) (count + 1L) *
+		sizeof(PROFILE_ENTRY *));
+
+	if (sorted != NULL)
+	{
+		for (index = 0L; index < count; ++index)
+		{
+			sorted[index] = &table[index];
+		}
+
+		qsort(sorted, (size_t) count, sizeof(PROFILE_ENTRY *),
+			compare_profile_entries);
+	}
+
+	return (sorted);
+}
+
+void print_profile_entries(FILE *fp, char *kind, PROFILE_ENTRY **sorted,
+	long count, long limit, double total)
+{
+	long index = 0L;
+	PROFILE_ENTRY *entry = NULL;
+
+	for (index = 0L; (sorted != NULL) && (index < count) &&
+		(index < limit) && ((sorted[index]->count > 0L) ||
+		(sorted[index]->time > 0.0)); ++index)
+	{
+		entry = sorted[index];
+
+		if (fp != stdout)
+		{
+			fprintf(fp, "%s\t%s\t%ld\t%.9f\t%ld\n", kind, entry->name,
+				entry->count, entry->time, entry->tck_count);
+		}
+		else
+		{
+			printf("    %-28s %12.6f s %6.2f%% %10ld stmts %12ld TCK\n",
+				entry->name, entry->time,
+				(total > 0.0) ? (100.0 * entry->time / total) : 0.0,
+				entry->count, entry->tck_count);
+		}
+	}
+}
+
+void print_profile_lines(FILE *fp, PROFILE_ENTRY **sorted, long limit,
+	double total)
+{
+	long index = 0L;
+	PROFILE_ENTRY *entry = NULL;
+
+	for (index = 0L; (sorted != NULL) && (index < profile_line_count) &&
+		(index < limit) && ((sorted[index]->count > 0L) ||
+		(sorted[index]->time > 0.0)); ++index)
+	{
+		entry = sorted[index];
+
+		if (fp != stdout)
+		{
+			fprintf(fp, "line\t%ld\t%ld\t%.9f\t%ld\t%s\t%s\n", entry->line,
+				entry->count, entry->time, entry->tck_count,
+				profile_types[entry->type].name,
+				profile_blocks[entry->block].name);
+		}
+		else
+		{
+			printf("    line %-7ld %-12s %-28s %12.6f s %6.2f%% %10ld stmts %12ld TCK\n",
+				entry->line, profile_types[entry->type].name,
+				profile_blocks[entry->block].name, entry->time,
+				(total > 0.0) ? (100.0 * entry->time / total) : 0.0,
+				entry->count, entry->tck_count);
+		}
+	}
+}
+
+void finish_profile(void)
+{
+	PROFILE_ENTRY **lines = NULL;
+	PROFILE_ENTRY **types = NULL;
+	PROFILE_ENTRY **blocks = NULL;
+	FILE *fp = NULL;
+	double total = 0.0;
+	int phase = 0;
+	int index = 0;
+
+	if (profiling)
+	{
+		profile_charge();
+		jam_set_profiling(JAMC_PROFILING_OFF);
+		profiling = FALSE;
+		decode_time += profile_phase_time[JAMC_PROFILE_DECODE];
+
+		for (phase = 0; phase < JAMC_PROFILE_COUNT; ++phase)
+		{
+			total += profile_phase_time[phase];
+		}
+
+		lines = sort_profile_entries(profile_lines, profile_line_count);
+		types = sort_profile_entries(profile_types, (long) profile_type_count);
+		blocks = sort_profile_entries(profile_blocks, (long) profile_block_count);
+
+		/* with --json, only the profile file is written */
+		if (!json_output)
+		{
+			printf("Profile: %.6f s, %ld statements, %ld TCK\n", total,
+				profile_statement_count,
+				counters.tck_count - profile_start_tck_count);
+			printf("  Time by kind of work:\n");
+			for (phase = 0; phase < JAMC_PROFILE_COUNT; ++phase)
+			{
+				printf("    %-28s %12.6f s %6.2f%%\n", profile_phase_names[phase],
+					profile_phase_time[phase], (total > 0.0) ?
+					(100.0 * profile_phase_time[phase] / total) : 0.0);
+			}
+			printf("  Time by statement type:\n");
+			print_profile_entries(stdout, "type", types,
+				(long) profile_type_count, (long) profile_type_count, total);
+			printf("  Time by procedure:\n");
+			print_profile_entries(stdout, "procedure", blocks,
+				(long) profile_block_count, (long) profile_block_count, total);
+			printf("  Time by line (top %d):\n", PROFILE_TOP_LINES);
+			print_profile_lines(stdout, lines, (long) PROFILE_TOP_LINES, total);
+		}
+
+		if ((profile_file_name != NULL) && (*profile_file_name != '\0'))
+		{
+			if ((fp = fopen(profile_file_name, "w")) == NULL)
+			{
+				fprintf(stderr, "Warning: can't write profile file \"%s\"\n",
+					profile_file_name);
+			}
+			else
+			{
+				fprintf(fp, "total\t-\t%ld\t%.9f\t%ld\n",
+					profile_statement_count, total,
+					counters.tck_count - profile_start_tck_count);
+				for (phase = 0; phase < JAMC_PROFILE_COUNT; ++phase)
+				{
+					fprintf(fp, "work\t%s\t-\t%.9f\t-\n",
+						profile_phase_names[phase], profile_phase_time[phase]);
+				}
+				print_profile_entries(fp, "type", types,
+					(long) profile_type_count, (long) profile_type_count, total);
+				print_profile_entries(fp, "procedure", blocks,
+					(long) profile_block_count, (long) profile_block_count, total);
+				print_profile_lines(fp, lines, profile_line_count, total);
+				fclose(fp);
+			}
+		}
+
+		for (index = 1; index < profile_block_count; ++index)
+		{
+			free(profile_blocks[index].name);
+		}
+
+		free(lines);
+		free(types);
+		free(blocks);
+		free(profile_lines);
+		free(profile_blocks);
+		profile_lines = NULL;
+		profile_blocks = NULL;
+	}
+}
+
+/************************************************************************
+*
+*	JTAG trace
+*
+*	With -j<file>, every TCK cycle driven by jam_jtag_io() and every
+*	delay is written to a trace file, and "jam --replay <file>" drives
+*	the same cycles on the pins again without running the program,
+*	checking each TDO bit which was read against the one recorded.  This
+*	shows how long programming takes when it is limited only by the
+*	wires and the delays the device needs.  As the program is not run,
+*	a mismatch does not stop the replay; they are counted and reported.
+*	The whole trace is checked before the first cycle is driven, so a
+*	damaged file never leaves the chain part way through a sequence.
+*
+*	After a header in the native word size, the trace is a stream of
+*	records, each beginning with a byte giving its kind.  A run of
+*	cycles with the same TMS, which all read TDO or all don't, is one
+*	record: the kind byte holds TMS and the read flag, and the number of
+*	cycles follows as a variable-length number (seven bits per byte,
+*	least significant first, with the top bit set on all but the last
+*	byte).  Then come the TDI bits, eight to a byte starting with the
+*	least significant bit, unless they are all the same, when the kind
+*	byte holds their value instead, and then the TDO bits if they were
+*	read.  A delay is a record giving the time in microseconds, and the
+*	stream ends with an end record.
+*/
+
+#define JTAG_TRACE_MAGIC 0x5450414AL	/* "JAPT" */
+#define JTAG_TRACE_VERSION 1L
+
+#define TRACE_TMS 0x01
+#define TRACE_READ_TDO 0x02
+#define TRACE_TDI_CONSTANT 0x04
+#define TRACE_TDI_ONE 0x08
+#define TRACE_DELAY 0x10
+#define TRACE_END 0x20
+
+#define TRACE_RUN_BYTES 4096
+#define TRACE_RUN_CYCLES (TRACE_RUN_BYTES * 8L)
+#define TRACE_MISMATCHES_SHOWN 10
+
+typedef struct
+{
+	long magic;
+	long version;
+	long word_size;
+	long cycle_count;		/* TCK cycles */
+	long read_count;		/* cycles which read TDO */
+	long delay_count;
+	long delay_time;		/* microseconds */
+	long stream_length;		/* bytes of records after the header */
+} JTAG_TRACE_HEADER;
+
+char *trace_name = NULL;
+FILE *trace_fp = NULL;
+JTAG_TRACE_HEADER trace_header;
+BOOL trace_ok = TRUE;
+
+/* the run of cycles not yet written */
+int trace_run_tms = 0;
+int trace_run_read_tdo = 0;
+long trace_run_length = 0L;
+unsigned char trace_tdi_bits[TRACE_RUN_BYTES];
+unsigned char trace_tdo_bits[TRACE_RUN_BYTES];
+
+/* writes part of a trace or scan vector file, counting the bytes */
+void write_stream_bytes(FILE *fp, BOOL *ok, long *stream_length,
+	unsigned char *data, long length)
+{
+	if (*ok && (fwrite(data, 1, (size_t) length, fp) != (size_t) length))
+	{
+		*ok = FALSE;
+	}
+
+	*stream_length += length;
+}
+
+void write_stream_record(FILE *fp, BOOL *ok, long *stream_length,
+	int kind, long length)
+{
+	unsigned char bytes[11];	/* the kind and up to ten bytes of length */
+	long count = 0L;
+
+	bytes[count++] = (unsigned char) kind;
+
+	do
+	{
+		bytes[count] = (unsigned char) (length & 0x7fL);
+		length = (long) (((unsigned long) length) >> 7);
+		if (length != 0L) bytes[count] |= 0x80;
+		++count;
+	}
+	while (length != 0L);
+
+	write_stream_bytes(fp, ok, stream_length, bytes, count);
+}
+
+void flush_trace_run(void)
+{
+	long byte_count = (trace_run_length + 7L) / 8L;
+	long index = 0L;
+	int kind = (trace_run_tms ? TRACE_TMS : 0) |
+		(trace_run_read_tdo ? TRACE_READ_TDO : 0);
+	unsigned char first = (unsigned char) ((trace_tdi_bits[0] & 1) ? 0xff : 0);
+	unsigned char last = (unsigned char) (0xff >> (byte_count * 8L -
+		trace_run_length));
+	BOOL constant = TRUE;
+
+	if (trace_run_length > 0L)
+	{
+		for (index = 0L; constant && (index < byte_count); ++index)
+		{
+			constant = (((trace_tdi_bits[index] ^ first) &
+				((index == byte_count - 1L) ? last : 0xff)) == 0);
+		}
+
+		if (constant)
+		{
+			kind |= TRACE_TDI_CONSTANT | (first ? TRACE_TDI_ONE : 0);
+		}
+
+		write_stream_record(trace_fp, &trace_ok,
+			&trace_header.stream_length, kind, trace_run_length);
+		if (!constant)
+		{
+			write_stream_bytes(trace_fp, &trace_ok,
+				&trace_header.stream_length, trace_tdi_bits, byte_count);
+		}
+		if (trace_run_read_tdo)
+		{
+			write_stream_bytes(trace_fp, &trace_ok,
+				&trace_header.stream_length, trace_tdo_bits, byte_count);
+		}
+
+		memset(trace_tdi_bits, 0, (size_t) byte_count);
+		memset(trace_tdo_bits, 0, (size_t) byte_count);
+		trace_run_length = 0L;
+	}
+}
+
+void trace_jtag_cycle(int tms, int tdi, int read_tdo, int tdo)
+{
+	long byte = trace_run_length >> 3;
+	unsigned char bit = (unsigned char) (1 << (trace_run_length & 7L));
+
+	tms = !!tms;
+	read_tdo = !!read_tdo;
+
+	if ((trace_run_length > 0L) && ((tms != trace_run_tms) ||
+		(read_tdo != trace_run_read_tdo) ||
+		(trace_run_length == TRACE_RUN_CYCLES)))
+	{
+		flush_trace_run();
+		byte = 0L;
+		bit = 1;
+	}
+
+	trace_run_tms = tms;
+	trace_run_read_tdo = read_tdo;
+	if (tdi) trace_tdi_bits[byte] |= bit;
+	if (read_tdo && tdo) trace_tdo_bits[byte] |= bit;
+	++trace_run_length;
+
+	++trace_header.cycle_count;
+	if (read_tdo) ++trace_header.read_count;
+}
+
+void trace_delay(long microseconds)
+{
+	flush_trace_run();
+	write_stream_record(trace_fp, &trace_ok,
+		&trace_header.stream_length, TRACE_DELAY, microseconds);
+	++trace_header.delay_count;
+	trace_header.delay_time += microseconds;
+}
+
+BOOL start_jtag_trace(void)
+{
+	memset(&trace_header, 0, sizeof(trace_header));
+	memset(trace_tdi_bits, 0, sizeof(trace_tdi_bits));
+	memset(trace_tdo_bits, 0, sizeof(trace_tdo_bits));
+	trace_header.magic = JTAG_TRACE_MAGIC;
+	trace_header.version = JTAG_TRACE_VERSION;
+	trace_header.word_size = (long) sizeof(long);
+	trace_run_length = 0L;
+	trace_ok = TRUE;
+
+	/* the header is written again with the counts at the end */
+	if (((trace_fp = fopen(trace_name, "wb")) == NULL) ||
+		(fwrite(&trace_header, sizeof(trace_header), 1, trace_fp) != 1))
+	{
+		fprintf(stderr, "Error: can't write JTAG trace file \"%s\"\n",
+			trace_name);
+		if (trace_fp != NULL) fclose(trace_fp);
+		trace_fp = NULL;
+	}
+
+	tracing = (trace_fp != NULL);
+
+	return (tracing);
+}
+
+BOOL finish_jtag_trace(void)
+{
+	if (tracing)
+	{
+		tracing = FALSE;
+		flush_trace_run();
+		write_stream_record(trace_fp, &trace_ok,
+			&trace_header.stream_length, TRACE_END, 0L);
+
+		if (!trace_ok || (fseek(trace_fp, 0L, SEEK_SET) != 0) ||
+			(fwrite(&trace_header, sizeof(trace_header), 1, trace_fp) != 1))
+		{
+			trace_ok = FALSE;
+		}
+
+		if (fclose(trace_fp) != 0) trace_ok = FALSE;
+		trace_fp = NULL;
+
+		if (!trace_ok)
+		{
+			fprintf(stderr, "Error: can't write JTAG trace file \"%s\"\n",
+				trace_name);
+		}
+		else if (verbose)
+		{
+			printf("JTAG trace: %ld TCK cycles, %ld TDO bits, %ld delays, %ld bytes\n",
+				trace_header.cycle_count, trace_header.read_count,
+				trace_header.delay_count, trace_header.stream_length +
+				(long) sizeof(trace_header));
+		}
+	}
+
+	return (trace_ok);
+}
+
+/* reads the length of a record, returning -1 if the trace ends first */
+long read_trace_length(unsigned char **next, unsigned char *end)
+{
+	long length = 0L;
+	int shift = 0;
+	BOOL more = TRUE;
+
+	while (more && (*next < end) && (shift < 32))
+	{
+		length |= ((long) (**next & 0x7f)) << shift;
+		more = ((**next & 0x80) != 0);
+		shift += 7;
+		++(*next);
+	}
+
+	return ((more || (length < 0L)) ? -1L : length);
+}
+
+/* walks the whole trace, so that a bad one is found before any pins move */
+BOOL check_jtag_trace(JTAG_TRACE_HEADER *header, unsigned char *next,
+	unsigned char *end)
+{
+	long length = 0L;
+	long byte_count = 0L;
+	long data_length = 0L;
+	long cycle_count = 0L;
+	int kind = 0;
+	BOOL valid = TRUE;
+	BOOL done = FALSE;
+
+	while (valid && !done)
+	{
+		if (next < end)
+		{
+			kind = *next++;
+			length = read_trace_length(&next, end);
+		}
+		else
+		{
+			length = -1L;
+		}
+
+		if (length < 0L)
+		{
+			valid = FALSE;
+		}
+		else if (kind == TRACE_END)
+		{
+			done = TRUE;
+		}
+		else if ((kind & ~(TRACE_TMS | TRACE_READ_TDO |
+			TRACE_TDI_CONSTANT | TRACE_TDI_ONE)) != 0)
+		{
+			/* a delay has nothing after its length */
+			valid = (kind == TRACE_DELAY);
+		}
+		else
+		{
+			byte_count = (length + 7L) / 8L;
+			data_length = (((kind & TRACE_TDI_CONSTANT) ? 0L : byte_count) +
+				((kind & TRACE_READ_TDO) ? byte_count : 0L));
+			valid = (data_length <= (long) (end - next));
+			if (valid) next += data_length;
+			cycle_count += length;
+		}
+	}
+
+	return (valid && (cycle_count == header->cycle_count));
+}
+
+BOOL replay_jtag_trace(char *name)
+{
+	JTAG_TRACE_HEADER *header = NULL;
+	char *buffer = NULL;
+	long buffer_length = 0L;
+	unsigned char *next = NULL;
+	unsigned char *end = NULL;
+	unsigned char *tdi_bits = NULL;
+	unsigned char *tdo_bits = NULL;
+	long length = 0L;
+	long byte_count = 0L;
+	long index = 0L;
+	long cycle = 0L;
+	long read_count = 0L;
+	long mismatch_count = 0L;
+	int kind = 0;
+	int tdi = 0;
+	int tdo = 0;
+	int expected = 0;
+	BOOL valid = FALSE;
+	BOOL done = FALSE;
+	double start_time = 0.0;
+	double delay_time = 0.0;
+	double total_time = 0.0;
+
+	buffer = map_jam_file(name, &buffer_length);
+	header = (JTAG_TRACE_HEADER *) buffer;
+
+	if ((buffer != NULL) &&
+		(buffer_length >= (long) sizeof(JTAG_TRACE_HEADER)) &&
+		(header->magic == JTAG_TRACE_MAGIC) &&
+		(header->version == JTAG_TRACE_VERSION) &&
+		(header->word_size == (long) sizeof(long)) &&
+		(header->stream_length >= 0L) &&
+		(header->stream_length <=
+			buffer_length - (long) sizeof(JTAG_TRACE_HEADER)))
+	{
+		next = (unsigned char *) (buffer + sizeof(JTAG_TRACE_HEADER));
+		end = next + header->stream_length;
+		valid = check_jtag_trace(header, next, end);
+	}
+
+	start_time = profile_clock();
+
+	/* the trace has been checked, so each record can be played as read */
+	while (valid && !done)
+	{
+		kind = *next++;
+		length = read_trace_length(&next, end);
+
+		if (kind == TRACE_END)
+		{
+			done = TRUE;
+		}
+		else if (kind == TRACE_DELAY)
+		{
+			delay_time -= profile_clock();
+			jam_delay(length);
+			delay_time += profile_clock();
+		}
+		else
+		{
+			byte_count = (length + 7L) / 8L;
+			tdi_bits = next;
+			if ((kind & TRACE_TDI_CONSTANT) == 0) next += byte_count;
+			tdo_bits = next;
+			if (kind & TRACE_READ_TDO) next += byte_count;
+
+			tdi = (kind & TRACE_TDI_ONE) ? 1 : 0;
+
+			for (index = 0L; index < length; ++index)
+			{
+				if ((kind & TRACE_TDI_CONSTANT) == 0)
+				{
+					tdi = (tdi_bits[index >> 3] >> (index & 7L)) & 1;
+				}
+
+				tdo = jtag_cycle((kind & TRACE_TMS) ? 1 : 0, tdi,
+					(kind & TRACE_READ_TDO) ? 1 : 0);
+
+				if (kind & TRACE_READ_TDO)
+				{
+					expected = (tdo_bits[index >> 3] >> (index & 7L)) & 1;
+					++read_count;
+
+					if (tdo != expected)
+					{
+						if (mismatch_count < TRACE_MISMATCHES_SHOWN)
+						{
+							printf("TDO mismatch at TCK cycle %ld: expected %d, read %d\n",
+								cycle, expected, tdo);
+						}
+						++mismatch_count;
+					}
+				}
+
+				++cycle;
+			}
+		}
+	}
+
+	total_time = profile_clock() - start_time;
+
+	if (buffer == NULL)
+	{
+		fprintf(stderr, "Error: can't read JTAG trace file \"%s\"\n", name);
+	}
+	else if (!valid)
+	{
+		fprintf(stderr, "Error: \"%s\" is not a valid JTAG trace for this player\n", name);
+	}
+	else
+	{
+		printf("Replayed %ld TCK cycles and %ld delays in %.6f s (%.6f s in delays)\n",
+			cycle, header->delay_count, total_time, delay_time);
+		if (total_time > delay_time)
+		{
+			printf("TCK rate excluding delays: %.1f kHz\n",
+				((double) cycle) / (total_time - delay_time) / 1000.0);
+		}
+		printf("Checked %ld TDO bits: %ld mismatches\n", read_count,
+			mismatch_count);
+	}
+
+	if (buffer != NULL) munmap(buffer, (size_t) buffer_length);
+
+	return (valid && (mismatch_count == 0L));
+}
+
+/************************************************************************
+*
+*	Scan vector files
+*
+*	With -x<file>, the JTAG activity of a run is also written as a scan
+*	vector file, and "jam --play <file>" plays it back.  Where a trace
+*	holds every cycle, a vector file follows the TAP controller through
+*	its states and holds what was done in them: each scan (the cycles
+*	spent in Shift-DR or Shift-IR) with its TDI data, the TDO data that
+*	was read and a mask of the bits that were read, the TMS sequence of
+*	each move between scans, and the waits.  The player shifts each scan
+*	with TMS held and TDI driven only when it changes, and compares the
+*	TDO bits eight at a time against the expected data under the mask.
+*	As there is no simulator for the devices, the run being exported
+*	must be made on a known good chain; every TDO bit the program read
+*	is expected to be the same when the file is played, so it suits
+*	actions such as PROGRAM and VERIFY rather than ones which read back
+*	values that change from one device to the next.  Signals driven by
+*	VECTOR statements are not exported.
+*
+*	After a header in the native word size, records are coded as in a
+*	JTAG trace: a byte giving the kind of record and its flags, then a
+*	variable-length count of cycles (or microseconds, for a wait), then
+*	the bits, eight to a byte starting with the least significant bit.
+*	A move has its TMS bits unless they are all the same.  A scan has
+*	its TDI bits unless they are all the same, then if any TDO bits were
+*	read, the expected bits and, unless all were read, the mask.  Long
+*	scans are split into several records, all but the last of which
+*	leave the TAP controller in the shift state.  Every record and the
+*	totals in the header are checked before the first one is played.
+*/
+
+#define VECTOR_FILE_MAGIC 0x5650414AL	/* "JAPV" */
+#define VECTOR_FILE_VERSION 1L
+
+#define VECTOR_RECORD_TYPE 0x07
+#define VECTOR_MOVE 0x01
+#define VECTOR_SCAN 0x02
+#define VECTOR_WAIT 0x03
+#define VECTOR_END 0x04
+
+/* flags of a move */
+#define VECTOR_TMS_CONSTANT 0x08
+#define VECTOR_TMS_ONE 0x10
+
+/* flags of a scan */
+#define VECTOR_EXIT 0x08		/* TMS is high on the last bit */
+#define VECTOR_CHECK 0x10		/* some TDO bits are checked */
+#define VECTOR_CHECK_ALL 0x20	/* all TDO bits are checked, no mask */
+#define VECTOR_TDI_CONSTANT 0x40
+#define VECTOR_TDI_ONE 0x80
+
+#define VECTOR_CHUNK_BYTES 4096
+#define VECTOR_CHUNK_CYCLES (VECTOR_CHUNK_BYTES * 8L)
+
+typedef struct
+{
+	long magic;
+	long version;
+	long word_size;
+	long scan_count;		/* scans, not counting split records */
+	long scan_bits;
+	long check_bits;		/* TDO bits checked */
+	long move_cycles;
+	long wait_count;
+	long wait_time;			/* microseconds */
+	long stream_length;		/* bytes of records after the header */
+} VECTOR_FILE_HEADER;
+
+char *vector_file_name = NULL;
+FILE *vector_fp = NULL;
+VECTOR_FILE_HEADER vector_header;
+BOOL vector_ok = TRUE;
+
+/* state of the TAP controller, or -1 until it has been reset */
+int vector_tap_state = -1;
+int vector_tms_high_count = 0;
+
+/* the move and the part of a scan not yet written */
+long vector_move_length = 0L;
+unsigned char vector_move_bits[VECTOR_CHUNK_BYTES];
+long vector_scan_length = 0L;
+unsigned char vector_tdi_bits[VECTOR_CHUNK_BYTES];
+unsigned char vector_expected_bits[VECTOR_CHUNK_BYTES];
+unsigned char vector_mask_bits[VECTOR_CHUNK_BYTES];
+
+/* while playing */
+long vector_mismatch_count = 0L;
+
+/* tells whether the first <length> bits are all <value> */
+BOOL vector_bits_constant(unsigned char *bits, long length, int value)
+{
+	long byte_count = (length + 7L) / 8L;
+	long index = 0L;
+	unsigned char fill = (unsigned char) (value ? 0xff : 0);
+	unsigned char last = (unsigned char) (0xff >> (byte_count * 8L - length));
+	BOOL constant = TRUE;
+
+	for (index = 0L; constant && (index < byte_count); ++index)
+	{
+		constant = (((bits[index] ^ fill) &
+			((index == byte_count - 1L) ? last : 0xff)) == 0);
+	}
+
+	return (constant);
+}
+
+void flush_vector_move(void)
+{
+	long byte_count = (vector_move_length + 7L) / 8L;
+	int kind = VECTOR_MOVE;
+
+	if (vector_move_length > 0L)
+	{
+		if (vector_bits_constant(vector_move_bits, vector_move_length,
+			vector_move_bits[0] & 1))
+		{
+			kind |= VECTOR_TMS_CONSTANT |
+				((vector_move_bits[0] & 1) ? VECTOR_TMS_ONE : 0);
+		}
+
+		write_stream_record(vector_fp, &vector_ok,
+			&vector_header.stream_length, kind, vector_move_length);
+		if ((kind & VECTOR_TMS_CONSTANT) == 0)
+		{
+			write_stream_bytes(vector_fp, &vector_ok,
+				&vector_header.stream_length, vector_move_bits, byte_count);
+		}
+
+		vector_header.move_cycles += vector_move_length;
+		memset(vector_move_bits, 0, (size_t) byte_count);
+		vector_move_length = 0L;
+	}
+}
+
+void flush_vector_scan(BOOL exit_shift)
+{
+	long byte_count = (vector_scan_length + 7L) / 8L;
+	long index = 0L;
+	long check_bits = 0L;
+	int kind = VECTOR_SCAN | (exit_shift ? VECTOR_EXIT : 0);
+
+	if (vector_scan_length > 0L)
+	{
+		for (index = 0L; index < vector_scan_length; ++index)
+		{
+			check_bits += (vector_mask_bits[index >> 3] >> (index & 7L)) & 1;
+		}
+
+		if (check_bits == vector_scan_length)
+		{
+			kind |= VECTOR_CHECK | VECTOR_CHECK_ALL;
+		}
+		else if (check_bits > 0L)
+		{
+			kind |= VECTOR_CHECK;
+		}
+
+		if (vector_bits_constant(vector_tdi_bits, vector_scan_length,
+			vector_tdi_bits[0] & 1))
+		{
+			kind |= VECTOR_TDI_CONSTANT |
+				((vector_tdi_bits[0] & 1) ? VECTOR_TDI_ONE : 0);
+		}
+
+		write_stream_record(vector_fp, &vector_ok,
+			&vector_header.stream_length, kind, vector_scan_length);
+		if ((kind & VECTOR_TDI_CONSTANT) == 0)
+		{
+			write_stream_bytes(vector_fp, &vector_ok,
+				&vector_header.stream_length, vector_tdi_bits, byte_count);
+		}
+		if (kind & VECTOR_CHECK)
+		{
+			write_stream_bytes(vector_fp, &vector_ok,
+				&vector_header.stream_length, vector_expected_bits, byte_count);
+		}
+		if ((kind & VECTOR_CHECK) && !(kind & VECTOR_CHECK_ALL))
+		{
+			write_stream_bytes(vector_fp, &vector_ok,
+				&vector_header.stream_length, vector_mask_bits, byte_count);
+		}
+
+		if (exit_shift) ++vector_header.scan_count;
+		vector_header.scan_bits += vector_scan_length;
+		vector_header.check_bits += check_bits;
+		memset(vector_tdi_bits, 0, (size_t) byte_count);
+		memset(vector_expected_bits, 0, (size_t) byte_count);
+		memset(vector_mask_bits, 0, (size_t) byte_count);
+		vector_scan_length = 0L;
+	}
+}
+
+void export_vector_cycle(int tms, int tdi, int read_tdo, int tdo)
+{
+	long byte = 0L;
+	unsigned char bit = 0;
+
+	tms = !!tms;
+
+	if ((vector_tap_state == TAP_SHIFT_DR) ||
+		(vector_tap_state == TAP_SHIFT_IR))
+	{
+		flush_vector_move();
+		if (vector_scan_length == VECTOR_CHUNK_CYCLES) flush_vector_scan(FALSE);
+
+		byte = vector_scan_length >> 3;
+		bit = (unsigned char) (1 << (vector_scan_length & 7L));
+		if (tdi) vector_tdi_bits[byte] |= bit;
+		if (read_tdo) vector_mask_bits[byte] |= bit;
+		if (read_tdo && tdo) vector_expected_bits[byte] |= bit;
+		++vector_scan_length;
+
+		if (tms) flush_vector_scan(TRUE);
+	}
+	else
+	{
+		if (vector_move_length == VECTOR_CHUNK_CYCLES) flush_vector_move();
+
+		byte = vector_move_length >> 3;
+		bit = (unsigned char) (1 << (vector_move_length & 7L));
+		if (tms) vector_move_bits[byte] |= bit;
+		++vector_move_length;
+	}
+
+	/* the state is known once TMS has been high for five cycles */
+	if (vector_tap_state >= 0)
+	{
+		vector_tap_state = tap_transitions[vector_tap_state][tms];
+	}
+	else
+	{
+		vector_tms_high_count = tms ? (vector_tms_high_count + 1) : 0;
+		if (vector_tms_high_count >= 5) vector_tap_state = TAP_RESET;
+	}
+}
+
+void export_vector_wait(long microseconds)
+{
+	flush_vector_move();
+	flush_vector_scan(FALSE);
+	write_stream_record(vector_fp, &vector_ok,
+		&vector_header.stream_length, VECTOR_WAIT, microseconds);
+	++vector_header.wait_count;
+	vector_header.wait_time += microseconds;
+}
+
+BOOL start_vector_export(void)
+{
+	memset(&vector_header, 0, sizeof(vector_header));
+	memset(vector_move_bits, 0, sizeof(vector_move_bits));
+	memset(vector_tdi_bits, 0, sizeof(vector_tdi_bits));
+	memset(vector_expected_bits, 0, sizeof(vector_expected_bits));
+	memset(vector_mask_bits, 0, sizeof(vector_mask_bits));
+	vector_header.magic = VECTOR_FILE_MAGIC;
+	vector_header.version = VECTOR_FILE_VERSION;
+	vector_header.word_size = (long) sizeof(long);
+	vector_tap_state = -1;
+	vector_tms_high_count = 0;
+	vector_move_length = 0L;
+	vector_scan_length = 0L;
+	vector_ok = TRUE;
+
+	/* the header is written again with the counts at the end */
+	if (((vector_fp = fopen(vector_file_name, "wb")) == NULL) ||
+		(fwrite(&vector_header, sizeof(vector_header), 1, vector_fp) != 1))
+	{
+		fprintf(stderr, "Error: can't write scan vector file \"%s\"\n",
+			vector_file_name);
+		if (vector_fp != NULL) fclose(vector_fp);
+		vector_fp = NULL;
+	}
+
+	vector_export = (vector_fp != NULL);
+
+	return (vector_export);
+}
+
+BOOL finish_vector_export(void)
+{
+	if (vector_export)
+	{
+		vector_export = FALSE;
+		flush_vector_move();
+		flush_vector_scan(FALSE);
+		write_stream_record(vector_fp, &vector_ok,
+			&vector_header.stream_length, VECTOR_END, 0L);
+
+		if (!vector_ok || (fseek(vector_fp, 0L, SEEK_SET) != 0) ||
+			(fwrite(&vector_header, sizeof(vector_header), 1, vector_fp) != 1))
+		{
+			vector_ok = FALSE;
+		}
+
+		if (fclose(vector_fp) != 0) vector_ok = FALSE;
+		vector_fp = NULL;
+
+		if (!vector_ok)
+		{
+			fprintf(stderr, "Error: can't write scan vector file \"%s\"\n",
+				vector_file_name);
+		}
+		else if (verbose)
+		{
+			printf("Scan vectors: %ld scans, %ld bits, %ld checked, %ld move cycles, %ld waits, %ld bytes\n",
+				vector_header.scan_count, vector_header.scan_bits,
+				vector_header.check_bits, vector_header.move_cycles,
+				vector_header.wait_count, vector_header.stream_length +
+				(long) sizeof(vector_header));
+		}
+	}
+
+	return (vector_ok);
+}
+
+/* shifts one scan record, returning the number of TDO bits which differ */
+long shift_vector_scan(long scan, long length, int kind,
+	unsigned char *tdi_bits, unsigned char *expected_bits,
+	unsigned char *mask_bits)
+{
+	long byte_count = (length + 7L) / 8L;
+	long byte = 0L;
+	long index = 0L;
+	long mismatch_count = 0L;
+	int bit = 0;
+	int tdi = (kind & VECTOR_TDI_ONE) ? 1 : 0;
+	int last_tdi = -1;
+	int mask = 0;
+	int tdo = 0;
+	int difference = 0;
+
+	if (!jtag_hardware_initialized)
+	{
+		initialize_jtag_hardware();
+		jtag_hardware_initialized = TRUE;
+	}
+
+	pin_set(0, BTMS);
+
+	for (byte = 0L; byte < byte_count; ++byte)
+	{
+		mask = (kind & VECTOR_CHECK_ALL) ? 0xff :
+			((kind & VECTOR_CHECK) ? mask_bits[byte] : 0);
+		tdo = 0;
+
+		for (bit = 0; (bit < 8) && (index < length); ++bit)
+		{
+			if ((kind & VECTOR_TDI_CONSTANT) == 0)
+			{
+				tdi = (tdi_bits[byte] >> bit) & 1;
+			}
+
+			if ((index == length - 1L) && (kind & VECTOR_EXIT))
+			{
+				pin_set(1, BTMS);
+			}
+
+			if (tdi != last_tdi)
+			{
+				pin_set(tdi, BTDI);
+				last_tdi = tdi;
+			}
+
+			pin_set(1, BTCK);
+			if (mask & (1 << bit)) tdo |= (pin_get(BTDO) ? 1 : 0) << bit;
+			pin_set(0, BTCK);
+
+			++index;
+		}
+
+		counters.tck_count += (long) bit;
+		counters.cycle_count[1] += (long) bit;
+
+		/* compare the whole byte at once */
+		difference = (mask != 0) ? ((tdo ^ expected_bits[byte]) & mask) : 0;
+
+		for (bit = 0; (difference != 0) && (bit < 8); ++bit)
+		{
+			if (difference & (1 << bit))
+			{
+				if (vector_mismatch_count < TRACE_MISMATCHES_SHOWN)
+				{
+					printf("TDO mismatch in scan %ld, bit %ld: expected %d, read %d\n",
+						scan, (byte * 8L) + bit,
+						(expected_bits[byte] >> bit) & 1, (tdo >> bit) & 1);
+				}
+				++vector_mismatch_count;
+				++mismatch_count;
+				difference &= ~(1 << bit);
+			}
+		}
+	}
+
+	if (kind & VECTOR_EXIT) tap_state = tap_transitions[tap_state][1];
+
+	return (mismatch_count);
+}
+
+/* walks the whole file, so that a bad one is found before any pins move */
+BOOL check_vector_file(VECTOR_FILE_HEADER *header, unsigned char *next,
+	unsigned char *end)
+{
+	long length = 0L;
+	long byte_count = 0L;
+	long data_length = 0L;
+	long scan_bits = 0L;
+	long move_cycles = 0L;
+	int kind = 0;
+	BOOL valid = TRUE;
+	BOOL done = FALSE;
+
+	while (valid && !done)
+	{
+		if (next < end)
+		{
+			kind = *next++;
+			length = read_trace_length(&next, end);
+		}
+		else
+		{
+			length = -1L;
+		}
+
+		byte_count = (length + 7L) / 8L;
+		data_length = 0L;
+
+		if (length < 0L)
+		{
+			valid = FALSE;
+		}
+		else if (kind == VECTOR_END)
+		{
+			done = TRUE;
+		}
+		else if ((kind & VECTOR_RECORD_TYPE) == VECTOR_MOVE)
+		{
+			valid = ((kind & ~(VECTOR_RECORD_TYPE | VECTOR_TMS_CONSTANT |
+				VECTOR_TMS_ONE)) == 0);
+			if ((kind & VECTOR_TMS_CONSTANT) == 0) data_length = byte_count;
+			move_cycles += length;
+		}
+		else if ((kind & VECTOR_RECORD_TYPE) == VECTOR_SCAN)
+		{
+			valid = (((kind & VECTOR_CHECK_ALL) == 0) ||
+				((kind & VECTOR_CHECK) != 0));
+			if ((kind & VECTOR_TDI_CONSTANT) == 0) data_length += byte_count;
+			if (kind & VECTOR_CHECK) data_length += byte_count;
+			if ((kind & VECTOR_CHECK) && !(kind & VECTOR_CHECK_ALL))
+			{
+				data_length += byte_count;
+			}
+			scan_bits += length;
+		}
+		else
+		{
+			valid = (kind == VECTOR_WAIT);
+		}
+
+		if (valid && (data_length > (long) (end - next))) valid = FALSE;
+		if (valid) next += data_length;
+	}
+
+	return (valid && (scan_bits == header->scan_bits) &&
+		(move_cycles == header->move_cycles));
+}
+
+BOOL play_vector_file(char *name)
+{
+	VECTOR_FILE_HEADER *header = NULL;
+	char *buffer = NULL;
+	long buffer_length = 0L;
+	unsigned char *next = NULL;
+	unsigned char *end = NULL;
+	unsigned char *tdi_bits = NULL;
+	unsigned char *expected_bits = NULL;
+	unsigned char *mask_bits = NULL;
+	long length = 0L;
+	long byte_count = 0L;
+	long index = 0L;
+	long scan = 0L;
+	long scan_bits = 0L;
+	long check_bits = 0L;
+	long move_cycles = 0L;
+	long wait_count = 0L;
+	long mismatch_scans = 0L;
+	int kind = 0;
+	int tms = 0;
+	int bits = 0;
+	BOOL valid = FALSE;
+	BOOL done = FALSE;
+	double start_time = 0.0;
+	double wait_time = 0.0;
+	double total_time = 0.0;
+
+	buffer = map_jam_file(name, &buffer_length);
+	header = (VECTOR_FILE_HEADER *) buffer;
+	vector_mismatch_count = 0L;
+
+	if ((buffer != NULL) &&
+		(buffer_length >= (long) sizeof(VECTOR_FILE_HEADER)) &&
+		(header->magic == VECTOR_FILE_MAGIC) &&
+		(header->version == VECTOR_FILE_VERSION) &&
+		(header->word_size == (long) sizeof(long)) &&
+		(header->stream_length >= 0L) &&
+		(header->stream_length <=
+			buffer_length - (long) sizeof(VECTOR_FILE_HEADER)))
+	{
+		next = (unsigned char *) (buffer + sizeof(VECTOR_FILE_HEADER));
+		end = next + header->stream_length;
+		valid = check_vector_file(header, next, end);
+	}
+
+	start_time = profile_clock();
+
+	/* the file has been checked, so each record can be played as read */
+	while (valid && !done)
+	{
+		kind = *next++;
+		length = read_trace_length(&next, end);
+		byte_count = (length + 7L) / 8L;
+
+		if (kind == VECTOR_END)
+		{
+			done = TRUE;
+		}
+		else if (kind == VECTOR_WAIT)
+		{
+			wait_time -= profile_clock();
+			jam_delay(length);
+			wait_time += profile_clock();
+			++wait_count;
+		}
+		else if ((kind & VECTOR_RECORD_TYPE) == VECTOR_MOVE)
+		{
+			tdi_bits = next;
+			if ((kind & VECTOR_TMS_CONSTANT) == 0) next += byte_count;
+
+			tms = (kind & VECTOR_TMS_ONE) ? 1 : 0;
+
+			for (index = 0L; index < length; ++index)
+			{
+				if ((kind & VECTOR_TMS_CONSTANT) == 0)
+				{
+					tms = (tdi_bits[index >> 3] >> (index & 7L)) & 1;
+				}
+
+				jtag_cycle(tms, 0, 0);
+			}
+
+			move_cycles += length;
+		}
+		else if ((kind & VECTOR_RECORD_TYPE) == VECTOR_SCAN)
+		{
+			tdi_bits = next;
+			if ((kind & VECTOR_TDI_CONSTANT) == 0) next += byte_count;
+			expected_bits = next;
+			if (kind & VECTOR_CHECK) next += byte_count;
+			mask_bits = next;
+			if ((kind & VECTOR_CHECK) && !(kind & VECTOR_CHECK_ALL))
+			{
+				next += byte_count;
+			}
+
+			if ((length > 0L) &&
+				(shift_vector_scan(scan, length, kind, tdi_bits,
+					expected_bits, mask_bits) > 0L))
+			{
+				++mismatch_scans;
+			}
+
+			if (kind & VECTOR_CHECK_ALL) check_bits += length;
+
+			for (index = 0L; (kind & VECTOR_CHECK) &&
+				!(kind & VECTOR_CHECK_ALL) && (index < byte_count); ++index)
+			{
+				for (bits = mask_bits[index]; bits != 0; bits &= bits - 1)
+				{
+					++check_bits;
+				}
+			}
+
+			scan_bits += length;
+			if (kind & VECTOR_EXIT) ++scan;
+		}
+	}
+
+	total_time = profile_clock() - start_time;
+
+	if (buffer == NULL)
+	{
+		fprintf(stderr, "Error: can't read scan vector file \"%s\"\n", name);
+	}
+	else if (!valid)
+	{
+		fprintf(stderr, "Error: \"%s\" is not a valid scan vector file for this player\n", name);
+	}
+	else
+	{
+		printf("Played %ld scans (%ld bits), %ld move cycles and %ld waits in %.6f s (%.6f s in waits)\n",
+			scan, scan_bits, move_cycles, wait_count, total_time, wait_time);
+		if (total_time > wait_time)
+		{
+			printf("TCK rate excluding waits: %.1f kHz\n",
+				((double) (scan_bits + move_cycles)) /
+				(total_time - wait_time) / 1000.0);
+		}
+		printf("Checked %ld TDO bits: %ld mismatches in %ld scans\n",
+			check_bits, vector_mismatch_count, mismatch_scans);
+	}
+
+	if (buffer != NULL) munmap(buffer, (size_t) buffer_length);
+
+	return (valid && (vector_mismatch_count == 0L));
+}
+
+/************************************************************************
+*
+*	JSON output
+*
+*	With --json, everything the player reports on standard output is a
+*	JSON object on a line of its own: each PRINT is a "message", each
+*	EXPORT an "export" (whether or not -v is given), each NOTE a "note"
+*	with -v, and the end of the run a "result".  The result gives the
+*	exit code or error, the CRC, the time taken to load the file, check
+*	its CRC, decode arrays and execute the rest of the program, the TCK
+*	cycles and bits shifted, the TCK rate while not in delays, and the
+*	delays requested and actually taken.  Times are in seconds.  Errors
+*	which stop the player before the program runs are still reported as
+*	text on standard error, and the report of -e is only written to the
+*	profile file.
+*/
+
+/* CRC result of this run, as last reported */
+JAM_RETURN_TYPE json_crc_result = JAMC_SUCCESS;
+unsigned short json_expected_crc = 0;
+unsigned short json_actual_crc = 0;
+BOOL json_crc_known = FALSE;
+
+void print_json_string(char *text)
+{
+	unsigned char *next = (unsigned char *) text;
+
+	putchar('"');
+
+	while ((next != NULL) && (*next != '\0'))
+	{
+		if ((*next == '"') || (*next == '\\'))
+		{
+			printf("\\%c", *next);
+		}
+		else if (*next < 0x20)
+		{
+			printf("\\u%04x", *next);
+		}
+		else
+		{
+			putchar(*next);
+		}
+
+		++next;
+	}
+
+	putchar('"');
+}
+
+void print_json_note(char *key, char *value)
+{
+	printf("{\"type\":\"note\",\"key\":");
+	print_json_string(key);
+	printf(",\"value\":");
+	print_json_string(value);
+	printf("}\n");
+}
+
+void print_json_result(char *filename, char *action,
+	JAM_RETURN_TYPE exec_result, int exit_code, char *exit_string,
+	long error_line, char *error_string, double load_time,
+	double crc_time, double execute_time, double total_time)
+{
+	long shifted_bit_count = counters.ir_bit_count + counters.dr_bit_count;
+	double wire_time = execute_time + decode_time - counters.delay_actual;
+
+	printf("{\"type\":\"result\",\"file\":");
+	print_json_string(filename);
+	printf(",\"action\":");
+	if ((action != NULL) && (*action != '\0')) print_json_string(action);
+	else printf("null");
+
+	if (exec_result == JAMC_SUCCESS)
+	{
+		printf(",\"status\":\"success\",\"exit_code\":%d,\"exit_text\":",
+			exit_code);
+		print_json_string(exit_string);
+	}
+	else
+	{
+		printf(",\"status\":\"error\",\"error_code\":%d,\"error_line\":%ld,\"error_text\":",
+			(int) exec_result, error_line);
+		print_json_string(error_string);
+	}
+
+	if (json_crc_known)
+	{
+		printf(",\"crc_result\":\"%s\",\"expected_crc\":\"%04X\",\"actual_crc\":\"%04X\"",
+			(json_crc_result == JAMC_SUCCESS) ? "matched" :
+			(json_crc_result == JAMC_CRC_ERROR) ? "mismatch" :
+			(json_crc_result == JAMC_UNEXPECTED_END) ? "missing" : "error",
+			json_expected_crc, json_actual_crc);
+	}
+
+	printf(",\"load_time\":%.6f,\"crc_time\":%.6f,\"decode_time\":%.6f",
+		load_time, crc_time, decode_time);
+	printf(",\"execute_time\":%.6f,\"total_time\":%.6f",
+		execute_time, total_time);
+	printf(",\"statements\":%ld", counters.statement_count);
+	printf(",\"tck_count\":%ld,\"bits_shifted\":%ld,\"bytes_shifted\":%ld",
+		counters.tck_count, shifted_bit_count, (shifted_bit_count + 7L) / 8L);
+	printf(",\"tck_mhz\":%.6f", (wire_time > 0.0) ?
+		((double) counters.tck_count / wire_time / 1e6) : 0.0);
+	printf(",\"delay_count\":%ld,\"delay_requested\":%.6f,\"delay_actual\":%.6f}\n",
+		counters.delay_count, (double) counters.delay_requested / 1e6,
+		counters.delay_actual);
+	fflush(stdout);
+}
+
+/************************************************************************
+*
+*	Counters
+*
+*	Every run counts the statements it executes, its TCK cycles, split
+*	into those spent moving the TAP controller between states and those
+*	spent shifting in Shift-DR or Shift-IR, the IR and DR scans and the
+*	bits they shifted, the GPIO register writes and reads, and the calls
+*	to jam_delay() with the time asked for and the time they took.
+*	Reading the clock for every cycle would cost more than the cycle
+*	itself, so one cycle in COUNTER_SAMPLE_INTERVAL of each kind is
+*	timed, and the time spent moving and shifting is estimated from
+*	those.  The counters are written to standard error when the player
+*	exits, or to standard output as a JSON line with --json.  The job
+*	server keeps the totals of all its jobs in memory shared with the
+*	children which run them, and sends them to a client which asks with
+*	a "--counters" line.
+*/
+
+/* totals of all jobs run by the server */
+PLAYER_COUNTERS *job_counters = NULL;
+
+/* adds the statements and scans done by the interpreter to the counters */
+void count_run(void)
+{
+	long ir_scan_count = 0L;
+	long ir_bit_count = 0L;
+	long dr_scan_count = 0L;
+	long dr_bit_count = 0L;
+
+	jam_get_scan_counts(&ir_scan_count, &ir_bit_count,
+		&dr_scan_count, &dr_bit_count);
+
+	++counters.run_count;
+	counters.statement_count += jam_get_statement_count();
+	counters.ir_scan_count += ir_scan_count;
+	counters.ir_bit_count += ir_bit_count;
+	counters.dr_scan_count += dr_scan_count;
+	counters.dr_bit_count += dr_bit_count;
+}
+
+void add_counters(PLAYER_COUNTERS *total, PLAYER_COUNTERS *run)
+{
+	int shifting = 0;
+
+	total->run_count += run->run_count;
+	total->statement_count += run->statement_count;
+	total->tck_count += run->tck_count;
+
+	for (shifting = 0; shifting < 2; ++shifting)
+	{
+		total->cycle_count[shifting] += run->cycle_count[shifting];
+		total->sample_count[shifting] += run->sample_count[shifting];
+		total->sample_time[shifting] += run->sample_time[shifting];
+	}
+
+	total->ir_scan_count += run->ir_scan_count;
+	total->ir_bit_count += run->ir_bit_count;
+	total->dr_scan_count += run->dr_scan_count;
+	total->dr_bit_count += run->dr_bit_count;
+	total->gpio_write_count += run->gpio_write_count;
+	total->gpio_read_count += run->gpio_read_count;
+	total->delay_count += run->delay_count;
+	total->delay_requested += run->delay_requested;
+	total->delay_actual += run->delay_actual;
+}
+
+/* estimates the time spent moving (0) or shifting (1) */
+double counter_time(PLAYER_COUNTERS *c, int shifting)
+{
+	return ((c->sample_count[shifting] > 0L) ?
+		(c->sample_time[shifting] * (double) c->cycle_count[shifting] /
+			(double) c->sample_count[shifting]) : 0.0);
+}
+
+void print_counters(FILE *fp, PLAYER_COUNTERS *c)
+{
+	if (json_output)
+	{
+		fprintf(fp, "{\"type\":\"counters\",\"runs\":%ld,\"statements\":%ld,\"tck_count\":%ld",
+			c->run_count, c->statement_count, c->tck_count);
+		fprintf(fp, ",\"move_cycles\":%ld,\"shift_cycles\":%ld",
+			c->cycle_count[0], c->cycle_count[1]);
+		fprintf(fp, ",\"move_time\":%.6f,\"shift_time\":%.6f",
+			counter_time(c, 0), counter_time(c, 1));
+		fprintf(fp, ",\"ir_scans\":%ld,\"ir_bits\":%ld,\"dr_scans\":%ld,\"dr_bits\":%ld",
+			c->ir_scan_count, c->ir_bit_count,
+			c->dr_scan_count, c->dr_bit_count);
+		fprintf(fp, ",\"gpio_writes\":%ld,\"gpio_reads\":%ld",
+			c->gpio_write_count, c->gpio_read_count);
+		fprintf(fp, ",\"delay_count\":%ld,\"delay_requested\":%.6f,\"delay_actual\":%.6f}\n",
+			c->delay_count, (double) c->delay_requested / 1e6,
+			c->delay_actual);
+	}
+	else
+	{
+		fprintf(fp, "Counters: %ld runs, %ld statements\n",
+			c->run_count, c->statement_count);
+		fprintf(fp, "Counters: %ld TCK cycles (%ld moving, %ld shifting)\n",
+			c->tck_count, c->cycle_count[0], c->cycle_count[1]);
+		fprintf(fp, "Counters: time moving %.6f s, shifting %.6f s (sampled)\n",
+			counter_time(c, 0), counter_time(c, 1));
+		fprintf(fp, "Counters: IRSCAN %ld scans, %ld bits; DRSCAN %ld scans, %ld bits\n",
+			c->ir_scan_count, c->ir_bit_count,
+			c->dr_scan_count, c->dr_bit_count);
+		fprintf(fp, "Counters: GPIO %ld writes, %ld reads\n",
+			c->gpio_write_count, c->gpio_read_count);
+		fprintf(fp, "Counters: %ld delays, %.6f s requested, %.6f s taken\n",
+			c->delay_count, (double) c->delay_requested / 1e6,
+			c->delay_actual);
+	}
+
+	fflush(fp);
+}
+
+/************************************************************************
+*
+*	get_tick_count() -- Get system tick count in milliseconds
+*
+*	for DOS, use BIOS function _bios_timeofday()
+*	for WINDOWS use GetTickCount() function
+*	for UNIX use clock() system function
+*/
+DWORD get_tick_count(void)
+{
+	DWORD tick_count = 0L;
+
+	/* assume clock() function returns microseconds */
+	tick_count = (DWORD) (clock()*1000 / CLOCKS_PER_SEC);
+
+	return (tick_count);
+}
+
+#define DELAY_SAMPLES 10
+#define DELAY_CHECK_LOOPS 10000
+
+void calibrate_delay(void)
+{
+	one_ms_delay = 1000L;
+}
+
+void report_crc
+(
+	JAM_RETURN_TYPE crc_result,
+	unsigned short expected_crc,
+	unsigned short actual_crc
+)
+{
+	json_crc_result = crc_result;
+	json_expected_crc = expected_crc;
+	json_actual_crc = actual_crc;
+	json_crc_known = TRUE;
+
+	if (!json_output && (verbose || (crc_result == JAMC_CRC_ERROR)))
+	{
+		switch (crc_result)
+		{
+		case JAMC_SUCCESS:
+			printf("CRC matched: CRC value = %04X\n", actual_crc);
+			break;
+
+		case JAMC_CRC_ERROR:
+			printf("CRC mismatch: expected %04X, actual %04X\n",
+				expected_crc, actual_crc);
+			break;
+
+		case JAMC_UNEXPECTED_END:
+			printf("Expected CRC not found, actual CRC value = %04X\n",
+				actual_crc);
+			break;
+
+		default:
+			printf("CRC function returned error code %d\n", crc_result);
+			break;
+		}
+	}
+}
+
+char *error_text[] =
+{
+/* JAMC_SUCCESS            0 */ "success",
+/* JAMC_OUT_OF_MEMORY      1 */ "out of memory",
+/* JAMC_IO_ERROR           2 */ "file access error",
+/* JAMC_SYNTAX_ERROR       3 */ "syntax error",
+/* JAMC_UNEXPECTED_END     4 */ "unexpected end of file",
+/* JAMC_UNDEFINED_SYMBOL   5 */ "undefined symbol",
+/* JAMC_REDEFINED_SYMBOL   6 */ "redefined symbol",
+/* JAMC_INTEGER_OVERFLOW   7 */ "integer overflow",
+/* JAMC_DIVIDE_BY_ZERO     8 */ "divide by zero",
+/* JAMC_CRC_ERROR          9 */ "CRC mismatch",
+/* JAMC_INTERNAL_ERROR    10 */ "internal error",
+/* JAMC_BOUNDS_ERROR      11 */ "bounds error",
+/* JAMC_TYPE_MISMATCH     12 */ "type mismatch",
+/* JAMC_ASSIGN_TO_CONST   13 */ "assignment to constant",
+/* JAMC_NEXT_UNEXPECTED   14 */ "NEXT unexpected",
+/* JAMC_POP_UNEXPECTED    15 */ "POP unexpected",
+/* JAMC_RETURN_UNEXPECTED 16 */ "RETURN unexpected",
+/* JAMC_ILLEGAL_SYMBOL    17 */ "illegal symbol name",
+/* JAMC_VECTOR_MAP_FAILED 18 */ "vector signal name not found",
+/* JAMC_USER_ABORT        19 */ "execution cancelled",
+/* JAMC_STACK_OVERFLOW    20 */ "stack overflow",
+/* JAMC_ILLEGAL_OPCODE    21 */ "illegal instruction code",
+/* JAMC_PHASE_ERROR       22 */ "phase error",
+/* JAMC_SCOPE_ERROR       23 */ "scope error",
+/* JAMC_ACTION_NOT_FOUND  24 */ "action not found",
+};
+
+#define MAX_ERROR_CODE (int)((sizeof(error_text)/sizeof(error_text[0]))+1)
+
+/************************************************************************/
+
+int main(int argc, char **argv)
+{
+	BOOL help = FALSE;
+	BOOL error = FALSE;
+	char *filename = NULL;
+	long offset = 0L;
+	long error_line = 0L;
+	JAM_RETURN_TYPE crc_result = JAMC_SUCCESS;
+	JAM_RETURN_TYPE exec_result = JAMC_SUCCESS;
+	unsigned short expected_crc = 0;
+	unsigned short actual_crc = 0;
+	char key[33] = {0};
+	char value[257] = {0};
+	int exit_status = 0;
+	int arg = 0;
+	int exit_code = 0;
+	int format_version = 0;
+	time_t start_time = 0;
+	time_t end_time = 0;
+	int time_delta = 0;
+	char *workspace = NULL;
+	char *action = NULL;
+	char *init_list[10];
+	int init_count = 0;
+	FILE *fp = NULL;
+	struct stat sbuf;
+	long workspace_size = 0;
+	char *exit_string = NULL;
+	int reset_jtag = 1;
+	BOOL background_crc = FALSE;
+	char *crc_barrier = NULL;
+	BOOL server = FALSE;
+	BOOL compile = FALSE;
+	BOOL replay = FALSE;
+	BOOL play = FALSE;
+	BOOL crc_checked = FALSE;
+	char *image_name = NULL;
+	char *error_string = NULL;
+	double load_start_time = 0.0;
+	double load_time = 0.0;
+	double crc_time = 0.0;
+	double execute_time = 0.0;
+
+	verbose = FALSE;
+
+	init_list[0] = NULL;
+
+	/* print out the version string and copyright message */
+	fprintf(stderr, "Jam STAPL Player Version 2.5 (20040526)\nCopyright (C) 1997-2004 Altera Corporation\n\n");
+
+	for (arg = 1; arg < argc; arg++)
+	{
+		if ((argv[arg][0] == '-') || (argv[arg][0] == '/'))
+		{
+			switch(toupper(argv[arg][1]))
+			{
+			case '-':				/* long options */
+				if (strcmp(&argv[arg][2], "compile") == 0) compile = TRUE;
+				else if (strcmp(&argv[arg][2], "replay") == 0) replay = TRUE;
+				else if (strcmp(&argv[arg][2], "play") == 0) play = TRUE;
+				else if (strcmp(&argv[arg][2], "json") == 0) json_output = TRUE;
+				else error = TRUE;
+				break;
+
+			case 'A':				/* set action name */
+				action = &argv[arg][2];
+				if (action[0] == '"') ++action;
+				break;
+
+			case 'B':				/* check CRC in the background */
+				background_crc = TRUE;
+				crc_barrier = &argv[arg][2];
+				work_enabled = TRUE;
+				break;
+
+			case 'C':				/* array cache file */
+				array_cache_name = &argv[arg][2];
+				if (*array_cache_name == '\0') error = TRUE;
+				break;
+
+			case 'E':				/* profile execution */
+				profiling = TRUE;
+				profile_file_name = &argv[arg][2];
+				break;
+
+			case 'D':				/* initialization list */
+				if (argv[arg][2] == '"')
+				{
+					init_list[init_count] = &argv[arg][3];
+				}
+				else
+				{
+					init_list[init_count] = &argv[arg][2];
+				}
+				init_list[++init_count] = NULL;
+				break;
+			case 'P': 
+				BTCK=atoi(&argv[arg][2]);
+				break;
+				
+			case 'R':		/* don't reset the JTAG chain after use */
+				reset_jtag = 0;
+				break;
+
+			case 'T':				/* decode arrays in the background */
+				work_enabled = TRUE;
+				break;
+
+			case 'S':				/* set serial port address */
+				serial_port_name = &argv[arg][2];
+				specified_com_port = TRUE;
+				break;
+
+			case 'M':				/* set memory size */
+				if (sscanf(&argv[arg][2], "%ld", &workspace_size) != 1)
+					error = TRUE;
+				if (workspace_size == 0) error = TRUE;
+				break;
+
+			case 'H':				/* help */
+				help = TRUE;
+				break;
+
+			case 'J':				/* record a JTAG trace */
+				trace_name = &argv[arg][2];
+				if (*trace_name == '\0') error = TRUE;
+				break;
+
+			case 'X':				/* export scan vectors */
+				vector_file_name = &argv[arg][2];
+				if (*vector_file_name == '\0') error = TRUE;
+				break;
+
+			case 'L':				/* run jobs sent to a socket */
+				job_socket_name = &argv[arg][2];
+				if (*job_socket_name == '\0') error = TRUE;
+				break;
+
+			case 'V':				/* verbose */
+				verbose = TRUE;
+				break;
+
+			default:
+				error = TRUE;
+				break;
+			}
+		}
+		else
+		{
+			/* it's a filename */
+			if (filename == NULL)
+			{
+				filename = argv[arg];
+			}
+			else if (image_name == NULL)
+			{
+				/* a second filename is the image written by --compile */
+				image_name = argv[arg];
+			}
+			else
+			{
+				/* error -- we already found a filename */
+				error = TRUE;
+			}
+		}
+
+		if (error)
+		{
+			fprintf(stderr, "Illegal argument: \"%s\"\n", argv[arg]);
+			help = TRUE;
+			error = FALSE;
+		}
+	}
+
+	if ((image_name != NULL) && !compile)
+	{
+		fprintf(stderr, "Illegal argument: \"%s\"\n", image_name);
+		help = TRUE;
+	}
+
+	if (!help && (job_socket_name != NULL))
+	{
+		/* returns only in the process which is to run a job */
+		server = TRUE;
+		if (!serve_jobs(&filename, &action, init_list)) exit_status = 1;
+	}
+
+	if (help || ((filename == NULL) && !server) ||
+		(compile && (image_name == NULL)))
+	{
+		fprintf(stderr, "Usage:  jam [options] <filename>\n");
+		fprintf(stderr, "        jam --compile [-c<file>] <filename> <image>\n");
+		fprintf(stderr, "        jam --replay [-p<clk_pin>] <trace>\n");
+		fprintf(stderr, "        jam --play [-p<clk_pin>] <vectors>\n");
+		fprintf(stderr, "\nAvailable options:\n");
+		fprintf(stderr, "    -h          : show help message\n");
+		fprintf(stderr, "    -v          : show verbose messages\n");
+		fprintf(stderr, "    -a<action>  : specify action name (Jam STAPL)\n");
+		fprintf(stderr, "    --compile   : write a program image of <filename> to <image>\n");
+		fprintf(stderr, "    --replay    : drive the JTAG cycles recorded in <trace> and check TDO\n");
+		fprintf(stderr, "    --play      : shift the scans in <vectors> and check TDO\n");
+		fprintf(stderr, "    --json      : report results and metrics as JSON lines\n");
+		fprintf(stderr, "    -b[<stmt>]  : check CRC in the background until first DRSCAN (or <stmt>)\n");
+		fprintf(stderr, "    -c<file>    : cache decoded array data in file\n");
+		fprintf(stderr, "    -d<var=val> : initialize variable to specified value (Jam 1.1)\n");
+		fprintf(stderr, "    -d<proc=1>  : enable optional procedure (Jam STAPL)\n");
+		fprintf(stderr, "    -d<proc=0>  : disable recommended procedure (Jam STAPL)\n");
+		fprintf(stderr, "    -e[<file>]  : profile execution time (and write it to <file>)\n");
+		fprintf(stderr, "    -j<file>    : record the JTAG cycles and delays in a trace file\n");
+		fprintf(stderr, "    -l<socket>  : run jobs (<file> [-a<action>] [-d<var=val>]...) sent to socket\n");
+		fprintf(stderr, "    -p<clk_pin> : BBB pin for clk, defaults 811, which is pin 11, header P8.\n");
+		fprintf(stderr, "    -s<port>    : serial port name (for BitBlaster)\n");
+		fprintf(stderr, "    -r          : don't reset JTAG TAP after use\n");
+		fprintf(stderr, "    -t          : decode large arrays on a background thread\n");
+		fprintf(stderr, "    -x<file>    : export the JTAG scans, moves and waits as scan vectors\n");
+		exit_status = 1;
+	}
+	else if (server && (job_program == NULL))
+	{
+		/* the server has stopped */
+	}
+	else if (replay)
+	{
+		if (!replay_jtag_trace(filename)) exit_status = 1;
+	}
+	else if (play)
+	{
+		if (!play_vector_file(filename)) exit_status = 1;
+	}
+	else if ((workspace_size > 0) &&
+		((workspace = (char *) jam_malloc((size_t) workspace_size)) == NULL))
+	{
+		fprintf(stderr, "Error: can't allocate memory (%d Kbytes)\n",
+			(int) (workspace_size / 1024L));
+		exit_status = 1;
+	}
+	else if (access(filename, 0) != 0)
+	{
+		fprintf(stderr, "Error: can't access file \"%s\"\n", filename);
+		exit_status = 1;
+	}
+	else
+	{
+		load_start_time = profile_clock();
+
+		if (!file_mapped)
+		{
+			file_buffer = map_jam_file(filename, &file_length);
+			file_mapped = (file_buffer != NULL);
+		}
 
-			file_buffer = (char *) jam_malloc((size_t) file_length);
+		if (!file_mapped)
+		{
+			/* get length of file */
+			if (stat(filename, &sbuf) == 0) file_length = sbuf.st_size;
 
-			if (file_buffer == NULL)
+			if ((fp = fopen(filename, "rb")) == NULL)
 			{
-				fprintf(stderr, "Error: can't allocate memory (%d Kbytes)\n",
-					(int) (file_length / 1024L));
+				fprintf(stderr, "Error: can't open file \"%s\"\n", filename);
 				exit_status = 1;
 			}
 			else
 			{
-				if (fread(file_buffer, 1, (size_t) file_length, fp) !=
-					(size_t) file_length)
+				/*
+				*	Read entire file into a buffer
+				*/
+
+				file_buffer = (char *) jam_malloc((size_t) file_length);
+
+				if (file_buffer == NULL)
 				{
-					fprintf(stderr, "Error reading file \"%s\"\n", filename);
+					fprintf(stderr, "Error: can't allocate memory (%d Kbytes)\n",
+						(int) (file_length / 1024L));
 					exit_status = 1;
 				}
+				else
+				{
+					if (fread(file_buffer, 1, (size_t) file_length, fp) !=
+						(size_t) file_length)
+					{
+						fprintf(stderr, "Error reading file \"%s\"\n", filename);
+						exit_status = 1;
+					}
+				}
+
+				fclose(fp);
 			}
+		}
 
-			fclose(fp);
+		if ((exit_status == 0) && !load_program_image())
+		{
+			fprintf(stderr, "Error: \"%s\" is not a valid program image for this player\n", filename);
+			exit_status = 1;
 		}
 
-		if (exit_status == 0)
+		load_time = profile_clock() - load_start_time;
+
+		if ((exit_status == 0) && compile)
+		{
+			if (!compile_program_image(image_name)) exit_status = 1;
+		}
+		else if (exit_status == 0)
 		{
 			/*
 			*	Calibrate the delay loop function
@@ -826,58 +4146,143 @@ int main(int argc, char **argv)
 			calibrate_delay();
 
 			/*
-			*	Check CRC
+			*	Check CRC, or start checking it in the background
 			*/
-			crc_result = jam_check_crc(
-				file_buffer, file_length,
-				&expected_crc, &actual_crc);
+			if (job_program != NULL)
+			{
+				/* the server checked it when the file was mapped */
+				crc_result = job_program->crc_result;
+				expected_crc = job_program->expected_crc;
+				actual_crc = job_program->actual_crc;
+				crc_checked = TRUE;
+
+				if (program_image != NULL)
+				{
+					crc_result = check_image_crc(
+						crc_result, &expected_crc, actual_crc);
+				}
+			}
+			else if (background_crc && (jam_start_crc_check(
+				file_buffer, file_length, crc_barrier) != JAMC_SUCCESS))
+			{
+				fprintf(stderr, "Warning: unknown statement \"%s\", checking CRC before execution\n", crc_barrier);
+				background_crc = FALSE;
+			}
 
-			if (verbose || (crc_result == JAMC_CRC_ERROR))
+			if (crc_checked)
 			{
-				switch (crc_result)
+				background_crc = FALSE;
+				report_crc(crc_result, expected_crc, actual_crc);
+			}
+			else if (!background_crc)
+			{
+				crc_time -= profile_clock();
+				crc_result = jam_check_crc(
+					file_buffer, file_length,
+					&expected_crc, &actual_crc);
+				crc_time += profile_clock();
+
+				if (program_image != NULL)
 				{
-				case JAMC_SUCCESS:
-					printf("CRC matched: CRC value = %04X\n", actual_crc);
-					break;
-
-				case JAMC_CRC_ERROR:
-					printf("CRC mismatch: expected %04X, actual %04X\n",
-						expected_crc, actual_crc);
-					break;
-
-				case JAMC_UNEXPECTED_END:
-					printf("Expected CRC not found, actual CRC value = %04X\n",
-						actual_crc);
-					break;
-
-				default:
-					printf("CRC function returned error code %d\n", crc_result);
-					break;
+					crc_result = check_image_crc(
+						crc_result, &expected_crc, actual_crc);
 				}
+
+				report_crc(crc_result, expected_crc, actual_crc);
 			}
 
 			/*
 			*	Dump out NOTE fields
 			*/
-			if (verbose)
+			if (verbose && (program_image != NULL))
+			{
+				print_image_notes();
+			}
+			else if (verbose)
 			{
 				while (jam_get_note(
 					file_buffer, file_length,
 					&offset, key, value, 256) == 0)
 				{
-					printf("NOTE \"%s\" = \"%s\"\n", key, value);
+					if (json_output) print_json_note(key, value);
+					else printf("NOTE \"%s\" = \"%s\"\n", key, value);
+				}
+			}
+
+			/*
+			*	Open the decoded array cache
+			*/
+			if (array_cache_name != NULL)
+			{
+				/* the cache is keyed by the CRC, so it can't wait */
+				if (background_crc)
+				{
+					crc_time -= profile_clock();
+					jam_finish_crc_check(&expected_crc, &actual_crc);
+					crc_time += profile_clock();
 				}
+
+				open_array_cache(actual_crc);
+			}
+			else if (program_image != NULL)
+			{
+				open_image_array_cache();
 			}
 
 			/*
 			*	Execute the JAM program
 			*/
+			if ((trace_name != NULL) && !start_jtag_trace())
+			{
+				exit_status = 1;
+			}
+
+			if ((vector_file_name != NULL) && !start_vector_export())
+			{
+				exit_status = 1;
+			}
+
+			if (json_output) jam_set_profiling(JAMC_PROFILING_PHASES);
+			if (profiling) start_profile();
 			time(&start_time);
+			execute_time -= profile_clock();
 			exec_result = jam_execute(
 				file_buffer, file_length,
 				workspace, workspace_size, action, init_list,
 				reset_jtag, &error_line, &exit_code, &format_version);
+			execute_time += profile_clock();
 			time(&end_time);
+			count_run();
+			finish_profile();
+			jam_set_profiling(JAMC_PROFILING_OFF);
+			if (!finish_jtag_trace()) exit_status = 1;
+			if (!finish_vector_export()) exit_status = 1;
+
+			/* the server reports the exit code of the job */
+			if (job_program != NULL)
+			{
+				exit_status = (exec_result == JAMC_SUCCESS) ?
+					exit_code : JOB_FAILED;
+			}
+
+			if (background_crc)
+			{
+				crc_time -= profile_clock();
+				crc_result = jam_finish_crc_check(&expected_crc, &actual_crc);
+				crc_time += profile_clock();
+
+				if (program_image != NULL)
+				{
+					crc_result = check_image_crc(
+						crc_result, &expected_crc, actual_crc);
+				}
+
+				report_crc(crc_result, expected_crc, actual_crc);
+			}
+
+			stop_work_thread();
+
+			close_array_cache();
 
 			if (exec_result == JAMC_SUCCESS)
 			{
@@ -922,34 +4327,52 @@ int main(int argc, char **argv)
 					}
 				}
 
-				printf("Exit code = %d... %s\n", exit_code, exit_string);
+				if (!json_output)
+				{
+					printf("Exit code = %d... %s\n", exit_code, exit_string);
+				}
 			}
 			else if ((format_version == 2) &&
 				(exec_result == JAMC_ACTION_NOT_FOUND))
 			{
 				if ((action == NULL) || (*action == '\0'))
 				{
-					printf("Error: no action specified for Jam file.\nProgram terminated.\n");
+					error_string = "no action specified for Jam file";
+					if (!json_output) printf("Error: no action specified for Jam file.\nProgram terminated.\n");
 				}
 				else
 				{
-					printf("Error: action \"%s\" is not supported for this Jam file.\nProgram terminated.\n", action);
+					error_string = "action is not supported for this Jam file";
+					if (!json_output) printf("Error: action \"%s\" is not supported for this Jam file.\nProgram terminated.\n", action);
 				}
 			}
 			else if (exec_result < MAX_ERROR_CODE)
 			{
-				printf("Error on line %ld: %s.\nProgram terminated.\n",
-					error_line, error_text[exec_result]);
+				error_string = error_text[exec_result];
+				if (!json_output)
+				{
+					printf("Error on line %ld: %s.\nProgram terminated.\n",
+						error_line, error_text[exec_result]);
+				}
 			}
 			else
 			{
-				printf("Unknown error code %d\n", (int)exec_result);
+				error_string = "unknown error code";
+				if (!json_output) printf("Unknown error code %d\n", (int)exec_result);
+			}
+
+			if (json_output)
+			{
+				print_json_result(filename, action, exec_result, exit_code,
+					exit_string, error_line, error_string, load_time,
+					crc_time, execute_time - decode_time,
+					profile_clock() - load_start_time);
 			}
 
 			/*
 			*	Print out elapsed time
 			*/
-			if (verbose)
+			if (verbose && !json_output)
 			{
 				time_delta = (int) (end_time - start_time);
 				printf("Elapsed time = %02u:%02u:%02u\n",
@@ -960,12 +4383,20 @@ int main(int argc, char **argv)
 		}
 	}
 
-	if (jtag_hardware_initialized) {
+	/* when running a job, the JTAG hardware belongs to the server */
+	if (jtag_hardware_initialized && (job_program == NULL)) {
 		close_jtag_hardware();
 		jtag_hardware_initialized = FALSE;
 	}
 	if (workspace != NULL) jam_free(workspace);
-	if (file_buffer != NULL) jam_free(file_buffer);
+	jam_free_note_index();
+	if (program_image_buffer != NULL)
+	{
+		file_buffer = program_image_buffer;
+		file_length = program_image_length;
+	}
+	if (file_mapped) munmap(file_buffer, (size_t) file_length);
+	else if (file_buffer != NULL) jam_free(file_buffer);
 
 	#if defined(MEM_TRACKER)
 	if (verbose)
@@ -993,6 +4424,15 @@ int main(int argc, char **argv)
 	}
 #endif /* MEM_TRACKER */
 
+	if ((counters.run_count > 0L) || (counters.tck_count > 0L))
+	{
+		if ((job_program != NULL) && (job_counters != NULL))
+		{
+			add_counters(job_counters, &counters);
+		}
+
+		print_counters(json_output ? stdout : stderr, &counters);
+	}
 
 	return (exit_status);
 }
@@ -20,6 +20,35 @@
 #include "jamsym.h"
 #include "jamheap.h"
 #include "jamutil.h"
+#include "jamarena.h"
+
+/****************************************************************************/
+/*																			*/
+/*	Constant definitions													*/
+/*																			*/
+/****************************************************************************/
+
+/* number of entries in the symbol resolution cache (a prime number) */
+#define JAMC_SYMBOL_CACHE_SIZE 251
+
+/****************************************************************************/
+/*																			*/
+/*	Type definitions														*/
+/*																			*/
+/****************************************************************************/
+
+/*
+*	A symbol resolution cache entry remembers the result of a successful
+*	lookup, including the Jam 2.0 scope check, for one name referenced
+*	from one block.  Symbols are never removed or moved while a program
+*	runs, so an entry stays valid until the symbol table is reinitialized.
+*/
+typedef struct JAMS_SYMBOL_CACHE_STRUCT
+{
+	JAMS_SYMBOL_RECORD *block;
+	JAMS_SYMBOL_RECORD *symbol_record;
+
+} JAMS_SYMBOL_CACHE_RECORD;
 
 /****************************************************************************/
 /*																			*/
@@ -29,6 +58,8 @@
 
 JAMS_SYMBOL_RECORD **jam_symbol_table = NULL;
 
+JAMS_SYMBOL_CACHE_RECORD jam_symbol_cache[JAMC_SYMBOL_CACHE_SIZE];
+
 void *jam_symbol_bottom = NULL;
 
 extern BOOL jam_checking_uses_list;
@@ -66,7 +97,7 @@ JAM_RETURN_TYPE jam_init_symbol_table()
 	}
 	else
 	{
-		jam_symbol_table = (JAMS_SYMBOL_RECORD **) jam_malloc(
+		jam_symbol_table = (JAMS_SYMBOL_RECORD **) jam_arena_malloc(
 			(JAMC_MAX_SYMBOL_COUNT * sizeof(void *)));
 
 		if (jam_symbol_table == NULL)
@@ -83,6 +114,12 @@ JAM_RETURN_TYPE jam_init_symbol_table()
 		}
 	}
 
+	for (index = 0; index < JAMC_SYMBOL_CACHE_SIZE; ++index)
+	{
+		jam_symbol_cache[index].block = NULL;
+		jam_symbol_cache[index].symbol_record = NULL;
+	}
+
 	return (status);
 }
 
@@ -92,7 +129,9 @@ void jam_free_symbol_table()
 	JAMS_SYMBOL_RECORD *symbol_record = NULL;
 	JAMS_SYMBOL_RECORD *next = NULL;
 
-	if ((jam_symbol_table != NULL) && (jam_workspace == NULL))
+	/* with the arena, the records are released by jam_free_arena() */
+	if ((jam_symbol_table != NULL) && (jam_workspace == NULL) &&
+		(!jam_arena_active()))
 	{
 		for (hash = 0; hash < JAMC_MAX_SYMBOL_COUNT; ++hash)
 		{
@@ -251,6 +290,8 @@ JAM_RETURN_TYPE jam_add_symbol
 	char r, l;
 	int ch_index = 0;
 	int hash = 0;
+	int name_length = 0;
+	int name_space = 0;
 	long init_list_value = 0L;
 	BOOL match = FALSE;
 	BOOL identical_redeclaration = FALSE;
@@ -271,6 +312,14 @@ JAM_RETURN_TYPE jam_add_symbol
 		status = JAMC_ILLEGAL_SYMBOL;
 	}
 
+	/*
+	*	Space for the name (with terminating null), rounded up to a whole
+	*	number of longs so that the next record is aligned
+	*/
+	name_length = ch_index;
+	name_space = (int) (((name_length + sizeof(long)) / sizeof(long)) *
+		sizeof(long));
+
 	/*
 	*	Get hash key for this name
 	*/
@@ -380,7 +429,8 @@ JAM_RETURN_TYPE jam_add_symbol
 		if (jam_workspace != NULL)
 		{
 			jam_symbol_bottom = (void *)
-				(((long)jam_symbol_bottom) - sizeof(JAMS_SYMBOL_RECORD));
+				(((long)jam_symbol_bottom) - sizeof(JAMS_SYMBOL_RECORD) -
+				name_space);
 
 			symbol_record = (JAMS_SYMBOL_RECORD *) jam_symbol_bottom;
 
@@ -392,7 +442,7 @@ JAM_RETURN_TYPE jam_add_symbol
 		else
 		{
 			symbol_record = (JAMS_SYMBOL_RECORD *)
-				jam_malloc(sizeof(JAMS_SYMBOL_RECORD));
+				jam_arena_malloc(sizeof(JAMS_SYMBOL_RECORD) + name_space);
 
 			if (symbol_record == NULL)
 			{
@@ -417,14 +467,13 @@ JAM_RETURN_TYPE jam_add_symbol
 				prev_symbol_record->next = symbol_record;
 			}
 
-			ch_index = 0;
-			while ((ch_index < JAMC_MAX_NAME_LENGTH) &&
-				(name[ch_index] != '\0'))
+			symbol_record->name = (char *) &symbol_record[1];
+
+			for (ch_index = 0; ch_index < name_length; ++ch_index)
 			{
 				symbol_record->name[ch_index] = name[ch_index];
-				++ch_index;
 			}
-			symbol_record->name[ch_index] = '\0';
+			symbol_record->name[name_length] = '\0';
 		}
 	}
 
@@ -442,7 +491,10 @@ JAM_RETURN_TYPE jam_get_symbol_record
 
 /*																			*/
 /*	Description:	Searches in symbol table for a symbol record with		*/
-/*					matching name.											*/
+/*					matching name.  Successful lookups are remembered in	*/
+/*					the symbol resolution cache, so that names used			*/
+/*					repeatedly from the same block (e.g. in a loop) do not	*/
+/*					require a search of the hash chain or the USES list.	*/
 /*																			*/
 /*	Return:			Pointer to symbol record, or NULL if symbol not found	*/
 /*																			*/
@@ -455,7 +507,10 @@ JAM_RETURN_TYPE jam_get_symbol_record
 	int name_begin = 0;
 	int name_end = 0;
 	BOOL match = FALSE;
+	BOOL use_cache = FALSE;
+	BOOL cached = FALSE;
 	JAMS_SYMBOL_RECORD *tmp_symbol_record = NULL;
+	JAMS_SYMBOL_CACHE_RECORD *cache_record = NULL;
 	JAM_RETURN_TYPE status = JAMC_UNDEFINED_SYMBOL;
 
 	/*
@@ -463,10 +518,37 @@ JAM_RETURN_TYPE jam_get_symbol_record
 	*/
 	hash = jam_hash(name);
 
+	/*
+	*	Check the resolution cache.  The cache is not used until the
+	*	language version is known (since that decides whether scope rules
+	*	apply) or while a USES list is being validated.
+	*/
+	use_cache = (jam_version != 0) && (!jam_checking_uses_list);
+
+	if (use_cache)
+	{
+		cache_record = &jam_symbol_cache[(int) (((unsigned long) hash +
+			(((unsigned long) jam_current_block) >> 2)) %
+			JAMC_SYMBOL_CACHE_SIZE)];
+
+		if ((cache_record->symbol_record != NULL) &&
+			(cache_record->block == jam_current_block) &&
+			(jam_strcmp(cache_record->symbol_record->name, name) == 0))
+		{
+			tmp_symbol_record = cache_record->symbol_record;
+			status = JAMC_SUCCESS;
+			match = TRUE;
+			cached = TRUE;
+		}
+	}
+
 	/*
 	*	Get pointer to first symbol record corresponding to this hash key
 	*/
-	tmp_symbol_record = jam_symbol_table[hash];
+	if (!cached)
+	{
+		tmp_symbol_record = jam_symbol_table[hash];
+	}
 
 	/*
 	*	Search for name in symbol table
@@ -497,7 +579,7 @@ JAM_RETURN_TYPE jam_get_symbol_record
 	/*
 	*	For Jam version 2, check that symbol is in scope
 	*/
-	if ((status == JAMC_SUCCESS) && (jam_version == 2))
+	if ((status == JAMC_SUCCESS) && (jam_version == 2) && (!cached))
 	{
 		if (jam_checking_uses_list &&
 			((tmp_symbol_record->type == JAM_PROCEDURE_BLOCK) ||
@@ -594,6 +676,12 @@ JAM_RETURN_TYPE jam_get_symbol_record
 		{
 			*symbol_record = tmp_symbol_record;
 		}
+
+		if (use_cache && (!cached))
+		{
+			cache_record->block = jam_current_block;
+			cache_record->symbol_record = tmp_symbol_record;
+		}
 	}
 
 	return (status);
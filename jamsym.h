@@ -36,10 +36,11 @@ typedef enum
 
 } JAME_SYMBOL_TYPE;
 
-/* symbol record structure */
+/* symbol record structure -- the name is stored immediately after the */
+/* record, taking only as much space as the name requires */
 typedef struct JAMS_SYMBOL_STRUCT
 {
-	char name[JAMC_MAX_NAME_LENGTH + 1];
+	char *name;
 	JAME_SYMBOL_TYPE type;
 	long value;
 	long position;
@@ -106,4 +107,9 @@ JAM_RETURN_TYPE jam_get_symbol_record
 	JAMS_SYMBOL_RECORD **symbol_record
 );
 
+int jam_hash
+(
+	char *name
+);
+
 #endif /* INC_JAMSYM_H */